@@ -0,0 +1,169 @@
+// Cost of one call across the bridge for each kind of signature in the test
+// suite, in both directions, together with the number of allocations the call
+// makes on either side of it. By-value arguments that own a resource are
+// constructed as part of every call.
+//
+//     cargo bench --bench bridge
+//
+// Prints one JSON object per line:
+//
+//     {"bench":"c_return_primitive","direction":"rust_to_cxx","ns_per_call":2,"rust_allocs_per_call":0,"cxx_allocs_per_call":0}
+
+extern crate cxx_test_suite;
+
+mod common;
+
+use cxx_test_suite::ffi;
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::hint::black_box;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+struct Counting;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for Counting {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static ALLOC: Counting = Counting;
+
+// The counting operator new of tests/ffi/alloc.cc, which is kept out of the
+// test suite library itself.
+#[link(name = "cxx-test-suite-alloc", kind = "static")]
+extern "C" {
+    fn cxx_test_suite_bench_cxx_allocations() -> usize;
+}
+
+// Hooks the C++ half of the test suite expects from tests/test.rs.
+#[no_mangle]
+extern "C" fn cxx_test_suite_set_correct() {}
+
+#[no_mangle]
+extern "C" fn cxx_test_suite_get_box() -> *mut cxx_test_suite::R {
+    Box::into_raw(Box::new(2020usize))
+}
+
+#[no_mangle]
+unsafe extern "C" fn cxx_test_suite_r_is_correct(r: *const cxx_test_suite::R) -> bool {
+    *r == 2020
+}
+
+// Calls made once more, outside of the timing, to count allocations.
+const COUNT_ITERS: u32 = 1000;
+
+fn report(bench: &str, direction: &str, mut f: impl FnMut(u32)) {
+    let time = common::measure_batch(&mut f);
+    let rust_before = ALLOCATIONS.load(Ordering::Relaxed);
+    let cxx_before = unsafe { cxx_test_suite_bench_cxx_allocations() };
+    f(COUNT_ITERS);
+    let rust = ALLOCATIONS.load(Ordering::Relaxed) - rust_before;
+    let cxx = unsafe { cxx_test_suite_bench_cxx_allocations() } - cxx_before;
+    println!(
+        "{{\"bench\":\"{}\",\"direction\":\"{}\",\"ns_per_call\":{},\"rust_allocs_per_call\":{},\"cxx_allocs_per_call\":{}}}",
+        bench,
+        direction,
+        time.as_nanos(),
+        rust as f64 / COUNT_ITERS as f64,
+        cxx as f64 / COUNT_ITERS as f64,
+    );
+}
+
+macro_rules! rust_to_cxx {
+    ($($name:ident => $call:expr,)*) => {
+        $(
+            report(stringify!($name), "rust_to_cxx", |iters| {
+                for _ in 0..iters {
+                    let _ = black_box($call);
+                }
+            });
+        )*
+    };
+}
+
+macro_rules! cxx_to_rust {
+    ($($name:ident,)*) => {
+        $(
+            report(
+                &stringify!($name)["cxx_test_suite_bench_".len()..],
+                "cxx_to_rust",
+                |iters| {
+                    extern "C" {
+                        fn $name(iters: usize);
+                    }
+                    unsafe { $name(iters as usize) }
+                },
+            );
+        )*
+    };
+}
+
+fn main() {
+    let shared = ffi::Shared { z: 2020 };
+
+    rust_to_cxx! {
+        // The cost of the loop alone, which is what c_return_primitive comes
+        // down to when cross-language LTO inlines the C++ getter into the
+        // loop. See cxx::Build::direct_calls for the setup.
+        inline_baseline => 2020usize,
+        c_return_primitive => ffi::c_return_primitive(),
+        c_take_primitive => ffi::c_take_primitive(black_box(2020)),
+        c_return_shared => ffi::c_return_shared(),
+        c_take_shared => ffi::c_take_shared(ffi::Shared { z: 2020 }),
+        c_return_str => ffi::c_return_str(&shared).len(),
+        c_take_str => ffi::c_take_str(black_box("2020")),
+        c_return_slice => ffi::c_return_slice(&shared).len(),
+        c_take_slice_u8 => ffi::c_take_slice_u8(black_box(b"2020")),
+        c_return_rust_string => ffi::c_return_rust_string(),
+        c_take_rust_string => ffi::c_take_rust_string("2020".to_owned()),
+        c_return_rust_vec => ffi::c_return_rust_vec(),
+        c_take_rust_vec => ffi::c_take_rust_vec(b"2020".to_vec()),
+        c_return_box => ffi::c_return_box(),
+        c_take_box => ffi::c_take_box(Box::new(2020)),
+        c_return_unique_ptr => ffi::c_return_unique_ptr(),
+        c_take_unique_ptr => ffi::c_take_unique_ptr(ffi::c_return_unique_ptr()),
+        c_return_unique_ptr_string => ffi::c_return_unique_ptr_string(),
+        c_take_unique_ptr_string => ffi::c_take_unique_ptr_string(ffi::c_return_unique_ptr_string()),
+        c_return_unique_ptr_vector_u8 => ffi::c_return_unique_ptr_vector_u8(),
+        c_take_callback => ffi::c_take_callback(|s| s.len()),
+        c_try_return_primitive => ffi::c_try_return_primitive(),
+        c_fail_return_primitive => ffi::c_fail_return_primitive(),
+        c_fail_return_long_message => ffi::c_fail_return_long_message(),
+    }
+
+    cxx_to_rust! {
+        cxx_test_suite_bench_r_return_primitive,
+        cxx_test_suite_bench_r_take_primitive,
+        cxx_test_suite_bench_r_return_shared,
+        cxx_test_suite_bench_r_take_shared,
+        cxx_test_suite_bench_r_return_str,
+        cxx_test_suite_bench_r_take_str,
+        cxx_test_suite_bench_r_return_rust_string,
+        cxx_test_suite_bench_r_take_rust_string,
+        cxx_test_suite_bench_r_return_rust_vec,
+        cxx_test_suite_bench_r_take_rust_vec,
+        cxx_test_suite_bench_r_return_box,
+        cxx_test_suite_bench_r_take_box,
+        cxx_test_suite_bench_r_return_unique_ptr,
+        cxx_test_suite_bench_r_take_unique_ptr,
+        cxx_test_suite_bench_r_return_unique_ptr_string,
+        cxx_test_suite_bench_r_take_unique_ptr_string,
+        cxx_test_suite_bench_r_try_return_primitive,
+        cxx_test_suite_bench_r_fail_return_primitive,
+        cxx_test_suite_bench_r_fail_return_long_message,
+        cxx_test_suite_bench_r_fail_return_error_code,
+    }
+}
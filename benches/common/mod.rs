@@ -0,0 +1,28 @@
+use std::time::{Duration, Instant};
+
+// Average time of one call to f, doubling the iteration count until a run
+// takes long enough to be meaningful.
+#[allow(dead_code)]
+pub fn measure(mut f: impl FnMut()) -> Duration {
+    measure_batch(|iters| {
+        for _ in 0..iters {
+            f();
+        }
+    })
+}
+
+// Like measure, but f runs the given number of iterations itself, for loops
+// that live on the C++ side.
+pub fn measure_batch(mut f: impl FnMut(u32)) -> Duration {
+    let budget = Duration::from_millis(200);
+    let mut iters = 1u32;
+    loop {
+        let start = Instant::now();
+        f(iters);
+        let elapsed = start.elapsed();
+        if elapsed >= budget || iters >= 1 << 30 {
+            return elapsed / iters;
+        }
+        iters *= 2;
+    }
+}
@@ -0,0 +1,81 @@
+// Success path of the fallible functions of the test suite, called in turn so
+// that the shims of all of them are live in the instruction cache at once, as
+// in a program that makes many different calls across the bridge. Reports the
+// L1 instruction cache misses per round where the kernel allows counting
+// them, which is what keeping the error paths of the shims out of line is
+// meant to reduce; compare against a build of an earlier revision.
+//
+//     cargo bench --bench fallible
+//
+// Prints one JSON object per line, with null misses if they cannot be counted:
+//
+//     {"bench":"c_try_return","direction":"rust_to_cxx","ns_per_round":41,"icache_misses_per_round":0.02}
+
+extern crate cxx_test_suite;
+
+mod common;
+
+use cxx_test_suite::ffi;
+use std::hint::black_box;
+
+extern "C" {
+    fn cxx_test_suite_bench_icache_misses() -> i64;
+    fn cxx_test_suite_bench_r_try_return(iters: usize);
+}
+
+// Hooks the C++ half of the test suite expects from tests/test.rs.
+#[no_mangle]
+extern "C" fn cxx_test_suite_set_correct() {}
+
+#[no_mangle]
+extern "C" fn cxx_test_suite_get_box() -> *mut cxx_test_suite::R {
+    Box::into_raw(Box::new(2020usize))
+}
+
+#[no_mangle]
+unsafe extern "C" fn cxx_test_suite_r_is_correct(r: *const cxx_test_suite::R) -> bool {
+    *r == 2020
+}
+
+// Rounds run once more, outside of the timing, to count misses.
+const COUNT_ITERS: u32 = 10000;
+
+fn report(bench: &str, direction: &str, mut f: impl FnMut(u32)) {
+    let time = common::measure_batch(&mut f);
+    let before = unsafe { cxx_test_suite_bench_icache_misses() };
+    f(COUNT_ITERS);
+    let after = unsafe { cxx_test_suite_bench_icache_misses() };
+    let misses = if before < 0 || after < 0 {
+        "null".to_owned()
+    } else {
+        ((after - before) as f64 / COUNT_ITERS as f64).to_string()
+    };
+    println!(
+        "{{\"bench\":\"{}\",\"direction\":\"{}\",\"ns_per_round\":{},\"icache_misses_per_round\":{}}}",
+        bench,
+        direction,
+        time.as_nanos(),
+        misses,
+    );
+}
+
+fn main() {
+    let string = "2020".to_owned();
+
+    report("c_try_return", "rust_to_cxx", |iters| {
+        for _ in 0..iters {
+            let _ = black_box(ffi::c_try_return_void());
+            let _ = black_box(ffi::c_try_return_primitive());
+            let _ = black_box(ffi::c_try_return_box());
+            let _ = black_box(ffi::c_try_return_ref(&string));
+            let _ = black_box(ffi::c_try_return_str(black_box("2020")));
+            let _ = black_box(ffi::c_try_return_slice(black_box(b"2020")));
+            let _ = black_box(ffi::c_try_return_rust_string());
+            let _ = black_box(ffi::c_try_return_unique_ptr_string());
+        }
+    });
+
+    report("r_try_return", "cxx_to_rust", |iters| unsafe {
+        cxx_test_suite_bench_r_try_return(iters as usize)
+    });
+}
@@ -0,0 +1,38 @@
+// Times std::sort and std::vector growth over vectors of rust::String, both of
+// which spend most of their time moving elements.
+//
+//     cargo bench --bench string
+
+extern crate cxx_test_suite;
+
+mod common;
+
+use std::os::raw::c_void;
+
+extern "C" {
+    fn cxx_test_suite_bench_strings_new(n: usize) -> *mut c_void;
+    fn cxx_test_suite_bench_strings_drop(strings: *mut c_void);
+    fn cxx_test_suite_bench_strings_sort(strings: *mut c_void);
+    fn cxx_test_suite_bench_strings_grow(strings: *mut c_void);
+}
+
+const SIZES: &[usize] = &[16, 256, 4096, 65536, 1 << 20];
+
+fn main() {
+    for &n in SIZES {
+        unsafe {
+            let strings = cxx_test_suite_bench_strings_new(n);
+            let sort = common::measure(|| cxx_test_suite_bench_strings_sort(strings));
+            let grow = common::measure(|| cxx_test_suite_bench_strings_grow(strings));
+            cxx_test_suite_bench_strings_drop(strings);
+            println!(
+                "{:>8} strings  shuffle+sort {:>12?} ({:>5.1} ns/elem)  grow {:>12?} ({:>5.1} ns/elem)",
+                n,
+                sort,
+                sort.as_nanos() as f64 / n as f64,
+                grow,
+                grow.as_nanos() as f64 / n as f64,
+            );
+        }
+    }
+}
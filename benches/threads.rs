@@ -0,0 +1,141 @@
+// Throughput of bridge calls made from many threads at once, for each number
+// of threads from 1 up to the number of cores. Every thread runs the same
+// workload on its own; nothing is shared between them except what the bridge
+// and the allocators share. A workload whose scaling falls behind that of
+// c_return_primitive, which allocates nothing, is contending on something:
+// the global allocator for String and Box, the reference count and `operator
+// new` of long rust::Error messages. The results of the calls are checked, so
+// this doubles as a stress test of the bridge under concurrency.
+//
+//     cargo bench --bench threads
+//
+// Prints one JSON object per line, where scaling is the throughput relative to
+// that many times the throughput of one thread:
+//
+//     {"bench":"c_return_box","direction":"rust_to_cxx","threads":4,"calls_per_sec":41000000,"scaling":0.97}
+
+extern crate cxx_test_suite;
+
+mod common;
+
+use cxx_test_suite::ffi;
+use std::sync::{Arc, Barrier};
+use std::thread;
+use std::time::{Duration, Instant};
+
+extern "C" {
+    fn cxx_test_suite_bench_r_return_primitive(iters: usize);
+    fn cxx_test_suite_bench_r_return_rust_string(iters: usize);
+    fn cxx_test_suite_bench_r_return_box(iters: usize);
+    fn cxx_test_suite_bench_r_fail_return_long_message(iters: usize);
+    fn cxx_test_suite_bench_clone_rust_string(iters: usize);
+}
+
+// Hooks the C++ half of the test suite expects from tests/test.rs.
+#[no_mangle]
+extern "C" fn cxx_test_suite_set_correct() {}
+
+#[no_mangle]
+extern "C" fn cxx_test_suite_get_box() -> *mut cxx_test_suite::R {
+    Box::into_raw(Box::new(2020usize))
+}
+
+#[no_mangle]
+unsafe extern "C" fn cxx_test_suite_r_is_correct(r: *const cxx_test_suite::R) -> bool {
+    *r == 2020
+}
+
+// Each thread makes about this much work per run, as timed on one thread.
+const RUN: Duration = Duration::from_millis(200);
+
+// The number of threads of each run: powers of two, then the core count.
+fn thread_counts() -> Vec<usize> {
+    let cores = num_cpus::get();
+    let mut counts = Vec::new();
+    let mut n = 1;
+    while n < cores {
+        counts.push(n);
+        n *= 2;
+    }
+    counts.push(cores);
+    counts
+}
+
+fn report(bench: &str, direction: &str, f: fn(u32)) {
+    let per_call = common::measure_batch(f);
+    let iters = (RUN.as_nanos() / per_call.as_nanos().max(1)).max(1) as u32;
+    let mut single = 0.0;
+    for threads in thread_counts() {
+        let barrier = Arc::new(Barrier::new(threads + 1));
+        let workers: Vec<_> = (0..threads)
+            .map(|_| {
+                let barrier = Arc::clone(&barrier);
+                thread::spawn(move || {
+                    barrier.wait();
+                    f(iters);
+                })
+            })
+            .collect();
+        barrier.wait();
+        let start = Instant::now();
+        for worker in workers {
+            worker.join().unwrap();
+        }
+        let elapsed = start.elapsed();
+        let calls_per_sec = (threads as f64 * iters as f64) / elapsed.as_secs_f64();
+        if threads == 1 {
+            single = calls_per_sec;
+        }
+        println!(
+            "{{\"bench\":\"{}\",\"direction\":\"{}\",\"threads\":{},\"calls_per_sec\":{:.0},\"scaling\":{:.2}}}",
+            bench,
+            direction,
+            threads,
+            calls_per_sec,
+            calls_per_sec / (threads as f64 * single),
+        );
+    }
+}
+
+macro_rules! rust_to_cxx {
+    ($($name:ident => |$ret:ident| $check:expr,)*) => {
+        $(
+            report(stringify!($name), "rust_to_cxx", |iters| {
+                for _ in 0..iters {
+                    let $ret = ffi::$name();
+                    assert!($check);
+                }
+            });
+        )*
+    };
+}
+
+macro_rules! cxx_to_rust {
+    ($($name:ident,)*) => {
+        $(
+            report(
+                &stringify!($name)["cxx_test_suite_bench_".len()..],
+                "cxx_to_rust",
+                |iters| unsafe { $name(iters as usize) },
+            );
+        )*
+    };
+}
+
+fn main() {
+    rust_to_cxx! {
+        c_return_primitive => |ret| ret == 2020,
+        c_return_rust_string => |ret| ret == "2020",
+        c_return_box => |ret| *ret == 2020,
+        c_return_unique_ptr_string => |ret| ret.as_ref().unwrap().to_str() == Ok("2020"),
+        c_fail_return_long_message => |ret| ret.is_err(),
+    }
+
+    cxx_to_rust! {
+        cxx_test_suite_bench_r_return_primitive,
+        cxx_test_suite_bench_r_return_rust_string,
+        cxx_test_suite_bench_r_return_box,
+        cxx_test_suite_bench_r_fail_return_long_message,
+        cxx_test_suite_bench_clone_rust_string,
+    }
+}
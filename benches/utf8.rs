@@ -0,0 +1,79 @@
+// Compares the vectorized UTF-8 validation used by rust::Str and rust::String
+// constructors against the core::str::from_utf8 check it replaced.
+//
+//     cargo bench --bench utf8
+
+extern crate cxx;
+
+mod common;
+
+use std::hint::black_box;
+use std::time::Duration;
+
+extern "C" {
+    #[link_name = "cxxbridge02$utf8$valid"]
+    fn utf8_valid(ptr: *const u8, len: usize) -> bool;
+    #[link_name = "cxxbridge02$str$valid"]
+    fn str_valid(ptr: *const u8, len: usize) -> bool;
+}
+
+const SIZES: &[usize] = &[0, 8, 16, 64, 256, 1024, 4096, 65536, 1 << 20, 16 << 20];
+
+fn ascii(len: usize) -> Vec<u8> {
+    (0..len).map(|i| b'a' + (i % 26) as u8).collect()
+}
+
+fn multibyte(len: usize) -> Vec<u8> {
+    let pattern = "aé€😀".as_bytes();
+    let mut data = Vec::with_capacity(len + pattern.len());
+    while data.len() < len {
+        data.extend_from_slice(pattern);
+    }
+    // Truncate on a char boundary so the input stays valid.
+    while data.len() > len {
+        data.pop();
+        while data.last().map_or(false, |b| b & 0xC0 == 0x80) {
+            data.pop();
+        }
+        if data.last().map_or(false, |&b| b >= 0xC0) {
+            data.pop();
+        }
+    }
+    data
+}
+
+fn report(kind: &str, data: &[u8]) {
+    let run = |f: unsafe extern "C" fn(*const u8, usize) -> bool| {
+        common::measure(|| {
+            let ok = unsafe { f(black_box(data.as_ptr()), black_box(data.len())) };
+            assert!(black_box(ok));
+        })
+    };
+    let simd = run(utf8_valid);
+    let scalar = run(str_valid);
+    let throughput = |d: Duration| {
+        if data.is_empty() || d.as_nanos() == 0 {
+            0.0
+        } else {
+            data.len() as f64 / d.as_nanos() as f64
+        }
+    };
+    println!(
+        "{:<9} {:>9} B  simd {:>12?} ({:>6.2} GB/s)  from_utf8 {:>12?} ({:>6.2} GB/s)",
+        kind,
+        data.len(),
+        simd,
+        throughput(simd),
+        scalar,
+        throughput(scalar),
+    );
+}
+
+fn main() {
+    for &len in SIZES {
+        report("ascii", &ascii(len));
+    }
+    for &len in SIZES {
+        report("multibyte", &multibyte(len));
+    }
+}
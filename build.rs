@@ -1,8 +1,94 @@
+use std::collections::hash_map::DefaultHasher;
+use std::env;
+use std::fs;
+use std::hash::{Hash, Hasher};
+use std::path::Path;
+
 fn main() {
-    cc::Build::new()
+    let mut build = cc::Build::new();
+    build
         .file("src/cxx.cc")
-        .flag("-std=c++11")
-        .compile("cxxbridge02");
+        .file("src/stream.cc")
+        .file("src/utf8.cc")
+        .flag("-std=c++11");
+    if env::var_os("CARGO_FEATURE_INLINE_CXX_STRING").is_some() {
+        if let Some(layout) = cxx_string_layout() {
+            build.define(layout.define, None);
+            println!("cargo:rustc-cfg=cxx_string_layout");
+            println!("cargo:rustc-cfg=cxx_string_layout=\"{}\"", layout.name);
+        }
+    }
+    build.compile("cxxbridge02");
     println!("cargo:rerun-if-changed=src/cxx.cc");
+    println!("cargo:rerun-if-changed=src/stream.cc");
+    println!("cargo:rerun-if-changed=src/utf8.cc");
     println!("cargo:rerun-if-changed=include/cxx.h");
+    println!("cargo:rerun-if-changed=include/cxx");
+    println!("cargo:rerun-if-env-changed=CXXSTDLIB");
+
+    // Part of the fingerprint in gen/mod.rs, so that a change to the code
+    // generator without a version bump, as with a path or git dependency,
+    // does not reuse C++ generated by the old one.
+    let mut hasher = DefaultHasher::new();
+    for dir in &["src/gen", "src/syntax"] {
+        hash_sources(Path::new(dir), &mut hasher);
+        println!("cargo:rerun-if-changed={}", dir);
+    }
+    println!("cargo:rustc-env=CXXBRIDGE02_GEN_HASH={:016x}", hasher.finish());
+    println!(
+        "cargo:rustc-check-cfg=cfg(cxx_string_layout, values(none(), \"libstdcxx\", \"libcxx\"))"
+    );
+}
+
+fn hash_sources(dir: &Path, hasher: &mut DefaultHasher) {
+    let mut paths: Vec<_> = fs::read_dir(dir)
+        .unwrap()
+        .map(|entry| entry.unwrap().path())
+        .filter(|path| path.extension().map_or(false, |ext| ext == "rs"))
+        .collect();
+    paths.sort();
+    for path in paths {
+        path.file_name().hash(hasher);
+        fs::read(&path).unwrap().hash(hasher);
+    }
+}
+
+struct Layout {
+    name: &'static str,
+    define: &'static str,
+}
+
+const LIBSTDCXX: Layout = Layout {
+    name: "libstdcxx",
+    define: "CXXBRIDGE02_CXX_STRING_LIBSTDCXX",
+};
+
+const LIBCXX: Layout = Layout {
+    name: "libcxx",
+    define: "CXXBRIDGE02_CXX_STRING_LIBCXX",
+};
+
+// Guesses the standard library the same way the cc crate picks the one to
+// link. cxx.cc double checks the guess at compile time. Targets not listed
+// here keep making an FFI call to read a std::string.
+fn cxx_string_layout() -> Option<Layout> {
+    if env::var("CARGO_CFG_TARGET_POINTER_WIDTH").ok()? != "64"
+        || env::var("CARGO_CFG_TARGET_ENDIAN").ok()? != "little"
+    {
+        return None;
+    }
+    if let Ok(stdlib) = env::var("CXXSTDLIB") {
+        return match stdlib.as_str() {
+            "stdc++" => Some(LIBSTDCXX),
+            "c++" => Some(LIBCXX),
+            _ => None,
+        };
+    }
+    let os = env::var("CARGO_CFG_TARGET_OS").ok()?;
+    let target_env = env::var("CARGO_CFG_TARGET_ENV").unwrap_or_default();
+    match (os.as_str(), target_env.as_str()) {
+        ("linux", "gnu") => Some(LIBSTDCXX),
+        ("macos", _) | ("ios", _) | ("freebsd", _) => Some(LIBCXX),
+        _ => None,
+    }
 }
@@ -9,8 +9,11 @@ mod gen;
 mod syntax;
 
 use gen::include;
+use std::collections::HashMap;
+use std::fs;
 use std::io::{self, Write};
-use std::path::PathBuf;
+use std::path::{Component, Path, PathBuf};
+use std::process;
 use structopt::StructOpt;
 
 #[derive(StructOpt, Debug)]
@@ -21,6 +24,8 @@ use structopt::StructOpt;
     usage = "\
     cxxbridge <input>.rs              Emit .cc file for bridge to stdout
     cxxbridge <input>.rs --header     Emit .h file for bridge to stdout
+    cxxbridge <input>.rs... --out-dir <dir>
+                                      Write .h and .cc files for every bridge
     cxxbridge --header                Emit rust/cxx.h header to stdout",
     help_message = "Print help information",
     version_message = "Print version information"
@@ -28,7 +33,22 @@ use structopt::StructOpt;
 struct Opt {
     /// Input Rust source file containing #[cxx::bridge]
     #[structopt(parse(from_os_str), required_unless = "header")]
-    input: Option<PathBuf>,
+    input: Vec<PathBuf>,
+
+    /// Write <input>.h and <input>.cc under this directory for each input,
+    /// generating them in parallel, instead of one file to stdout
+    #[structopt(long, parse(from_os_str))]
+    out_dir: Option<PathBuf>,
+
+    /// Also write a unity translation unit with this file name into
+    /// --out-dir, which compiles all of the generated .cc files at once
+    #[structopt(long, parse(from_os_str), requires = "out_dir")]
+    unity: Option<PathBuf>,
+
+    /// Number of inputs to generate at the same time with --out-dir
+    /// [default: number of CPUs]
+    #[structopt(short, long)]
+    jobs: Option<usize>,
 
     /// Emit header with declarations only
     #[structopt(long)]
@@ -37,23 +57,158 @@ struct Opt {
     /// Any additional headers to #include
     #[structopt(short, long)]
     include: Vec<String>,
+
+    /// Call C++ functions directly and define Rust function wrappers inline
+    /// in the header; pass the same flag for the .h and the .cc
+    #[structopt(long)]
+    direct_calls: bool,
 }
 
 fn write(content: impl AsRef<[u8]>) {
     let _ = io::stdout().lock().write_all(content.as_ref());
 }
 
+// rust/cxx.h with the headers it includes pasted in place, each once, for
+// `cxxbridge --header` to print as a single file.
+fn amalgamated() -> String {
+    let mut header = String::new();
+    let mut pasted = Vec::new();
+    paste(&mut header, &mut pasted, include::HEADER, false);
+    header
+}
+
+fn paste(header: &mut String, pasted: &mut Vec<&str>, content: &str, nested: bool) {
+    for line in content.lines() {
+        if nested && line == "#pragma once" {
+            continue;
+        }
+        let included = if line.starts_with("#include \"") && line.ends_with('"') {
+            Some(&line["#include \"".len()..line.len() - 1])
+        } else {
+            None
+        };
+        // Fragments include each other by file name alone.
+        let fragment = included.and_then(|included| {
+            include::FRAGMENTS
+                .iter()
+                .find(|(path, _)| *path == included || path.rsplit('/').next() == Some(included))
+        });
+        match fragment {
+            Some((path, fragment)) => {
+                if !pasted.contains(path) {
+                    pasted.push(path);
+                    paste(header, pasted, fragment, true);
+                }
+            }
+            None => {
+                *header += line;
+                *header += "\n";
+            }
+        }
+    }
+}
+
 fn main() {
     let opt = Opt::from_args();
 
     let gen = gen::Opt {
         include: opt.include,
+        direct_calls: opt.direct_calls,
     };
 
-    match (opt.input, opt.header) {
-        (Some(input), true) => write(gen::do_generate_header(&input, gen)),
-        (Some(input), false) => write(gen::do_generate_bridge(&input, gen)),
-        (None, true) => write(include::HEADER),
-        (None, false) => unreachable!(), // enforced by required_unless
+    if let Some(out_dir) = opt.out_dir {
+        let jobs = opt.jobs.unwrap_or_else(num_cpus::get);
+        check_distinct_outputs(&opt.input);
+        if let Some(unity) = opt.unity {
+            if unity.components().count() != 1 {
+                eprintln!("cxxbridge: --unity takes a file name, not a path");
+                process::exit(1);
+            }
+            // The includes are relative to out_dir, where the unity file is.
+            let implementations: Vec<_> = opt
+                .input
+                .iter()
+                .map(|input| with_suffix(&relative(input), ".cc"))
+                .collect();
+            let path = out_dir.join(unity);
+            fs::create_dir_all(&out_dir)
+                .and_then(|()| fs::write(&path, gen::unity(&implementations)))
+                .unwrap_or_else(|err| {
+                    eprintln!("cxxbridge: {}: {}", path.display(), err);
+                    process::exit(1);
+                });
+        }
+        gen::parallel::map(opt.input, jobs, move |input| {
+            write_files(&out_dir, &input, gen.clone())
+        });
+        return;
     }
+
+    let input = match opt.input.as_slice() {
+        // --header without input, enforced by required_unless
+        [] => {
+            write(&amalgamated());
+            return;
+        }
+        [input] => input,
+        _ => {
+            eprintln!("cxxbridge: more than one input requires --out-dir");
+            process::exit(1);
+        }
+    };
+    let source = gen::read_source(input);
+    let code = gen::find_bridge(input, &source).generate(gen);
+    if opt.header {
+        write(code.header);
+    } else {
+        write(code.implementation);
+    }
+}
+
+// Mirrors the input path under out_dir, so that src/a/mod.rs and src/b/mod.rs
+// do not overwrite each other.
+fn write_files(out_dir: &Path, input: &Path, opt: gen::Opt) {
+    let source = gen::read_source(input);
+    let code = gen::find_bridge(input, &source).generate(opt);
+
+    let path = out_dir.join(relative(input));
+    let result = (|| -> io::Result<()> {
+        fs::create_dir_all(path.parent().unwrap())?;
+        fs::write(with_suffix(&path, ".h"), code.header)?;
+        fs::write(with_suffix(&path, ".cc"), code.implementation)
+    })();
+    if let Err(err) = result {
+        eprintln!("cxxbridge: {}: {}", path.display(), err);
+        process::exit(1);
+    }
+}
+
+// Only the normal components are kept, so that the output stays under out_dir.
+// This can map two inputs to the same output, such as ../x/lib.rs and x/lib.rs,
+// which check_distinct_outputs rejects.
+fn relative(input: &Path) -> PathBuf {
+    input
+        .components()
+        .filter(|component| matches!(component, Component::Normal(_)))
+        .collect()
+}
+
+fn check_distinct_outputs(inputs: &[PathBuf]) {
+    let mut outputs = HashMap::new();
+    for input in inputs {
+        if let Some(other) = outputs.insert(relative(input), input) {
+            eprintln!(
+                "cxxbridge: {} and {} would be written to the same files in --out-dir",
+                other.display(),
+                input.display(),
+            );
+            process::exit(1);
+        }
+    }
+}
+
+fn with_suffix(path: &Path, suffix: &str) -> PathBuf {
+    let mut path = path.as_os_str().to_owned();
+    path.push(suffix);
+    PathBuf::from(path)
 }
@@ -1,5 +1,5 @@
 #pragma once
-#include "rust/cxx.h"
+#include "rust/cxx/str.h"
 #include <memory>
 #include <string>
 
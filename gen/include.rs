@@ -2,23 +2,37 @@ use std::fmt::{self, Display};
 
 pub static HEADER: &str = include_str!("include/cxx.h");
 
+// The headers included by rust/cxx.h, by their path relative to it.
+pub static FRAGMENTS: &[(&str, &str)] = &[
+    ("cxx/arena.h", include_str!("include/cxx/arena.h")),
+    ("cxx/box.h", include_str!("include/cxx/box.h")),
+    ("cxx/error.h", include_str!("include/cxx/error.h")),
+    ("cxx/fn.h", include_str!("include/cxx/fn.h")),
+    ("cxx/promise.h", include_str!("include/cxx/promise.h")),
+    ("cxx/slice.h", include_str!("include/cxx/slice.h")),
+    ("cxx/str.h", include_str!("include/cxx/str.h")),
+    ("cxx/string.h", include_str!("include/cxx/string.h")),
+    ("cxx/vec.h", include_str!("include/cxx/vec.h")),
+];
+
 pub fn get(guard: &str) -> &'static str {
     let ifndef = format!("#ifndef {}", guard);
     let endif = format!("#endif // {}", guard);
-    let begin = find_line(&ifndef);
-    let end = find_line(&endif);
-    if let (Some(begin), Some(end)) = (begin, end) {
-        &HEADER[begin..end + endif.len()]
-    } else {
-        panic!("not found in cxx.h header: {}", guard)
+    for (_, fragment) in FRAGMENTS {
+        let begin = find_line(fragment, &ifndef);
+        let end = find_line(fragment, &endif);
+        if let (Some(begin), Some(end)) = (begin, end) {
+            return &fragment[begin..end + endif.len()];
+        }
     }
+    panic!("not found in cxx.h header: {}", guard)
 }
 
-fn find_line(line: &str) -> Option<usize> {
+fn find_line(header: &str, line: &str) -> Option<usize> {
     let mut offset = 0;
     loop {
-        offset += HEADER[offset..].find(line)?;
-        let rest = &HEADER[offset + line.len()..];
+        offset += header[offset..].find(line)?;
+        let rest = &header[offset + line.len()..];
         if rest.starts_with('\n') || rest.starts_with('\r') {
             return Some(offset);
         }
@@ -34,10 +48,13 @@ pub struct Includes {
     pub cstdint: bool,
     pub cstring: bool,
     pub exception: bool,
+    pub iosfwd: bool,
     pub memory: bool,
+    pub new: bool,
     pub string: bool,
     pub type_traits: bool,
     pub utility: bool,
+    pub vector: bool,
 }
 
 impl Includes {
@@ -76,9 +93,15 @@ impl Display for Includes {
         if self.exception {
             writeln!(f, "#include <exception>")?;
         }
+        if self.iosfwd {
+            writeln!(f, "#include <iosfwd>")?;
+        }
         if self.memory {
             writeln!(f, "#include <memory>")?;
         }
+        if self.new {
+            writeln!(f, "#include <new>")?;
+        }
         if self.string {
             writeln!(f, "#include <string>")?;
         }
@@ -88,6 +111,9 @@ impl Display for Includes {
         if self.utility {
             writeln!(f, "#include <utility>")?;
         }
+        if self.vector {
+            writeln!(f, "#include <vector>")?;
+        }
         if *self != Self::default() {
             writeln!(f)?;
         }
@@ -5,13 +5,16 @@ mod error;
 pub(super) mod include;
 mod namespace;
 pub(super) mod out;
+pub(super) mod parallel;
 mod write;
 
 use self::error::format_err;
 use self::namespace::Namespace;
 use crate::syntax::{self, check, ident, Types};
 use quote::quote;
+use std::collections::hash_map::DefaultHasher;
 use std::fs;
+use std::hash::{Hash, Hasher};
 use std::io;
 use std::path::Path;
 use syn::parse::ParseStream;
@@ -37,39 +40,113 @@ struct Input {
     module: Vec<Item>,
 }
 
-#[derive(Default)]
+#[derive(Default, Clone)]
 pub(super) struct Opt {
     /// Any additional headers to #include
     pub include: Vec<String>,
+    /// Call C++ functions directly from their shims and define the C++
+    /// wrappers of Rust functions inline in the header, so that calls in
+    /// either direction are not hidden behind an extra out-of-line function
+    pub direct_calls: bool,
 }
 
-pub(super) fn do_generate_bridge(path: &Path, opt: Opt) -> Vec<u8> {
-    let header = false;
-    generate(path, opt, header)
+pub(super) fn read_source(path: &Path) -> String {
+    match fs::read_to_string(path) {
+        Ok(source) => source,
+        Err(err) => format_err(path, "", Error::Io(err)),
+    }
 }
 
-pub(super) fn do_generate_header(path: &Path, opt: Opt) -> Vec<u8> {
-    let header = true;
-    generate(path, opt, header)
+// The #[cxx::bridge] module of a source file, located but not yet parsed into
+// an API.
+pub(super) struct Bridge<'a> {
+    path: &'a Path,
+    source: &'a str,
+    input: Input,
 }
 
-fn generate(path: &Path, opt: Opt, header: bool) -> Vec<u8> {
-    let source = match fs::read_to_string(path) {
-        Ok(source) => source,
-        Err(err) => format_err(path, "", Error::Io(err)),
-    };
-    match (|| -> Result<_> {
-        let syntax = syn::parse_file(&source)?;
-        let bridge = find_bridge_mod(syntax)?;
-        let apis = syntax::parse_items(bridge.module)?;
-        let types = Types::collect(&apis)?;
-        check::typecheck(&apis, &types)?;
-        let out = write::gen(bridge.namespace, &apis, &types, opt, header);
-        Ok(out)
-    })() {
-        Ok(out) => out.content(),
-        Err(err) => format_err(path, &source, err),
+// Both generated files of one bridge, from a single parse of its source.
+pub(super) struct GeneratedCode {
+    pub header: Vec<u8>,
+    pub implementation: Vec<u8>,
+}
+
+pub(super) fn find_bridge<'a>(path: &'a Path, source: &'a str) -> Bridge<'a> {
+    let input = syn::parse_file(source)
+        .map_err(Error::from)
+        .and_then(find_bridge_mod);
+    match input {
+        Ok(input) => Bridge {
+            path,
+            source,
+            input,
+        },
+        Err(err) => format_err(path, source, err),
+    }
+}
+
+impl Bridge<'_> {
+    // Changes whenever the generated code could: the bridge module, but not
+    // the rest of the file it is in, plus the options and generator version.
+    pub(super) fn fingerprint(&self, opt: &Opt) -> String {
+        let namespace = &self.input.namespace;
+        let module = &self.input.module;
+        let content = format!("{} {}", namespace, quote!(#(#module)*));
+        fingerprint(&content, opt)
+    }
+
+    pub(super) fn generate(self, opt: Opt) -> GeneratedCode {
+        let Bridge {
+            path,
+            source,
+            input,
+        } = self;
+        match (move || -> Result<_> {
+            let apis = syntax::parse_items(input.module)?;
+            let types = Types::collect(&apis)?;
+            check::typecheck(&apis, &types)?;
+            let namespace = input.namespace;
+            let header = write::gen(namespace.clone(), &apis, &types, opt.clone(), true);
+            let implementation = write::gen(namespace, &apis, &types, opt, false);
+            Ok(GeneratedCode {
+                header: header.content(),
+                implementation: implementation.content(),
+            })
+        })() {
+            Ok(code) => code,
+            Err(err) => format_err(path, source, err),
+        }
+    }
+}
+
+// Hash identifying the output generated for `content` under `opt`. It is only
+// compared against earlier builds on the same machine, so the unspecified but
+// deterministic DefaultHasher is good enough. The generator's own sources are
+// hashed by the build script of the cxx crate; cxxbridge-cmd, which shares
+// this file, never caches.
+pub(super) fn fingerprint(content: &str, opt: &Opt) -> String {
+    let mut hasher = DefaultHasher::new();
+    env!("CARGO_PKG_VERSION").hash(&mut hasher);
+    option_env!("CXXBRIDGE02_GEN_HASH").hash(&mut hasher);
+    include::HEADER.hash(&mut hasher);
+    include::FRAGMENTS.hash(&mut hasher);
+    opt.include.hash(&mut hasher);
+    opt.direct_calls.hash(&mut hasher);
+    content.hash(&mut hasher);
+    format!("{:016x}", hasher.finish())
+}
+
+// Translation unit that compiles the generated implementations of several
+// bridges at once, so that the headers they share are parsed only once.
+// rust/cxx.h comes first: it can be precompiled because every build including
+// it sees the same contents, and its section guards make the copies of those
+// sections in each implementation drop out.
+pub(super) fn unity<P: AsRef<Path>>(implementations: &[P]) -> Vec<u8> {
+    let mut unity = String::from("#include \"rust/cxx.h\"\n");
+    for path in implementations {
+        unity += &format!("#include \"{}\"\n", path.as_ref().display());
     }
+    unity.into_bytes()
 }
 
 fn find_bridge_mod(syntax: File) -> Result<Input> {
@@ -6,6 +6,7 @@ use std::fmt::{self, Arguments, Write};
 pub(crate) struct OutFile {
     pub namespace: Namespace,
     pub header: bool,
+    pub direct_calls: bool,
     pub include: Includes,
     content: RefCell<Content>,
 }
@@ -17,10 +18,11 @@ struct Content {
 }
 
 impl OutFile {
-    pub fn new(namespace: Namespace, header: bool) -> Self {
+    pub fn new(namespace: Namespace, header: bool, direct_calls: bool) -> Self {
         OutFile {
             namespace,
             header,
+            direct_calls,
             include: Includes::new(),
             content: RefCell::new(Content {
                 bytes: Vec::new(),
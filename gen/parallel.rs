@@ -0,0 +1,52 @@
+use std::cmp;
+use std::panic;
+use std::sync::{Arc, Mutex};
+use std::thread;
+
+// Applies `f` to every item on up to `jobs` threads and returns the results in
+// the order of the items. Without scoped threads, which need a newer compiler
+// than we support, the items and the function are moved into the workers.
+pub(crate) fn map<T, R, F>(items: Vec<T>, jobs: usize, f: F) -> Vec<R>
+where
+    T: Send + 'static,
+    R: Send + 'static,
+    F: Fn(T) -> R + Send + Sync + 'static,
+{
+    let len = items.len();
+    let jobs = cmp::min(jobs, len);
+    if jobs <= 1 {
+        return items.into_iter().map(f).collect();
+    }
+
+    let queue = Arc::new(Mutex::new(items.into_iter().enumerate()));
+    let f = Arc::new(f);
+    let workers: Vec<_> = (0..jobs)
+        .map(|_| {
+            let queue = Arc::clone(&queue);
+            let f = Arc::clone(&f);
+            thread::spawn(move || {
+                let mut results = Vec::new();
+                loop {
+                    let next = queue.lock().unwrap().next();
+                    match next {
+                        Some((i, item)) => results.push((i, f(item))),
+                        None => return results,
+                    }
+                }
+            })
+        })
+        .collect();
+
+    let mut results: Vec<Option<R>> = (0..len).map(|_| None).collect();
+    for worker in workers {
+        match worker.join() {
+            Ok(done) => {
+                for (i, result) in done {
+                    results[i] = Some(result);
+                }
+            }
+            Err(payload) => panic::resume_unwind(payload),
+        }
+    }
+    results.into_iter().map(Option::unwrap).collect()
+}
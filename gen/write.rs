@@ -2,7 +2,7 @@ use crate::gen::namespace::Namespace;
 use crate::gen::out::OutFile;
 use crate::gen::{include, Opt};
 use crate::syntax::atom::Atom::{self, *};
-use crate::syntax::{Api, ExternFn, Signature, Struct, Type, Types, Var};
+use crate::syntax::{Api, ExternFn, ExternType, Signature, Struct, Type, Types, Var};
 use proc_macro2::Ident;
 
 pub(super) fn gen(
@@ -12,7 +12,7 @@ pub(super) fn gen(
     opt: Opt,
     header: bool,
 ) -> OutFile {
-    let mut out_file = OutFile::new(namespace.clone(), header);
+    let mut out_file = OutFile::new(namespace.clone(), header, opt.direct_calls);
     let out = &mut out_file;
 
     if header {
@@ -45,31 +45,69 @@ pub(super) fn gen(
     }
 
     for api in apis {
-        if let Api::Struct(strct) = api {
-            out.next_section();
-            write_struct(out, strct);
+        match api {
+            Api::Struct(strct) => {
+                out.next_section();
+                write_struct(out, strct, types);
+            }
+            Api::RustType(ety) if ety.layout.is_some() => {
+                out.next_section();
+                write_rust_type(out, ety);
+            }
+            _ => {}
         }
     }
 
     if !header {
         out.begin_block("extern \"C\"");
-        write_exception_glue(out, apis);
         for api in apis {
             let (efn, write): (_, fn(_, _, _)) = match api {
                 Api::CxxFunction(efn) => (efn, write_cxx_function_shim),
                 Api::RustFunction(efn) => (efn, write_rust_function_decl),
+                Api::RustType(ety) if ety.layout.is_some() => {
+                    out.next_section();
+                    write_rust_type_decl(out, ety);
+                    continue;
+                }
                 _ => continue,
             };
             out.next_section();
             write(out, efn, types);
         }
         out.end_block("extern \"C\"");
+    } else if out.direct_calls {
+        // The inline wrappers of Rust functions in the header call the Rust
+        // symbols themselves.
+        out.begin_block("extern \"C\"");
+        for api in apis {
+            match api {
+                Api::RustFunction(efn) => {
+                    out.next_section();
+                    write_rust_function_decl(out, efn, types);
+                }
+                Api::RustType(ety) if ety.layout.is_some() => {
+                    out.next_section();
+                    write_rust_type_decl(out, ety);
+                }
+                _ => {}
+            }
+        }
+        out.end_block("extern \"C\"");
     }
 
     for api in apis {
-        if let Api::RustFunction(efn) = api {
-            out.next_section();
-            write_rust_function_shim(out, efn, types);
+        match api {
+            Api::RustType(ety) if ety.layout.is_some() => {
+                if !out.header || out.direct_calls {
+                    out.next_section();
+                    write_rust_type_impl(out, ety);
+                }
+            }
+            Api::RustFunction(efn) => {
+                out.next_section();
+                write_rust_function_shim(out, efn, types);
+            }
+            _ => {}
         }
     }
 
@@ -96,10 +134,13 @@ fn write_includes(out: &mut OutFile, types: &Types) {
                 | Some(I64) => out.include.cstdint = true,
                 Some(Usize) => out.include.cstddef = true,
                 Some(CxxString) => out.include.string = true,
-                Some(Bool) | Some(Isize) | Some(F32) | Some(F64) | Some(RustString) | None => {}
+                Some(CxxIstream) | Some(CxxOstream) => out.include.iosfwd = true,
+                Some(Bool) | Some(Isize) | Some(F32) | Some(F64) | Some(RustString)
+                | Some(Arena) | None => {}
             },
             Type::RustBox(_) => out.include.type_traits = true,
-            Type::UniquePtr(_) => out.include.memory = true,
+            Type::UniquePtr(_) | Type::SharedPtr(_) | Type::WeakPtr(_) => out.include.memory = true,
+            Type::CxxVector(_) => out.include.vector = true,
             _ => {}
         }
     }
@@ -108,26 +149,55 @@ fn write_includes(out: &mut OutFile, types: &Types) {
 fn write_include_cxxbridge(out: &mut OutFile, apis: &[Api], types: &Types) {
     let mut needs_rust_string = false;
     let mut needs_rust_str = false;
+    let mut needs_rust_slice = false;
     let mut needs_rust_box = false;
+    let mut needs_rust_vec = false;
     let mut needs_rust_fn = false;
+    let mut needs_rust_promise = false;
+    let mut needs_rust_arena = false;
     for ty in types {
         match ty {
             Type::RustBox(_) => {
                 out.include.type_traits = true;
                 needs_rust_box = true;
             }
+            Type::RustVec(_) => {
+                out.include.array = true;
+                out.include.cstddef = true;
+                out.include.cstdint = true;
+                out.include.new = true;
+                out.include.type_traits = true;
+                out.include.utility = true;
+                needs_rust_vec = true;
+            }
             Type::Str(_) => {
                 out.include.cstdint = true;
                 out.include.string = true;
                 needs_rust_str = true;
             }
+            Type::SliceRef(_) => {
+                out.include.cstddef = true;
+                needs_rust_slice = true;
+            }
             Type::Fn(_) => {
+                out.include.array = true;
+                out.include.new = true;
+                out.include.type_traits = true;
+                out.include.utility = true;
                 needs_rust_fn = true;
             }
+            ty if ty == Arena => {
+                out.include.cstddef = true;
+                out.include.new = true;
+                out.include.type_traits = true;
+                out.include.utility = true;
+                needs_rust_arena = true;
+            }
             ty if ty == RustString => {
                 out.include.array = true;
                 out.include.cstdint = true;
                 out.include.string = true;
+                out.include.type_traits = true;
                 needs_rust_string = true;
             }
             _ => {}
@@ -140,25 +210,46 @@ fn write_include_cxxbridge(out: &mut OutFile, apis: &[Api], types: &Types) {
     let mut needs_maybe_uninit = false;
     let mut needs_trycatch = false;
     for api in apis {
+        if let Api::RustFunction(efn) = api {
+            // The C++ wrapper takes a rust::Fn for the result, in the header
+            // as well.
+            if efn.asyncness.is_some() {
+                out.include.array = true;
+                out.include.new = true;
+                out.include.type_traits = true;
+                out.include.utility = true;
+                needs_rust_fn = true;
+                needs_rust_promise = true;
+            }
+        }
         match api {
             Api::CxxFunction(efn) if !out.header => {
                 if efn.throws {
                     needs_trycatch = true;
                 }
+                if efn.asyncness.is_some() {
+                    out.include.new = true;
+                    out.include.type_traits = true;
+                    out.include.utility = true;
+                    needs_rust_promise = true;
+                }
                 for arg in &efn.args {
-                    if arg.ty == RustString {
+                    if arg.ty == RustString || is_rust_vec(&arg.ty) {
                         needs_unsafe_bitcopy = true;
                         break;
                     }
                 }
             }
-            Api::RustFunction(efn) if !out.header => {
+            Api::RustFunction(efn) if !out.header || out.direct_calls => {
                 if efn.throws {
                     out.include.exception = true;
                     needs_rust_error = true;
                 }
                 for arg in &efn.args {
-                    if arg.ty != RustString && types.needs_indirect_abi(&arg.ty) {
+                    if arg.ty != RustString
+                        && !is_rust_vec(&arg.ty)
+                        && types.needs_indirect_abi(&arg.ty)
+                    {
                         needs_manually_drop = true;
                         break;
                     }
@@ -173,14 +264,30 @@ fn write_include_cxxbridge(out: &mut OutFile, apis: &[Api], types: &Types) {
         }
     }
 
+    // The Vec bitcopy constructor needs unsafe_bitcopy_t to be complete.
+    if needs_rust_vec {
+        needs_unsafe_bitcopy = true;
+    }
+
+    // Errors in both directions are passed as a Str::Repr.
+    if needs_rust_error || needs_trycatch {
+        out.include.cstdint = true;
+        out.include.string = true;
+        needs_rust_str = true;
+    }
+
     out.begin_block("namespace rust");
     out.begin_block("inline namespace cxxbridge02");
 
     if needs_rust_string
         || needs_rust_str
+        || needs_rust_slice
         || needs_rust_box
+        || needs_rust_vec
         || needs_rust_fn
         || needs_rust_error
+        || needs_rust_promise
+        || needs_rust_arena
         || needs_unsafe_bitcopy
         || needs_manually_drop
         || needs_maybe_uninit
@@ -189,21 +296,32 @@ fn write_include_cxxbridge(out: &mut OutFile, apis: &[Api], types: &Types) {
         writeln!(out, "// #include \"rust/cxx.h\"");
     }
 
-    if needs_rust_string {
+    if needs_rust_string || needs_rust_vec {
         out.next_section();
         writeln!(out, "struct unsafe_bitcopy_t;");
     }
 
+    write_header_section(
+        out,
+        needs_rust_error || needs_trycatch,
+        "CXXBRIDGE02_RUST_COLD",
+    );
     write_header_section(out, needs_rust_string, "CXXBRIDGE02_RUST_STRING");
     write_header_section(out, needs_rust_str, "CXXBRIDGE02_RUST_STR");
+    write_header_section(out, needs_rust_slice, "CXXBRIDGE02_RUST_SLICE");
     write_header_section(out, needs_rust_box, "CXXBRIDGE02_RUST_BOX");
     write_header_section(out, needs_rust_fn, "CXXBRIDGE02_RUST_FN");
     write_header_section(out, needs_rust_error, "CXXBRIDGE02_RUST_ERROR");
+    write_header_section(out, needs_rust_promise, "CXXBRIDGE02_RUST_PROMISE");
+    write_header_section(out, needs_rust_arena, "CXXBRIDGE02_RUST_ARENA");
     write_header_section(out, needs_unsafe_bitcopy, "CXXBRIDGE02_RUST_BITCOPY");
+    write_header_section(out, needs_rust_vec, "CXXBRIDGE02_RUST_VEC");
 
     if needs_manually_drop {
         out.next_section();
         out.include.utility = true;
+        writeln!(out, "#ifndef CXXBRIDGE02_RUST_MANUALLY_DROP");
+        writeln!(out, "#define CXXBRIDGE02_RUST_MANUALLY_DROP");
         writeln!(out, "template <typename T>");
         writeln!(out, "union ManuallyDrop {{");
         writeln!(out, "  T value;");
@@ -213,21 +331,51 @@ fn write_include_cxxbridge(out: &mut OutFile, apis: &[Api], types: &Types) {
         );
         writeln!(out, "  ~ManuallyDrop() {{}}");
         writeln!(out, "}};");
+        writeln!(out, "#endif // CXXBRIDGE02_RUST_MANUALLY_DROP");
     }
 
     if needs_maybe_uninit {
         out.next_section();
+        writeln!(out, "#ifndef CXXBRIDGE02_RUST_MAYBE_UNINIT");
+        writeln!(out, "#define CXXBRIDGE02_RUST_MAYBE_UNINIT");
         writeln!(out, "template <typename T>");
         writeln!(out, "union MaybeUninit {{");
         writeln!(out, "  T value;");
         writeln!(out, "  MaybeUninit() {{}}");
         writeln!(out, "  ~MaybeUninit() {{}}");
         writeln!(out, "}};");
+        writeln!(out, "#endif // CXXBRIDGE02_RUST_MAYBE_UNINIT");
+    }
+
+    if needs_trycatch {
+        // Shared by the catch handlers of all shims in the file, and guarded
+        // so that the bridges of a unity build define it only once.
+        out.next_section();
+        out.include.cstring = true;
+        writeln!(out, "#ifndef CXXBRIDGE02_RUST_CATCH");
+        writeln!(out, "#define CXXBRIDGE02_RUST_CATCH");
+        writeln!(
+            out,
+            "extern \"C\" const char *cxxbridge02$exception(const char *, size_t);",
+        );
+        writeln!(out);
+        writeln!(out, "CXXBRIDGE02_COLD static Str::Repr");
+        writeln!(out, "cxxbridge02$catch(const char *catch$) noexcept {{");
+        writeln!(out, "  size_t len = ::std::strlen(catch$);");
+        writeln!(
+            out,
+            "  return Str::Repr{{cxxbridge02$exception(catch$, len), len}};",
+        );
+        writeln!(out, "}}");
+        writeln!(out, "#endif // CXXBRIDGE02_RUST_CATCH");
     }
 
     out.end_block("namespace cxxbridge02");
 
     if needs_trycatch {
+        out.next_section();
+        writeln!(out, "#ifndef CXXBRIDGE02_RUST_TRYCATCH");
+        writeln!(out, "#define CXXBRIDGE02_RUST_TRYCATCH");
         out.begin_block("namespace behavior");
         out.include.exception = true;
         out.include.type_traits = true;
@@ -248,6 +396,7 @@ fn write_include_cxxbridge(out: &mut OutFile, apis: &[Api], types: &Types) {
         writeln!(out, "  fail(e.what());");
         writeln!(out, "}}");
         out.end_block("namespace behavior");
+        writeln!(out, "#endif // CXXBRIDGE02_RUST_TRYCATCH");
     }
 
     out.end_block("namespace rust");
@@ -264,7 +413,13 @@ fn write_header_section(out: &mut OutFile, needed: bool, section: &str) {
     }
 }
 
-fn write_struct(out: &mut OutFile, strct: &Struct) {
+// Guarded like the generic instantiations, because a translation unit can see
+// the same struct twice: through a bridge's header included by another
+// bridge, or from two bridges compiled together in a unity build.
+fn write_struct(out: &mut OutFile, strct: &Struct, types: &Types) {
+    let guard = format!("CXXBRIDGE02_STRUCT_{}{}", out.namespace, strct.ident);
+    writeln!(out, "#ifndef {}", guard);
+    writeln!(out, "#define {}", guard);
     for line in strct.doc.to_string().lines() {
         writeln!(out, "//{}", line);
     }
@@ -275,39 +430,165 @@ fn write_struct(out: &mut OutFile, strct: &Struct) {
         writeln!(out, "{};", field.ident);
     }
     writeln!(out, "}};");
+    if types.is_flat(strct) {
+        write_struct_layout(out, strct);
+    }
+    writeln!(out, "#endif // {}", guard);
 }
 
-fn write_struct_decl(out: &mut OutFile, ident: &Ident) {
-    writeln!(out, "struct {};", ident);
+// Every field must sit at the next offset aligned for it after the previous
+// field, with the size that the field has in Rust, and the struct must end
+// there rounded up to its alignment. That is the layout #[repr(C)] gives the
+// Rust struct, so this fails the build if anything like a #pragma pack or an
+// atom of a different size in C++ made the two differ.
+fn write_struct_layout(out: &mut OutFile, strct: &Struct) {
+    out.include.cstddef = true;
+    out.include.type_traits = true;
+    let ident = &strct.ident;
+    writeln!(
+        out,
+        "static_assert(::std::is_trivially_copyable<{}>::value, \"\");",
+        ident,
+    );
+    let mut prev = None;
+    for field in &strct.fields {
+        write!(
+            out,
+            "static_assert(offsetof({}, {}) == ",
+            ident, field.ident
+        );
+        match prev {
+            None => write!(out, "0"),
+            Some(prev) => write_aligned_end(out, ident, prev, |out| {
+                write!(out, "alignof(");
+                write_type(out, &field.ty);
+                write!(out, ")");
+            }),
+        }
+        writeln!(out, ", \"\");");
+        prev = Some(field);
+    }
+    if let Some(last) = prev {
+        write!(out, "static_assert(sizeof({}) == ", ident);
+        write_aligned_end(out, ident, last, |out| write!(out, "alignof({})", ident));
+        writeln!(out, ", \"\");");
+    }
 }
 
-fn write_struct_using(out: &mut OutFile, ident: &Ident) {
-    writeln!(out, "using {} = {};", ident, ident);
+// The end of the field rounded up to a multiple of the given alignment.
+fn write_aligned_end(out: &mut OutFile, ident: &Ident, field: &Var, align: impl Fn(&mut OutFile)) {
+    write!(out, "(offsetof({}, {}) + ", ident, field.ident);
+    write_rust_size(out, &field.ty);
+    write!(out, " + ");
+    align(out);
+    write!(out, " - 1) / ");
+    align(out);
+    write!(out, " * ");
+    align(out);
 }
 
-fn write_exception_glue(out: &mut OutFile, apis: &[Api]) {
-    let mut has_cxx_throws = false;
-    for api in apis {
-        if let Api::CxxFunction(efn) = api {
-            if efn.throws {
-                has_cxx_throws = true;
-                break;
-            }
-        }
+fn write_rust_size(out: &mut OutFile, ty: &Type) {
+    match ty {
+        Type::Ident(ident) => match Atom::from(ident) {
+            Some(Bool) | Some(U8) | Some(I8) => write!(out, "1"),
+            Some(U16) | Some(I16) => write!(out, "2"),
+            Some(U32) | Some(I32) | Some(F32) => write!(out, "4"),
+            Some(U64) | Some(I64) | Some(F64) => write!(out, "8"),
+            Some(Usize) | Some(Isize) => write!(out, "sizeof(void *)"),
+            _ => write!(out, "sizeof({})", ident),
+        },
+        _ => unreachable!(),
     }
+}
 
-    if has_cxx_throws {
-        out.next_section();
-        writeln!(
-            out,
-            "const char *cxxbridge02$exception(const char *, size_t);",
-        );
+// An opaque Rust type with a declared #[layout] is held by value in C++, in
+// storage that the Rust side asserts it fits in. Rust values move by memcpy
+// and have no empty state, so the special members call into Rust: the default
+// constructor makes the Default value in place, and a move takes the value out
+// of the other object and leaves a default one for its destructor.
+fn write_rust_type(out: &mut OutFile, ety: &ExternType) {
+    let ident = &ety.ident;
+    let layout = ety.layout.as_ref().unwrap();
+    let guard = format!("CXXBRIDGE02_RUST_TYPE_{}{}", out.namespace, ident);
+    writeln!(out, "#ifndef {}", guard);
+    writeln!(out, "#define {}", guard);
+    for line in ety.doc.to_string().lines() {
+        writeln!(out, "//{}", line);
     }
+    writeln!(out, "struct {} final {{", ident);
+    writeln!(out, "  {}() noexcept;", ident);
+    writeln!(out, "  {0}({0} &&other) noexcept;", ident);
+    writeln!(out, "  ~{}() noexcept;", ident);
+    writeln!(out, "  {0} &operator=({0} &&other) noexcept;", ident);
+    writeln!(out);
+    writeln!(out, "private:");
+    writeln!(
+        out,
+        "  alignas({}) unsigned char repr[{}];",
+        layout.align, layout.size,
+    );
+    writeln!(out, "}};");
+    writeln!(out, "#endif // {}", guard);
+}
+
+fn write_rust_type_decl(out: &mut OutFile, ety: &ExternType) {
+    let ident = &ety.ident;
+    let link_prefix = format!("cxxbridge02$rust_type${}{}$", out.namespace, ident);
+    writeln!(out, "void {}new({} *self) noexcept;", link_prefix, ident);
+    writeln!(
+        out,
+        "void {}take({1} *self, {1} *other) noexcept;",
+        link_prefix, ident,
+    );
+    writeln!(
+        out,
+        "void {}assign({1} *self, {1} *other) noexcept;",
+        link_prefix, ident,
+    );
+    writeln!(out, "void {}drop({} *self) noexcept;", link_prefix, ident);
+}
+
+fn write_rust_type_impl(out: &mut OutFile, ety: &ExternType) {
+    let ident = &ety.ident;
+    let link_prefix = format!("cxxbridge02$rust_type${}{}$", out.namespace, ident);
+    let inline = if out.direct_calls { "inline " } else { "" };
+    writeln!(out, "{}{1}::{1}() noexcept {{", inline, ident);
+    writeln!(out, "  {}new(this);", link_prefix);
+    writeln!(out, "}}");
+    writeln!(out);
+    writeln!(out, "{}{1}::{1}({1} &&other) noexcept {{", inline, ident);
+    writeln!(out, "  {}take(this, &other);", link_prefix);
+    writeln!(out, "}}");
+    writeln!(out);
+    writeln!(out, "{}{1}::~{1}() noexcept {{", inline, ident);
+    writeln!(out, "  {}drop(this);", link_prefix);
+    writeln!(out, "}}");
+    writeln!(out);
+    writeln!(
+        out,
+        "{}{1} &{1}::operator=({1} &&other) noexcept {{",
+        inline, ident,
+    );
+    writeln!(out, "  if (this != &other) {{");
+    writeln!(out, "    {}assign(this, &other);", link_prefix);
+    writeln!(out, "  }}");
+    writeln!(out, "  return *this;");
+    writeln!(out, "}}");
+}
+
+fn write_struct_decl(out: &mut OutFile, ident: &Ident) {
+    writeln!(out, "struct {};", ident);
+}
+
+fn write_struct_using(out: &mut OutFile, ident: &Ident) {
+    writeln!(out, "using {} = {};", ident, ident);
 }
 
 fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
     if efn.throws {
         write!(out, "::rust::Str::Repr ");
+    } else if efn.asyncness.is_some() {
+        write!(out, "void ");
     } else {
         write_extern_return_type_space(out, &efn.ret, types);
     }
@@ -316,9 +597,14 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
         if i > 0 {
             write!(out, ", ");
         }
-        if arg.ty == RustString {
+        if arg.ty == RustString || is_rust_vec(&arg.ty) {
             write!(out, "const ");
         }
+        if let Type::Fn(_) = &arg.ty {
+            write_type(out, &arg.ty);
+            write!(out, "::Repr {}", arg.ident);
+            continue;
+        }
         write_extern_arg(out, arg, types);
     }
     let indirect_return = indirect_return(efn, types);
@@ -329,17 +615,23 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
         write_indirect_return_type_space(out, efn.ret.as_ref().unwrap());
         write!(out, "*return$");
     }
-    writeln!(out, ") noexcept {{");
-    write!(out, "  ");
-    write_return_type(out, &efn.ret);
-    write!(out, "(*{}$)(", efn.ident);
-    for (i, arg) in efn.args.iter().enumerate() {
-        if i > 0 {
+    if efn.asyncness.is_some() {
+        if !efn.args.is_empty() {
             write!(out, ", ");
         }
-        write_type(out, &arg.ty);
+        write_promise_type(out, &efn.ret);
+        write!(out, "::Repr *promise$");
+    }
+    writeln!(out, ") noexcept {{");
+    if let Some(item) = &efn.batch {
+        write_cxx_batch_loop(out, efn, item);
+        return;
+    }
+    if !out.direct_calls {
+        write!(out, "  ");
+        write_cxx_function_pointer(out, efn, &format!("{}$", efn.ident));
+        writeln!(out, " = {};", efn.ident);
     }
-    writeln!(out, ") = {};", efn.ident);
     write!(out, "  ");
     if efn.throws {
         writeln!(out, "::rust::Str::Repr throw$;");
@@ -351,15 +643,27 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
         write!(out, "new (return$) ");
         write_indirect_return_type(out, efn.ret.as_ref().unwrap());
         write!(out, "(");
-    } else if efn.ret.is_some() {
+    } else if efn.ret.is_some() && efn.asyncness.is_none() {
         write!(out, "return ");
     }
     match &efn.ret {
         Some(Type::Ref(_)) => write!(out, "&"),
         Some(Type::Str(_)) if !indirect_return => write!(out, "::rust::Str::Repr("),
+        Some(ty @ Type::SliceRef(_)) if !indirect_return => {
+            write_type(out, ty);
+            write!(out, "::Repr(");
+        }
         _ => {}
     }
-    write!(out, "{}$(", efn.ident);
+    if out.direct_calls {
+        // Still checks the signature against the declaration, like the local
+        // function pointer does, but the callee is a constant.
+        write!(out, "static_cast<");
+        write_cxx_function_pointer(out, efn, "");
+        write!(out, ">({})(", efn.ident);
+    } else {
+        write!(out, "{}$(", efn.ident);
+    }
     for (i, arg) in efn.args.iter().enumerate() {
         if i > 0 {
             write!(out, ", ");
@@ -367,7 +671,7 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
         if let Type::RustBox(_) = &arg.ty {
             write_type(out, &arg.ty);
             write!(out, "::from_raw({})", arg.ident);
-        } else if let Type::UniquePtr(_) = &arg.ty {
+        } else if let Type::UniquePtr(_) | Type::Fn(_) = &arg.ty {
             write_type(out, &arg.ty);
             write!(out, "({})", arg.ident);
         } else if arg.ty == RustString {
@@ -376,6 +680,9 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
                 "::rust::String(::rust::unsafe_bitcopy, *{})",
                 arg.ident,
             );
+        } else if is_rust_vec(&arg.ty) {
+            write_type(out, &arg.ty);
+            write!(out, "(::rust::unsafe_bitcopy, *{})", arg.ident);
         } else if types.needs_indirect_abi(&arg.ty) {
             out.include.utility = true;
             write!(out, "::std::move(*{})", arg.ident);
@@ -383,11 +690,18 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
             write!(out, "{}", arg.ident);
         }
     }
+    if efn.asyncness.is_some() {
+        if !efn.args.is_empty() {
+            write!(out, ", ");
+        }
+        write_promise_type(out, &efn.ret);
+        write!(out, "(*promise$)");
+    }
     write!(out, ")");
     match &efn.ret {
         Some(Type::RustBox(_)) => write!(out, ".into_raw()"),
         Some(Type::UniquePtr(_)) => write!(out, ".release()"),
-        Some(Type::Str(_)) if !indirect_return => write!(out, ")"),
+        Some(Type::Str(_)) | Some(Type::SliceRef(_)) if !indirect_return => write!(out, ")"),
         _ => {}
     }
     if indirect_return {
@@ -395,15 +709,10 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
     }
     writeln!(out, ";");
     if efn.throws {
-        out.include.cstring = true;
         writeln!(out, "        throw$.ptr = nullptr;");
         writeln!(out, "      }},");
         writeln!(out, "      [&](const char *catch$) noexcept {{");
-        writeln!(out, "        throw$.len = ::std::strlen(catch$);");
-        writeln!(
-            out,
-            "        throw$.ptr = cxxbridge02$exception(catch$, throw$.len);",
-        );
+        writeln!(out, "        throw$ = ::rust::cxxbridge02$catch(catch$);");
         writeln!(out, "      }});");
         writeln!(out, "  return throw$;");
     }
@@ -416,6 +725,96 @@ fn write_cxx_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
     }
 }
 
+// Body of the shim of a batched C++ function. The Rust caller has checked that
+// all slices are equally long, so one exception handler and no per-item call
+// across the bridge cover the whole batch.
+fn write_cxx_batch_loop(out: &mut OutFile, efn: &ExternFn, item: &Ident) {
+    let mut indent = "  ";
+    if efn.throws {
+        writeln!(out, "  ::rust::Str::Repr throw$;");
+        writeln!(out, "  ::rust::behavior::trycatch(");
+        writeln!(out, "      [&] {{");
+        indent = "        ";
+    }
+    writeln!(
+        out,
+        "{}for (size_t i$ = 0; i$ < {}.len; i$++) {{",
+        indent, efn.args[0].ident,
+    );
+    write!(out, "{}  ", indent);
+    let mut item_args = Vec::new();
+    for arg in &efn.args {
+        if arg.ident == "out" {
+            write!(out, "out.ptr[i$] = ");
+        } else {
+            item_args.push(format!("{}.ptr[i$]", arg.ident));
+        }
+    }
+    writeln!(out, "{}({});", item, item_args.join(", "));
+    writeln!(out, "{}}}", indent);
+    if efn.throws {
+        writeln!(out, "        throw$.ptr = nullptr;");
+        writeln!(out, "      }},");
+        writeln!(out, "      [&](const char *catch$) noexcept {{");
+        writeln!(out, "        throw$ = ::rust::cxxbridge02$catch(catch$);");
+        writeln!(out, "      }});");
+        writeln!(out, "  return throw$;");
+    }
+    writeln!(out, "}}");
+}
+
+fn write_cxx_function_pointer(out: &mut OutFile, efn: &ExternFn, name: &str) {
+    if efn.asyncness.is_some() {
+        write!(out, "void ");
+    } else {
+        write_return_type(out, &efn.ret);
+    }
+    write!(out, "(*{})(", name);
+    for (i, arg) in efn.args.iter().enumerate() {
+        if i > 0 {
+            write!(out, ", ");
+        }
+        write_type(out, &arg.ty);
+    }
+    if efn.asyncness.is_some() {
+        if !efn.args.is_empty() {
+            write!(out, ", ");
+        }
+        write_promise_type(out, &efn.ret);
+    }
+    write!(out, ")");
+}
+
+// The C++ implementation of an async function takes this as its last argument
+// in place of returning a value.
+fn write_promise_type(out: &mut OutFile, ret: &Option<Type>) {
+    write!(out, "::rust::Promise<");
+    match ret {
+        Some(ty) => write_type(out, ty),
+        None => write!(out, "void"),
+    }
+    write!(out, ">");
+}
+
+// The C++ caller of an async function implemented in Rust passes this as its
+// last argument, to be called with the result.
+fn write_callback_type(out: &mut OutFile, ret: &Option<Type>) {
+    write!(out, "::rust::Fn<void(");
+    if let Some(ty) = ret {
+        write_type(out, ty);
+    }
+    write!(out, ")>");
+}
+
+fn write_promise_callback_type(out: &mut OutFile, ret: &Option<Type>) {
+    write!(out, "::rust::PromiseCallback<");
+    match ret {
+        Some(ty) => write_type(out, ty),
+        None => write!(out, "void"),
+    }
+    write!(out, ">");
+}
+
 fn write_function_pointer_trampoline(
     out: &mut OutFile,
     efn: &ExternFn,
@@ -433,10 +832,54 @@ fn write_function_pointer_trampoline(
     write_rust_function_shim_impl(out, &c_trampoline, f, types, &r_trampoline, indirect_call);
 }
 
+// Calls a C++ callable passed to a Rust function on behalf of the Rust closure
+// that stands in for it. The Rust side only holds the address of the Fn.
+fn write_callable_thunk(out: &mut OutFile, efn: &ExternFn, var: &Ident, ty: &Type) {
+    let f = match ty {
+        Type::Fn(f) => f,
+        _ => unreachable!(),
+    };
+    out.next_section();
+    write_return_type(out, &f.ret);
+    write!(
+        out,
+        "{}cxxbridge02${}${}$2(const ",
+        out.namespace, efn.ident, var
+    );
+    write_type(out, ty);
+    write!(out, " &extern$");
+    for arg in &f.args {
+        write!(out, ", ");
+        write_type_space(out, &arg.ty);
+        write!(out, "{}", arg.ident);
+    }
+    writeln!(out, ") noexcept {{");
+    write!(out, "  ");
+    if f.ret.is_some() {
+        write!(out, "return ");
+    }
+    write!(out, "extern$(");
+    for (i, arg) in f.args.iter().enumerate() {
+        if i > 0 {
+            write!(out, ", ");
+        }
+        write!(out, "{}", arg.ident);
+    }
+    writeln!(out, ");");
+    writeln!(out, "}}");
+}
+
 fn write_rust_function_decl(out: &mut OutFile, efn: &ExternFn, types: &Types) {
     let link_name = format!("{}cxxbridge02${}", out.namespace, efn.ident);
     let indirect_call = false;
     write_rust_function_decl_impl(out, &link_name, efn, types, indirect_call);
+    if !out.header {
+        for arg in &efn.args {
+            if let Type::Fn(_) = &arg.ty {
+                write_callable_thunk(out, efn, &arg.ident, &arg.ty);
+            }
+        }
+    }
 }
 
 fn write_rust_function_decl_impl(
@@ -448,6 +891,8 @@ fn write_rust_function_decl_impl(
 ) {
     if sig.throws {
         write!(out, "::rust::Str::Repr ");
+    } else if sig.asyncness.is_some() {
+        write!(out, "void ");
     } else {
         write_extern_return_type_space(out, &sig.ret, types);
     }
@@ -468,6 +913,13 @@ fn write_rust_function_decl_impl(
         write!(out, "*return$");
         needs_comma = true;
     }
+    if sig.asyncness.is_some() {
+        if needs_comma {
+            write!(out, ", ");
+        }
+        write!(out, "::rust::PromiseBase::Repr *promise$");
+        needs_comma = true;
+    }
     if indirect_call {
         if needs_comma {
             write!(out, ", ");
@@ -484,6 +936,9 @@ fn write_rust_function_shim(out: &mut OutFile, efn: &ExternFn, types: &Types) {
     let local_name = efn.ident.to_string();
     let invoke = format!("{}cxxbridge02${}", out.namespace, efn.ident);
     let indirect_call = false;
+    if out.direct_calls {
+        write!(out, "inline ");
+    }
     write_rust_function_shim_impl(out, &local_name, efn, types, &invoke, indirect_call);
 }
 
@@ -495,7 +950,11 @@ fn write_rust_function_shim_impl(
     invoke: &str,
     indirect_call: bool,
 ) {
-    write_return_type(out, &sig.ret);
+    if sig.asyncness.is_some() {
+        write!(out, "void ");
+    } else {
+        write_return_type(out, &sig.ret);
+    }
     write!(out, "{}(", local_name);
     for (i, arg) in sig.args.iter().enumerate() {
         if i > 0 {
@@ -504,36 +963,50 @@ fn write_rust_function_shim_impl(
         write_type_space(out, &arg.ty);
         write!(out, "{}", arg.ident);
     }
-    if indirect_call {
+    if sig.asyncness.is_some() {
         if !sig.args.is_empty() {
             write!(out, ", ");
         }
+        write_callback_type(out, &sig.ret);
+        write!(out, " done$");
+    }
+    if indirect_call {
+        if !sig.args.is_empty() || sig.asyncness.is_some() {
+            write!(out, ", ");
+        }
         write!(out, "void *extern$");
     }
     write!(out, ")");
     if !sig.throws {
         write!(out, " noexcept");
     }
-    if out.header {
+    if out.header && !out.direct_calls {
         writeln!(out, ";");
     } else {
         writeln!(out, " {{");
         for arg in &sig.args {
-            if arg.ty != RustString && types.needs_indirect_abi(&arg.ty) {
+            if arg.ty != RustString && !is_rust_vec(&arg.ty) && types.needs_indirect_abi(&arg.ty) {
                 out.include.utility = true;
                 write!(out, "  ::rust::ManuallyDrop<");
                 write_type(out, &arg.ty);
                 writeln!(out, "> {}$(::std::move({0}));", arg.ident);
             }
         }
+        if sig.asyncness.is_some() {
+            write!(out, "  ::rust::PromiseBase::Repr promise$ = ");
+            write_promise_callback_type(out, &sig.ret);
+            writeln!(out, "::repr(::std::move(done$));");
+        }
         write!(out, "  ");
+        // An async function's result goes to done$, not to the caller.
+        let ret = sig.ret.as_ref().filter(|_| sig.asyncness.is_none());
         let indirect_return = indirect_return(sig, types);
         if indirect_return {
             write!(out, "::rust::MaybeUninit<");
             write_type(out, sig.ret.as_ref().unwrap());
             writeln!(out, "> return$;");
             write!(out, "  ");
-        } else if let Some(ret) = &sig.ret {
+        } else if let Some(ret) = ret {
             write!(out, "return ");
             match ret {
                 Type::RustBox(_) => {
@@ -558,6 +1031,10 @@ fn write_rust_function_shim_impl(
             }
             match &arg.ty {
                 Type::Str(_) => write!(out, "::rust::Str::Repr("),
+                Type::SliceRef(_) => {
+                    write_type(out, &arg.ty);
+                    write!(out, "::Repr(");
+                }
                 ty if types.needs_indirect_abi(ty) => write!(out, "&"),
                 _ => {}
             }
@@ -565,8 +1042,10 @@ fn write_rust_function_shim_impl(
             match &arg.ty {
                 Type::RustBox(_) => write!(out, ".into_raw()"),
                 Type::UniquePtr(_) => write!(out, ".release()"),
-                Type::Str(_) => write!(out, ")"),
-                ty if ty != RustString && types.needs_indirect_abi(ty) => write!(out, "$.value"),
+                Type::Str(_) | Type::SliceRef(_) => write!(out, ")"),
+                ty if ty != RustString && !is_rust_vec(ty) && types.needs_indirect_abi(ty) => {
+                    write!(out, "$.value")
+                }
                 _ => {}
             }
         }
@@ -576,22 +1055,28 @@ fn write_rust_function_shim_impl(
             }
             write!(out, "&return$.value");
         }
+        if sig.asyncness.is_some() {
+            if !sig.args.is_empty() {
+                write!(out, ", ");
+            }
+            write!(out, "&promise$");
+        }
         if indirect_call {
-            if !sig.args.is_empty() || indirect_return {
+            if !sig.args.is_empty() || indirect_return || sig.asyncness.is_some() {
                 write!(out, ", ");
             }
             write!(out, "extern$");
         }
         write!(out, ")");
-        if let Some(ret) = &sig.ret {
+        if let Some(ret) = ret {
             if let Type::RustBox(_) | Type::UniquePtr(_) = ret {
                 write!(out, ")");
             }
         }
         writeln!(out, ";");
         if sig.throws {
-            writeln!(out, "  if (error$.ptr) {{");
-            writeln!(out, "    throw ::rust::Error(error$);");
+            writeln!(out, "  if (CXXBRIDGE02_UNLIKELY(error$.ptr)) {{");
+            writeln!(out, "    ::rust::Error::raise(error$);");
             writeln!(out, "  }}");
         }
         if indirect_return {
@@ -610,9 +1095,11 @@ fn write_return_type(out: &mut OutFile, ty: &Option<Type>) {
 }
 
 fn indirect_return(sig: &Signature, types: &Types) -> bool {
-    sig.ret
-        .as_ref()
-        .map_or(false, |ret| sig.throws || types.needs_indirect_abi(ret))
+    sig.asyncness.is_none()
+        && sig
+            .ret
+            .as_ref()
+            .map_or(false, |ret| sig.throws || types.needs_indirect_abi(ret))
 }
 
 fn write_indirect_return_type(out: &mut OutFile, ty: &Type) {
@@ -629,6 +1116,10 @@ fn write_indirect_return_type(out: &mut OutFile, ty: &Type) {
             write!(out, " *");
         }
         Type::Str(_) => write!(out, "::rust::Str::Repr"),
+        Type::SliceRef(_) => {
+            write_type(out, ty);
+            write!(out, "::Repr");
+        }
         _ => write_type(out, ty),
     }
 }
@@ -637,7 +1128,7 @@ fn write_indirect_return_type_space(out: &mut OutFile, ty: &Type) {
     write_indirect_return_type(out, ty);
     match ty {
         Type::RustBox(_) | Type::UniquePtr(_) | Type::Ref(_) => {}
-        Type::Str(_) => write!(out, " "),
+        Type::Str(_) | Type::SliceRef(_) => write!(out, " "),
         _ => write_space_after_type(out, ty),
     }
 }
@@ -656,6 +1147,10 @@ fn write_extern_return_type_space(out: &mut OutFile, ty: &Option<Type>, types: &
             write!(out, " *");
         }
         Some(Type::Str(_)) => write!(out, "::rust::Str::Repr "),
+        Some(ty @ Type::SliceRef(_)) => {
+            write_type(out, ty);
+            write!(out, "::Repr ");
+        }
         Some(ty) if types.needs_indirect_abi(ty) => write!(out, "void "),
         _ => write_return_type(out, ty),
     }
@@ -668,6 +1163,15 @@ fn write_extern_arg(out: &mut OutFile, arg: &Var, types: &Types) {
             write!(out, "*");
         }
         Type::Str(_) => write!(out, "::rust::Str::Repr "),
+        Type::SliceRef(_) => {
+            write_type(out, &arg.ty);
+            write!(out, "::Repr ");
+        }
+        Type::Fn(_) => {
+            write!(out, "const ");
+            write_type(out, &arg.ty);
+            write!(out, " &");
+        }
         _ => write_type_space(out, &arg.ty),
     }
     if types.needs_indirect_abi(&arg.ty) {
@@ -693,7 +1197,10 @@ fn write_type(out: &mut OutFile, ty: &Type) {
             Some(F32) => write!(out, "float"),
             Some(F64) => write!(out, "double"),
             Some(CxxString) => write!(out, "::std::string"),
+            Some(CxxIstream) => write!(out, "::std::istream"),
+            Some(CxxOstream) => write!(out, "::std::ostream"),
             Some(RustString) => write!(out, "::rust::String"),
+            Some(Arena) => write!(out, "::rust::Arena"),
             None => write!(out, "{}", ident),
         },
         Type::RustBox(ty) => {
@@ -701,11 +1208,31 @@ fn write_type(out: &mut OutFile, ty: &Type) {
             write_type(out, &ty.inner);
             write!(out, ">");
         }
+        Type::RustVec(ty) => {
+            write!(out, "::rust::Vec<");
+            write_type(out, &ty.inner);
+            write!(out, ">");
+        }
         Type::UniquePtr(ptr) => {
             write!(out, "::std::unique_ptr<");
             write_type(out, &ptr.inner);
             write!(out, ">");
         }
+        Type::SharedPtr(ptr) => {
+            write!(out, "::std::shared_ptr<");
+            write_type(out, &ptr.inner);
+            write!(out, ">");
+        }
+        Type::WeakPtr(ptr) => {
+            write!(out, "::std::weak_ptr<");
+            write_type(out, &ptr.inner);
+            write!(out, ">");
+        }
+        Type::CxxVector(ty) => {
+            write!(out, "::std::vector<");
+            write_type(out, &ty.inner);
+            write!(out, ">");
+        }
         Type::Ref(r) => {
             if r.mutability.is_none() {
                 write!(out, "const ");
@@ -716,6 +1243,17 @@ fn write_type(out: &mut OutFile, ty: &Type) {
         Type::Str(_) => {
             write!(out, "::rust::Str");
         }
+        Type::SliceRef(r) => {
+            write!(out, "::rust::Slice<");
+            if r.mutability.is_none() {
+                write!(out, "const ");
+            }
+            match &r.inner {
+                Type::Slice(slice) => write_type(out, &slice.inner),
+                _ => unreachable!(),
+            }
+            write!(out, ">");
+        }
         Type::Fn(f) => {
             write!(out, "::rust::{}<", if f.throws { "TryFn" } else { "Fn" });
             match &f.ret {
@@ -731,7 +1269,7 @@ fn write_type(out: &mut OutFile, ty: &Type) {
             }
             write!(out, ")>");
         }
-        Type::Void(_) => unreachable!(),
+        Type::Slice(_) | Type::Void(_) => unreachable!(),
     }
 }
 
@@ -742,11 +1280,18 @@ fn write_type_space(out: &mut OutFile, ty: &Type) {
 
 fn write_space_after_type(out: &mut OutFile, ty: &Type) {
     match ty {
-        Type::Ident(_) | Type::RustBox(_) | Type::UniquePtr(_) | Type::Str(_) | Type::Fn(_) => {
-            write!(out, " ")
-        }
+        Type::Ident(_)
+        | Type::RustBox(_)
+        | Type::RustVec(_)
+        | Type::UniquePtr(_)
+        | Type::SharedPtr(_)
+        | Type::WeakPtr(_)
+        | Type::CxxVector(_)
+        | Type::Str(_)
+        | Type::SliceRef(_)
+        | Type::Fn(_) => write!(out, " "),
         Type::Ref(_) => {}
-        Type::Void(_) => unreachable!(),
+        Type::Slice(_) | Type::Void(_) => unreachable!(),
     }
 }
 
@@ -762,6 +1307,13 @@ fn write_generic_instantiations(out: &mut OutFile, types: &Types) {
                 out.next_section();
                 write_rust_box_extern(out, inner);
             }
+        } else if let Type::RustVec(ty) = ty {
+            if let Type::Ident(inner) = &ty.inner {
+                if Atom::from(inner).is_none() {
+                    out.next_section();
+                    write_rust_vec_extern(out, inner);
+                }
+            }
         } else if let Type::UniquePtr(ptr) = ty {
             if let Type::Ident(inner) = &ptr.inner {
                 if allow_unique_ptr(inner) {
@@ -769,6 +1321,32 @@ fn write_generic_instantiations(out: &mut OutFile, types: &Types) {
                     write_unique_ptr(out, inner);
                 }
             }
+        } else if let Type::SharedPtr(ptr) = ty {
+            if let Type::Ident(inner) = &ptr.inner {
+                if allow_unique_ptr(inner) {
+                    out.next_section();
+                    write_shared_ptr(out, inner);
+                }
+            }
+        } else if let Type::WeakPtr(ptr) = ty {
+            if let Type::Ident(inner) = &ptr.inner {
+                if allow_unique_ptr(inner) {
+                    // Upgrading makes a shared_ptr, so its functions are
+                    // needed even if the bridge never mentions SharedPtr<T>.
+                    // The guard skips them if they are written twice.
+                    out.next_section();
+                    write_shared_ptr(out, inner);
+                    out.next_section();
+                    write_weak_ptr(out, inner);
+                }
+            }
+        } else if let Type::CxxVector(ty) = ty {
+            if let Type::Ident(inner) = &ty.inner {
+                if Atom::from(inner).is_none() {
+                    out.next_section();
+                    write_cxx_vector(out, inner);
+                }
+            }
         }
     }
     out.end_block("extern \"C\"");
@@ -780,6 +1358,12 @@ fn write_generic_instantiations(out: &mut OutFile, types: &Types) {
             if let Type::Ident(inner) = &ty.inner {
                 write_rust_box_impl(out, inner);
             }
+        } else if let Type::RustVec(ty) = ty {
+            if let Type::Ident(inner) = &ty.inner {
+                if Atom::from(inner).is_none() {
+                    write_rust_vec_impl(out, inner);
+                }
+            }
         }
     }
     out.end_block("namespace cxxbridge02");
@@ -819,6 +1403,8 @@ fn write_rust_box_impl(out: &mut OutFile, ident: &Ident) {
     inner += &ident.to_string();
     let instance = inner.replace("::", "$");
 
+    writeln!(out, "#ifndef CXXBRIDGE02_RUST_BOX_IMPL_{}", instance);
+    writeln!(out, "#define CXXBRIDGE02_RUST_BOX_IMPL_{}", instance);
     writeln!(out, "template <>");
     writeln!(out, "void Box<{}>::uninit() noexcept {{", inner);
     writeln!(out, "  return cxxbridge02$box${}$uninit(this);", instance);
@@ -828,6 +1414,131 @@ fn write_rust_box_impl(out: &mut OutFile, ident: &Ident) {
     writeln!(out, "void Box<{}>::drop() noexcept {{", inner);
     writeln!(out, "  return cxxbridge02$box${}$drop(this);", instance);
     writeln!(out, "}}");
+    writeln!(out, "#endif // CXXBRIDGE02_RUST_BOX_IMPL_{}", instance);
+}
+
+fn write_rust_vec_extern(out: &mut OutFile, ident: &Ident) {
+    let mut inner = String::new();
+    for name in &out.namespace {
+        inner += name;
+        inner += "::";
+    }
+    inner += &ident.to_string();
+    let instance = inner.replace("::", "$");
+
+    writeln!(out, "#ifndef CXXBRIDGE02_RUST_VEC_{}", instance);
+    writeln!(out, "#define CXXBRIDGE02_RUST_VEC_{}", instance);
+    writeln!(
+        out,
+        "void cxxbridge02$rust_vec${}$new(::rust::Vec<{}> *ptr) noexcept;",
+        instance, inner,
+    );
+    writeln!(
+        out,
+        "void cxxbridge02$rust_vec${}$drop(::rust::Vec<{}> *ptr) noexcept;",
+        instance, inner,
+    );
+    writeln!(
+        out,
+        "size_t cxxbridge02$rust_vec${}$len(const ::rust::Vec<{}> *ptr) noexcept;",
+        instance, inner,
+    );
+    writeln!(
+        out,
+        "const {} *cxxbridge02$rust_vec${}$data(const ::rust::Vec<{0}> *ptr) noexcept;",
+        inner, instance,
+    );
+    writeln!(
+        out,
+        "bool cxxbridge02$rust_vec${}$reserve_total(::rust::Vec<{}> *ptr, size_t cap) noexcept;",
+        instance, inner,
+    );
+    writeln!(
+        out,
+        "void cxxbridge02$rust_vec${}$set_len(::rust::Vec<{}> *ptr, size_t len) noexcept;",
+        instance, inner,
+    );
+    writeln!(
+        out,
+        "bool cxxbridge02$rust_vec${}$layout(size_t *ptr, size_t *len, size_t *cap) noexcept;",
+        instance,
+    );
+    writeln!(out, "#endif // CXXBRIDGE02_RUST_VEC_{}", instance);
+}
+
+fn write_rust_vec_impl(out: &mut OutFile, ident: &Ident) {
+    let mut inner = String::new();
+    for name in &out.namespace {
+        inner += name;
+        inner += "::";
+    }
+    inner += &ident.to_string();
+    let instance = inner.replace("::", "$");
+
+    writeln!(out, "#ifndef CXXBRIDGE02_RUST_VEC_IMPL_{}", instance);
+    writeln!(out, "#define CXXBRIDGE02_RUST_VEC_IMPL_{}", instance);
+    writeln!(out, "template <>");
+    writeln!(out, "void Vec<{}>::init() noexcept {{", inner);
+    writeln!(out, "  return cxxbridge02$rust_vec${}$new(this);", instance);
+    writeln!(out, "}}");
+
+    writeln!(out, "template <>");
+    writeln!(out, "void Vec<{}>::drop() noexcept {{", inner);
+    writeln!(
+        out,
+        "  return cxxbridge02$rust_vec${}$drop(this);",
+        instance
+    );
+    writeln!(out, "}}");
+
+    writeln!(out, "template <>");
+    writeln!(out, "size_t Vec<{}>::ffi_size() const noexcept {{", inner);
+    writeln!(out, "  return cxxbridge02$rust_vec${}$len(this);", instance);
+    writeln!(out, "}}");
+
+    writeln!(out, "template <>");
+    writeln!(
+        out,
+        "const {} *Vec<{0}>::ffi_data() const noexcept {{",
+        inner
+    );
+    writeln!(
+        out,
+        "  return cxxbridge02$rust_vec${}$data(this);",
+        instance
+    );
+    writeln!(out, "}}");
+
+    writeln!(out, "template <>");
+    writeln!(
+        out,
+        "bool Vec<{}>::ffi_reserve_total(size_t cap) noexcept {{",
+        inner
+    );
+    writeln!(
+        out,
+        "  return cxxbridge02$rust_vec${}$reserve_total(this, cap);",
+        instance,
+    );
+    writeln!(out, "}}");
+
+    writeln!(out, "template <>");
+    writeln!(out, "void Vec<{}>::set_len(size_t len) noexcept {{", inner);
+    writeln!(
+        out,
+        "  return cxxbridge02$rust_vec${}$set_len(this, len);",
+        instance,
+    );
+    writeln!(out, "}}");
+
+    writeln!(out, "template <>");
+    writeln!(out, "VecLayout Vec<{}>::layout =", inner);
+    writeln!(
+        out,
+        "    VecLayout::probe(cxxbridge02$rust_vec${}$layout);",
+        instance,
+    );
+    writeln!(out, "#endif // CXXBRIDGE02_RUST_VEC_IMPL_{}", instance);
 }
 
 fn write_unique_ptr(out: &mut OutFile, ident: &Ident) {
@@ -901,3 +1612,195 @@ fn write_unique_ptr(out: &mut OutFile, ident: &Ident) {
     writeln!(out, "}}");
     writeln!(out, "#endif // CXXBRIDGE02_UNIQUE_PTR_{}", instance);
 }
+
+fn write_shared_ptr(out: &mut OutFile, ident: &Ident) {
+    out.include.new = true;
+
+    let mut inner = String::new();
+    for name in &out.namespace {
+        inner += name;
+        inner += "::";
+    }
+    inner += &ident.to_string();
+    let instance = inner.replace("::", "$");
+
+    writeln!(out, "#ifndef CXXBRIDGE02_SHARED_PTR_{}", instance);
+    writeln!(out, "#define CXXBRIDGE02_SHARED_PTR_{}", instance);
+    writeln!(
+        out,
+        "static_assert(sizeof(::std::shared_ptr<{}>) == 2 * sizeof(void *), \"\");",
+        inner,
+    );
+    writeln!(
+        out,
+        "static_assert(alignof(::std::shared_ptr<{}>) == alignof(void *), \"\");",
+        inner,
+    );
+    writeln!(
+        out,
+        "void cxxbridge02$shared_ptr${}$null(::std::shared_ptr<{}> *ptr) noexcept {{",
+        instance, inner,
+    );
+    writeln!(out, "  new (ptr) ::std::shared_ptr<{}>();", inner);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$shared_ptr${}$clone(const ::std::shared_ptr<{}> &self, ::std::shared_ptr<{}> *ptr) noexcept {{",
+        instance, inner, inner,
+    );
+    writeln!(out, "  new (ptr) ::std::shared_ptr<{}>(self);", inner);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "const {} *cxxbridge02$shared_ptr${}$get(const ::std::shared_ptr<{}> &self) noexcept {{",
+        inner, instance, inner,
+    );
+    writeln!(out, "  return self.get();");
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$shared_ptr${}$drop(::std::shared_ptr<{}> *self) noexcept {{",
+        instance, inner,
+    );
+    writeln!(out, "  self->~shared_ptr();");
+    writeln!(out, "}}");
+    writeln!(out, "#endif // CXXBRIDGE02_SHARED_PTR_{}", instance);
+}
+
+fn write_weak_ptr(out: &mut OutFile, ident: &Ident) {
+    out.include.new = true;
+
+    let mut inner = String::new();
+    for name in &out.namespace {
+        inner += name;
+        inner += "::";
+    }
+    inner += &ident.to_string();
+    let instance = inner.replace("::", "$");
+
+    writeln!(out, "#ifndef CXXBRIDGE02_WEAK_PTR_{}", instance);
+    writeln!(out, "#define CXXBRIDGE02_WEAK_PTR_{}", instance);
+    writeln!(
+        out,
+        "static_assert(sizeof(::std::weak_ptr<{}>) == 2 * sizeof(void *), \"\");",
+        inner,
+    );
+    writeln!(
+        out,
+        "static_assert(alignof(::std::weak_ptr<{}>) == alignof(void *), \"\");",
+        inner,
+    );
+    writeln!(
+        out,
+        "void cxxbridge02$weak_ptr${}$null(::std::weak_ptr<{}> *ptr) noexcept {{",
+        instance, inner,
+    );
+    writeln!(out, "  new (ptr) ::std::weak_ptr<{}>();", inner);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$weak_ptr${}$clone(const ::std::weak_ptr<{}> &self, ::std::weak_ptr<{}> *ptr) noexcept {{",
+        instance, inner, inner,
+    );
+    writeln!(out, "  new (ptr) ::std::weak_ptr<{}>(self);", inner);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$weak_ptr${}$downgrade(const ::std::shared_ptr<{}> &shared, ::std::weak_ptr<{}> *weak) noexcept {{",
+        instance, inner, inner,
+    );
+    writeln!(out, "  new (weak) ::std::weak_ptr<{}>(shared);", inner);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$weak_ptr${}$upgrade(const ::std::weak_ptr<{}> &weak, ::std::shared_ptr<{}> *shared) noexcept {{",
+        instance, inner, inner,
+    );
+    writeln!(
+        out,
+        "  new (shared) ::std::shared_ptr<{}>(weak.lock());",
+        inner
+    );
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$weak_ptr${}$drop(::std::weak_ptr<{}> *self) noexcept {{",
+        instance, inner,
+    );
+    writeln!(out, "  self->~weak_ptr();");
+    writeln!(out, "}}");
+    writeln!(out, "#endif // CXXBRIDGE02_WEAK_PTR_{}", instance);
+}
+
+fn write_cxx_vector(out: &mut OutFile, ident: &Ident) {
+    out.include.memory = true;
+
+    let mut inner = String::new();
+    for name in &out.namespace {
+        inner += name;
+        inner += "::";
+    }
+    inner += &ident.to_string();
+    let instance = inner.replace("::", "$");
+    let vector = format!("::std::vector<{}>", inner);
+
+    writeln!(out, "#ifndef CXXBRIDGE02_VECTOR_{}", instance);
+    writeln!(out, "#define CXXBRIDGE02_VECTOR_{}", instance);
+    writeln!(
+        out,
+        "size_t cxxbridge02$std$vector${}$size(const {} &s) noexcept {{",
+        instance, vector,
+    );
+    writeln!(out, "  return s.size();");
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "const {} *cxxbridge02$std$vector${}$data(const {} &s) noexcept {{",
+        inner, instance, vector,
+    );
+    writeln!(out, "  return s.data();");
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$unique_ptr$std$vector${}$null(::std::unique_ptr<{}> *ptr) noexcept {{",
+        instance, vector,
+    );
+    writeln!(out, "  new (ptr) ::std::unique_ptr<{}>();", vector);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$unique_ptr$std$vector${}$raw(::std::unique_ptr<{}> *ptr, {} *raw) noexcept {{",
+        instance, vector, vector,
+    );
+    writeln!(out, "  new (ptr) ::std::unique_ptr<{}>(raw);", vector);
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "const {} *cxxbridge02$unique_ptr$std$vector${}$get(const ::std::unique_ptr<{}>& ptr) noexcept {{",
+        vector, instance, vector,
+    );
+    writeln!(out, "  return ptr.get();");
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "{} *cxxbridge02$unique_ptr$std$vector${}$release(::std::unique_ptr<{}>& ptr) noexcept {{",
+        vector, instance, vector,
+    );
+    writeln!(out, "  return ptr.release();");
+    writeln!(out, "}}");
+    writeln!(
+        out,
+        "void cxxbridge02$unique_ptr$std$vector${}$drop(::std::unique_ptr<{}> *ptr) noexcept {{",
+        instance, vector,
+    );
+    writeln!(out, "  ptr->~unique_ptr();");
+    writeln!(out, "}}");
+    writeln!(out, "#endif // CXXBRIDGE02_VECTOR_{}", instance);
+}
+
+fn is_rust_vec(ty: &Type) -> bool {
+    match ty {
+        Type::RustVec(_) => true,
+        _ => false,
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_ARENA
+#define CXXBRIDGE02_RUST_ARENA
+// Bump allocator owned by Rust (cxx::Arena), only ever seen by reference.
+// Everything made in it is released at once when Rust drops or resets the
+// arena, without running destructors.
+class Arena final {
+public:
+  Arena() = delete;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // Never returns null; throws std::bad_alloc instead. Const like the &Arena
+  // it comes from; the arena synchronizes nothing, so it must not be used from
+  // two threads at once.
+  void *allocate(size_t size, size_t align) const;
+
+  template <typename T, typename... Args> T *make(Args &&... args) const {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "destructors do not run for objects in a rust::Arena");
+    return ::new (this->allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+};
+#endif // CXXBRIDGE02_RUST_ARENA
+
+using arena = Arena;
+
+} // namespace cxxbridge02
+} // namespace rust
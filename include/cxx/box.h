@@ -0,0 +1,78 @@
+#pragma once
+#include <new>
+#include <type_traits>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_BOX
+#define CXXBRIDGE02_RUST_BOX
+template <typename T> class Box final {
+public:
+  using value_type = T;
+  using const_pointer = typename std::add_pointer<
+      typename std::add_const<value_type>::type>::type;
+  using pointer = typename std::add_pointer<value_type>::type;
+
+  Box(const Box &other) : Box(*other) {}
+  Box(Box &&other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+  Box(const T &val) {
+    this->uninit();
+    ::new (this->ptr) T(val);
+  }
+  Box &operator=(const Box &other) {
+    if (this != &other) {
+      if (this->ptr) {
+        **this = *other;
+      } else {
+        this->uninit();
+        ::new (this->ptr) T(*other);
+      }
+    }
+    return *this;
+  }
+  Box &operator=(Box &&other) noexcept {
+    if (this->ptr) {
+      this->drop();
+    }
+    this->ptr = other.ptr;
+    other.ptr = nullptr;
+    return *this;
+  }
+  ~Box() noexcept {
+    if (this->ptr) {
+      this->drop();
+    }
+  }
+
+  const T *operator->() const noexcept { return this->ptr; }
+  const T &operator*() const noexcept { return *this->ptr; }
+  T *operator->() noexcept { return this->ptr; }
+  T &operator*() noexcept { return *this->ptr; }
+
+  // Important: requires that `raw` came from an into_raw call. Do not pass a
+  // pointer from `new` or any other source.
+  static Box from_raw(T *raw) noexcept {
+    Box box;
+    box.ptr = raw;
+    return box;
+  }
+
+  T *into_raw() noexcept {
+    T *raw = this->ptr;
+    this->ptr = nullptr;
+    return raw;
+  }
+
+private:
+  Box() noexcept {}
+  void uninit() noexcept;
+  void drop() noexcept;
+  T *ptr;
+};
+#endif // CXXBRIDGE02_RUST_BOX
+
+template <class T> using box = Box<T>;
+
+} // namespace cxxbridge02
+} // namespace rust
@@ -0,0 +1,58 @@
+#pragma once
+#include "str.h"
+#include <cstdint>
+#include <exception>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_COLD
+#define CXXBRIDGE02_RUST_COLD
+// Error paths of the generated shims are kept out of line so that the code
+// that runs on every call stays short.
+#if defined(__GNUC__)
+#define CXXBRIDGE02_COLD __attribute__((cold, noinline))
+#define CXXBRIDGE02_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define CXXBRIDGE02_COLD
+#define CXXBRIDGE02_UNLIKELY(x) (x)
+#endif
+#endif // CXXBRIDGE02_RUST_COLD
+
+#ifndef CXXBRIDGE02_RUST_ERROR
+#define CXXBRIDGE02_RUST_ERROR
+class Error final : std::exception {
+public:
+  Error(const Error &) noexcept;
+  Error(Error &&) noexcept;
+  Error(Str::Repr) noexcept;
+  ~Error() noexcept;
+
+  Error &operator=(const Error &) noexcept;
+  Error &operator=(Error &&) noexcept;
+
+  const char *what() const noexcept override;
+
+  // The value carried by a cxx::ErrorCode returned from Rust, otherwise 0.
+  int64_t code() const noexcept;
+
+  // Throws the error returned by a Rust function; called by generated code.
+  [[noreturn]] CXXBRIDGE02_COLD static void raise(Str::Repr);
+
+private:
+  void copy_from(const Error &) noexcept;
+  void move_from(Error &&) noexcept;
+  void release() noexcept;
+
+  Str::Repr msg;
+  int64_t errcode;
+  // Messages that fit are held here without allocating. Longer ones live on
+  // the heap and are shared by reference count between copies.
+  char small[48];
+};
+#endif // CXXBRIDGE02_RUST_ERROR
+
+using error = Error;
+
+} // namespace cxxbridge02
+} // namespace rust
@@ -0,0 +1,205 @@
+#pragma once
+#include <array>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_FN
+#define CXXBRIDGE02_RUST_FN
+template <typename Signature, bool Throws = false> class Fn;
+
+template <typename Ret, typename... Args, bool Throws>
+class Fn<Ret(Args...), Throws> {
+public:
+  // Wraps a C++ callable, such as a lambda, to pass it to a Rust function.
+  // Callables of at most three pointers in size that can be moved without
+  // throwing are stored inline; only larger ones are heap allocated.
+  template <typename F, typename = typename std::enable_if<!std::is_same<
+                            typename std::decay<F>::type, Fn>::value>::type>
+  Fn(F &&f);
+  Fn(const Fn &);
+  Fn(Fn &&) noexcept;
+  ~Fn() noexcept;
+
+  Fn &operator=(const Fn &);
+  Fn &operator=(Fn &&) noexcept;
+
+  Ret operator()(Args... args) const noexcept(!Throws);
+
+  // Repr is PRIVATE; must not be used other than by our generated code.
+  //
+  // Function pointer from Rust, matching cxx::private::FatFunction, or the
+  // trampoline of a wrapped C++ callable and the address of its storage.
+  struct Repr {
+    Ret (*trampoline)(Args..., void *fn) noexcept(!Throws);
+    void *fn;
+  };
+  Fn(Repr) noexcept;
+
+private:
+  using Storage = std::array<void *, 3>;
+
+  template <typename F>
+  static constexpr bool stored_inline() noexcept {
+    return sizeof(F) <= sizeof(Storage) && alignof(F) <= alignof(Storage) &&
+           std::is_nothrow_move_constructible<F>::value;
+  }
+
+  template <typename F>
+  static Ret invoke(Args... args, void *fn) noexcept(!Throws) {
+    return (*static_cast<F *>(fn))(std::move(args)...);
+  }
+
+  // Copy, move and destroy of the wrapped callable. Null for a Rust function,
+  // which is copied as two plain pointers.
+  struct Ops {
+    void (*copy)(const Fn &, Fn &);
+    void (*move)(Fn &, Fn &) noexcept;
+    void (*destroy)(Fn &) noexcept;
+  };
+  template <typename F, bool Inline = stored_inline<F>()> struct OpsFor;
+
+  void assign(const Fn &);
+  void assign(Fn &&) noexcept;
+  void destroy() noexcept;
+
+  Repr repr;
+  const Ops *ops;
+  Storage storage;
+};
+
+template <typename Ret, typename... Args, bool Throws>
+template <typename F>
+struct Fn<Ret(Args...), Throws>::OpsFor<F, true> {
+  template <typename G> static void *make(Fn &fn, G &&g) {
+    return new (&fn.storage) F(std::forward<G>(g));
+  }
+  static void copy(const Fn &src, Fn &dst) {
+    new (&dst.storage) F(*static_cast<const F *>(src.repr.fn));
+    dst.repr.fn = &dst.storage;
+  }
+  static void move(Fn &src, Fn &dst) noexcept {
+    new (&dst.storage) F(std::move(*static_cast<F *>(src.repr.fn)));
+    dst.repr.fn = &dst.storage;
+  }
+  static void destroy(Fn &fn) noexcept { static_cast<F *>(fn.repr.fn)->~F(); }
+  static constexpr Ops ops{copy, move, destroy};
+};
+
+template <typename Ret, typename... Args, bool Throws>
+template <typename F>
+struct Fn<Ret(Args...), Throws>::OpsFor<F, false> {
+  template <typename G> static void *make(Fn &, G &&g) {
+    return new F(std::forward<G>(g));
+  }
+  static void copy(const Fn &src, Fn &dst) {
+    dst.repr.fn = new F(*static_cast<const F *>(src.repr.fn));
+  }
+  static void move(Fn &src, Fn &dst) noexcept {
+    dst.repr.fn = src.repr.fn;
+    src.ops = nullptr;
+  }
+  static void destroy(Fn &fn) noexcept { delete static_cast<F *>(fn.repr.fn); }
+  static constexpr Ops ops{copy, move, destroy};
+};
+
+template <typename Ret, typename... Args, bool Throws>
+template <typename F>
+constexpr typename Fn<Ret(Args...), Throws>::Ops
+    Fn<Ret(Args...), Throws>::OpsFor<F, true>::ops;
+
+template <typename Ret, typename... Args, bool Throws>
+template <typename F>
+constexpr typename Fn<Ret(Args...), Throws>::Ops
+    Fn<Ret(Args...), Throws>::OpsFor<F, false>::ops;
+
+template <typename Ret, typename... Args, bool Throws>
+template <typename F, typename>
+Fn<Ret(Args...), Throws>::Fn(F &&f) {
+  using Callable = typename std::decay<F>::type;
+  this->repr.trampoline = &invoke<Callable>;
+  this->repr.fn = OpsFor<Callable>::make(*this, std::forward<F>(f));
+  this->ops = &OpsFor<Callable>::ops;
+}
+
+template <typename Ret, typename... Args, bool Throws>
+Fn<Ret(Args...), Throws>::Fn(Repr repr) noexcept : repr(repr), ops(nullptr) {}
+
+template <typename Ret, typename... Args, bool Throws>
+Fn<Ret(Args...), Throws>::Fn(const Fn &other) {
+  this->assign(other);
+}
+
+template <typename Ret, typename... Args, bool Throws>
+Fn<Ret(Args...), Throws>::Fn(Fn &&other) noexcept {
+  this->assign(std::move(other));
+}
+
+template <typename Ret, typename... Args, bool Throws>
+Fn<Ret(Args...), Throws>::~Fn() noexcept {
+  this->destroy();
+}
+
+template <typename Ret, typename... Args, bool Throws>
+Fn<Ret(Args...), Throws> &
+Fn<Ret(Args...), Throws>::operator=(const Fn &other) {
+  if (this != &other) {
+    Fn copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+template <typename Ret, typename... Args, bool Throws>
+Fn<Ret(Args...), Throws> &
+Fn<Ret(Args...), Throws>::operator=(Fn &&other) noexcept {
+  if (this != &other) {
+    this->destroy();
+    this->assign(std::move(other));
+  }
+  return *this;
+}
+
+template <typename Ret, typename... Args, bool Throws>
+Ret Fn<Ret(Args...), Throws>::operator()(Args... args) const
+    noexcept(!Throws) {
+  return (*this->repr.trampoline)(std::move(args)..., this->repr.fn);
+}
+
+template <typename Ret, typename... Args, bool Throws>
+void Fn<Ret(Args...), Throws>::assign(const Fn &other) {
+  this->repr = other.repr;
+  this->ops = other.ops;
+  if (this->ops) {
+    this->ops->copy(other, *this);
+  }
+}
+
+template <typename Ret, typename... Args, bool Throws>
+void Fn<Ret(Args...), Throws>::assign(Fn &&other) noexcept {
+  this->repr = other.repr;
+  this->ops = other.ops;
+  if (this->ops) {
+    this->ops->move(other, *this);
+  }
+}
+
+template <typename Ret, typename... Args, bool Throws>
+void Fn<Ret(Args...), Throws>::destroy() noexcept {
+  if (this->ops) {
+    this->ops->destroy(*this);
+  }
+}
+
+template <typename Signature> using TryFn = Fn<Signature, true>;
+#endif // CXXBRIDGE02_RUST_FN
+
+template <typename Signature, bool Throws = false>
+using fn = Fn<Signature, Throws>;
+template <typename Signature> using try_fn = TryFn<Signature>;
+
+} // namespace cxxbridge02
+} // namespace rust
@@ -0,0 +1,137 @@
+#pragma once
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_PROMISE
+#define CXXBRIDGE02_RUST_PROMISE
+// Completion handle passed to the C++ implementation of an async function
+// declared in an extern "C" block. It may be moved to another thread and
+// completed there; destroying it without calling set_value makes the Rust
+// future panic when awaited.
+class PromiseBase {
+public:
+  struct Repr {
+    void *state;
+    void (*complete)(void *state, void *value);
+    void (*drop)(void *state);
+  };
+
+  PromiseBase(const PromiseBase &) = delete;
+  PromiseBase &operator=(const PromiseBase &) = delete;
+
+  // False once completed or moved from.
+  bool pending() const noexcept { return this->repr.state != nullptr; }
+
+protected:
+  explicit PromiseBase(Repr repr) noexcept : repr(repr) {}
+  PromiseBase(PromiseBase &&other) noexcept : repr(other.repr) {
+    other.repr.state = nullptr;
+  }
+  PromiseBase &operator=(PromiseBase &&other) noexcept {
+    if (this != &other) {
+      this->drop();
+      this->repr = other.repr;
+      other.repr.state = nullptr;
+    }
+    return *this;
+  }
+  ~PromiseBase() noexcept { this->drop(); }
+
+  void complete(void *value) noexcept {
+    void *state = this->repr.state;
+    this->repr.state = nullptr;
+    this->repr.complete(state, value);
+  }
+
+private:
+  void drop() noexcept {
+    if (this->pending()) {
+      this->repr.drop(this->repr.state);
+      this->repr.state = nullptr;
+    }
+  }
+
+  Repr repr;
+};
+
+template <typename T> class Promise final : public PromiseBase {
+public:
+  explicit Promise(Repr repr) noexcept : PromiseBase(repr) {}
+
+  // Ownership of the value passes to Rust. Does nothing if the promise is no
+  // longer pending.
+  void set_value(T value) noexcept {
+    if (this->pending()) {
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type slot;
+      new (&slot) T(std::move(value));
+      this->complete(&slot);
+    }
+  }
+};
+
+template <> class Promise<void> final : public PromiseBase {
+public:
+  explicit Promise(Repr repr) noexcept : PromiseBase(repr) {}
+
+  void set_value() noexcept {
+    if (this->pending()) {
+      this->complete(this);
+    }
+  }
+};
+
+// The other direction: the C++ caller of an async function declared in an
+// extern "Rust" block passes a callable, and Rust calls it with the result once
+// the future is ready, on whichever thread finished the future. Rust completes
+// it through the same Repr as a Promise. If the future is dropped unfinished,
+// the callable is destroyed without being called.
+template <typename T> class PromiseCallback final {
+public:
+  template <typename F> static PromiseBase::Repr repr(F f) {
+    return {new F(std::move(f)), complete<F>, drop<F>};
+  }
+
+private:
+  // Takes over the value that Rust wrote at value; Rust does not drop it.
+  template <typename F>
+  static void complete(void *state, void *value) noexcept {
+    T *slot = static_cast<T *>(value);
+    T result(std::move(*slot));
+    slot->~T();
+    F *f = static_cast<F *>(state);
+    (*f)(std::move(result));
+    delete f;
+  }
+
+  template <typename F> static void drop(void *state) noexcept {
+    delete static_cast<F *>(state);
+  }
+};
+
+template <> class PromiseCallback<void> final {
+public:
+  template <typename F> static PromiseBase::Repr repr(F f) {
+    return {new F(std::move(f)), complete<F>, drop<F>};
+  }
+
+private:
+  template <typename F> static void complete(void *state, void *) noexcept {
+    F *f = static_cast<F *>(state);
+    (*f)();
+    delete f;
+  }
+
+  template <typename F> static void drop(void *state) noexcept {
+    delete static_cast<F *>(state);
+  }
+};
+#endif // CXXBRIDGE02_RUST_PROMISE
+
+template <typename T> using promise = Promise<T>;
+
+} // namespace cxxbridge02
+} // namespace rust
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_SLICE
+#define CXXBRIDGE02_RUST_SLICE
+template <typename T> class Slice final {
+public:
+  Slice() noexcept : repr(Repr{dangling(), 0}) {}
+  Slice(const Slice<T> &) noexcept = default;
+  Slice(T *s, size_t count) noexcept
+      : repr(Repr{count == 0 ? dangling() : s, count}) {}
+
+  Slice &operator=(Slice<T> other) noexcept {
+    this->repr = other.repr;
+    return *this;
+  }
+
+  T *data() const noexcept { return this->repr.ptr; }
+  size_t size() const noexcept { return this->repr.len; }
+  size_t length() const noexcept { return this->repr.len; }
+
+  // Repr is PRIVATE; must not be used other than by our generated code.
+  //
+  // Not necessarily ABI compatible with &[T]. Codegen will translate to
+  // cxx::rust_slice::RustSlice which matches this layout.
+  struct Repr {
+    T *ptr;
+    size_t len;
+  };
+  Slice(Repr repr_) noexcept : repr(repr_) {}
+  explicit operator Repr() noexcept { return this->repr; }
+
+private:
+  // Rust requires a non-null, aligned pointer even for an empty slice.
+  static T *dangling() noexcept { return reinterpret_cast<T *>(alignof(T)); }
+
+  Repr repr;
+};
+#endif // CXXBRIDGE02_RUST_SLICE
+
+template <class T> using slice = Slice<T>;
+
+} // namespace cxxbridge02
+} // namespace rust
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_STR
+#define CXXBRIDGE02_RUST_STR
+class Str final {
+public:
+  Str() noexcept;
+  Str(const Str &) noexcept;
+
+  Str(const std::string &);
+  Str(const char *);
+  Str(std::string &&) = delete;
+
+  // Skips UTF-8 validation. The caller must guarantee that the len bytes at
+  // ptr are valid UTF-8 and that ptr is not null, even when len is 0.
+  static Str from_utf8_unchecked(const char *ptr, size_t len) noexcept;
+
+  Str &operator=(Str) noexcept;
+
+  explicit operator std::string() const;
+
+  // Note: no null terminator.
+  const char *data() const noexcept;
+  size_t size() const noexcept;
+  size_t length() const noexcept;
+
+  // Repr is PRIVATE; must not be used other than by our generated code.
+  //
+  // Not necessarily ABI compatible with &str. Codegen will translate to
+  // cxx::rust_str::RustStr which matches this layout.
+  struct Repr {
+    const char *ptr;
+    size_t len;
+  };
+  Str(Repr) noexcept;
+  explicit operator Repr() noexcept;
+
+private:
+  Repr repr;
+};
+#endif // CXXBRIDGE02_RUST_STR
+
+std::ostream &operator<<(std::ostream &, const Str &);
+
+using str = Str;
+
+} // namespace cxxbridge02
+} // namespace rust
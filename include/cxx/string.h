@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+struct unsafe_bitcopy_t;
+
+#ifndef CXXBRIDGE02_RUST_STRING
+#define CXXBRIDGE02_RUST_STRING
+class String final {
+public:
+  String() noexcept;
+  String(const String &) noexcept;
+  String(String &&) noexcept;
+  ~String() noexcept;
+
+  String(const std::string &);
+  // Copies once like the const& overload, then releases the buffer of the
+  // argument, which is left empty. The Rust side cannot take over the buffer
+  // itself since that memory belongs to the C++ allocator.
+  String(std::string &&);
+  String(const char *);
+
+  // Skips UTF-8 validation. The caller must guarantee that the len bytes at
+  // ptr are valid UTF-8 and that ptr is not null, even when len is 0.
+  static String from_utf8_unchecked(const char *ptr, size_t len) noexcept;
+
+  String &operator=(const String &) noexcept;
+  String &operator=(String &&) noexcept;
+
+  explicit operator std::string() const;
+
+  // Note: no null terminator.
+  const char *data() const noexcept;
+  size_t size() const noexcept;
+  size_t length() const noexcept;
+
+  // Internal API only intended for the cxxbridge code generator.
+  String(unsafe_bitcopy_t, const String &) noexcept;
+
+  // A Rust String may be moved to a new address with memcpy, provided the
+  // source is neither used nor destroyed afterward.
+  using IsRelocatable = std::true_type;
+
+private:
+  struct unchecked_t {};
+  String(unchecked_t, const char *, size_t) noexcept;
+
+  const char *ffi_data() const noexcept;
+  size_t ffi_size() const noexcept;
+  void ffi_new() noexcept;
+
+  // Size and alignment statically verified by rust_string.rs.
+  std::array<uintptr_t, 3> repr;
+
+  // Which words of repr hold the pointer and the length, and the bits of an
+  // empty string. Filled in by cxx.cc during static initialization from the
+  // layout probe in rust_string.rs. Until then, or if the probe could not pin
+  // down the layout, the accessors and move constructor go through the FFI
+  // instead.
+  struct Layout {
+    bool known;
+    uint8_t ptr;
+    uint8_t len;
+    std::array<uintptr_t, 3> empty;
+  };
+  static Layout layout;
+};
+
+inline const char *String::data() const noexcept {
+  if (layout.known) {
+    return reinterpret_cast<const char *>(this->repr[layout.ptr]);
+  }
+  return this->ffi_data();
+}
+
+inline size_t String::size() const noexcept {
+  if (layout.known) {
+    return this->repr[layout.len];
+  }
+  return this->ffi_size();
+}
+
+inline size_t String::length() const noexcept { return this->size(); }
+
+inline String::String(String &&other) noexcept : repr(other.repr) {
+  if (layout.known) {
+    other.repr = layout.empty;
+  } else {
+    other.ffi_new();
+  }
+}
+
+// Leaves other holding the previous contents of this string, to be released
+// by other's destructor.
+inline String &String::operator=(String &&other) noexcept {
+  this->repr.swap(other.repr);
+  return *this;
+}
+#endif // CXXBRIDGE02_RUST_STRING
+
+std::ostream &operator<<(std::ostream &, const String &);
+
+using string = String;
+
+} // namespace cxxbridge02
+} // namespace rust
@@ -0,0 +1,155 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace rust {
+inline namespace cxxbridge02 {
+
+#ifndef CXXBRIDGE02_RUST_BITCOPY
+#define CXXBRIDGE02_RUST_BITCOPY
+struct unsafe_bitcopy_t {
+  explicit unsafe_bitcopy_t() = default;
+};
+constexpr unsafe_bitcopy_t unsafe_bitcopy{};
+#endif // CXXBRIDGE02_RUST_BITCOPY
+
+#ifndef CXXBRIDGE02_RUST_VEC
+#define CXXBRIDGE02_RUST_VEC
+// Which words of the repr of a Rust Vec<T> hold the pointer, the length and
+// the capacity. Rust does not promise a field order, not even the same one for
+// every T, so each Vec<T>::layout is filled in during static initialization
+// from the layout shim of its own T. Until then, or if the probe could not pin
+// down the layout, every access goes through the FFI instead.
+//
+// Internal API only intended for rust::Vec.
+struct VecLayout {
+  bool known;
+  uint8_t ptr;
+  uint8_t len;
+  uint8_t cap;
+  static VecLayout probe(bool (*shim)(size_t *ptr, size_t *len,
+                                      size_t *cap)) noexcept;
+};
+
+// Throws std::length_error.
+//
+// Internal API only intended for rust::Vec.
+[[noreturn]] void vec_capacity_overflow();
+
+template <typename T> class Vec final {
+public:
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  Vec() noexcept { this->init(); }
+  Vec(Vec &&other) noexcept : repr(other.repr) { other.init(); }
+  ~Vec() noexcept { this->drop(); }
+
+  // Leaves other holding the previous contents of this vector.
+  Vec &operator=(Vec &&other) noexcept {
+    this->repr.swap(other.repr);
+    return *this;
+  }
+
+  size_t size() const noexcept {
+    if (layout.known) {
+      return this->repr[layout.len];
+    }
+    return this->ffi_size();
+  }
+  bool empty() const noexcept { return this->size() == 0; }
+  const T *data() const noexcept {
+    if (layout.known) {
+      return reinterpret_cast<const T *>(this->repr[layout.ptr]);
+    }
+    return this->ffi_data();
+  }
+  T *data() noexcept {
+    return const_cast<T *>(static_cast<const Vec *>(this)->data());
+  }
+
+  const T &operator[](size_t n) const noexcept { return this->data()[n]; }
+  T &operator[](size_t n) noexcept { return this->data()[n]; }
+
+  // Grows the capacity to at least n elements, in amortized steps like
+  // Vec::reserve. Throws std::length_error where Vec::reserve would panic.
+  void reserve(size_t n) { this->reserve_total(n); }
+
+  void push_back(const T &value) {
+    auto len = this->size();
+    if (!layout.known || this->repr[layout.cap] == len) {
+      // value may be an element of this vector, which reserve_total frees.
+      T copy(value);
+      this->reserve_total(len + 1);
+      ::new (this->data() + len) T(std::move(copy));
+    } else {
+      ::new (this->data() + len) T(value);
+    }
+    this->store_len(len + 1);
+  }
+
+  // Appends count elements copied from ptr, with a single reallocation at
+  // most. The elements may come from this vector itself.
+  void extend(const T *ptr, size_t count) {
+    auto len = this->size();
+    if (!layout.known || this->repr[layout.cap] - len < count) {
+      auto offset = reinterpret_cast<uintptr_t>(ptr) -
+                    reinterpret_cast<uintptr_t>(this->data());
+      bool own = offset < len * sizeof(T);
+      this->reserve_total(len + count);
+      if (own) {
+        ptr = reinterpret_cast<const T *>(
+            reinterpret_cast<uintptr_t>(this->data()) + offset);
+      }
+    }
+    auto dst = this->data() + len;
+    for (size_t i = 0; i < count; i++) {
+      ::new (dst + i) T(ptr[i]);
+    }
+    this->store_len(len + count);
+  }
+
+  iterator begin() noexcept { return this->data(); }
+  iterator end() noexcept { return this->data() + this->size(); }
+  const_iterator begin() const noexcept { return this->data(); }
+  const_iterator end() const noexcept { return this->data() + this->size(); }
+
+  // Internal API only intended for the cxxbridge code generator.
+  Vec(unsafe_bitcopy_t, const Vec &bits) noexcept : repr(bits.repr) {}
+
+private:
+  void store_len(size_t len) noexcept {
+    if (layout.known) {
+      this->repr[layout.len] = len;
+    } else {
+      this->set_len(len);
+    }
+  }
+
+  static VecLayout layout;
+
+  void init() noexcept;
+  void drop() noexcept;
+  size_t ffi_size() const noexcept;
+  const T *ffi_data() const noexcept;
+  void reserve_total(size_t cap) {
+    if (!this->ffi_reserve_total(cap)) {
+      vec_capacity_overflow();
+    }
+  }
+  bool ffi_reserve_total(size_t cap) noexcept;
+  void set_len(size_t len) noexcept;
+
+  // Size and alignment statically verified by rust_vec.rs.
+  std::array<uintptr_t, 3> repr;
+};
+#endif // CXXBRIDGE02_RUST_VEC
+
+template <class T> using vec = Vec<T>;
+
+} // namespace cxxbridge02
+} // namespace rust
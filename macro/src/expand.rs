@@ -30,13 +30,16 @@ pub fn bridge(namespace: &Namespace, ffi: ItemMod) -> Result<TokenStream> {
             }
             let ident = &ety.ident;
             hidden.extend(quote!(__assert_sized::<#ident>();));
+            if ety.layout.is_some() {
+                hidden.extend(expand_rust_type_layout(namespace, ety));
+            }
         }
     }
 
     for api in &apis {
         match api {
             Api::Include(_) | Api::RustType(_) => {}
-            Api::Struct(strct) => expanded.extend(expand_struct(strct)),
+            Api::Struct(strct) => expanded.extend(expand_struct(strct, types)),
             Api::CxxType(ety) => expanded.extend(expand_cxx_type(ety)),
             Api::CxxFunction(efn) => {
                 expanded.extend(expand_cxx_function_shim(namespace, efn, types));
@@ -47,6 +50,7 @@ pub fn bridge(namespace: &Namespace, ffi: ItemMod) -> Result<TokenStream> {
         }
     }
 
+    let mut shared_ptr_targets = Vec::new();
     for ty in types {
         if let Type::RustBox(ty) = ty {
             if let Type::Ident(ident) = &ty.inner {
@@ -54,12 +58,39 @@ pub fn bridge(namespace: &Namespace, ffi: ItemMod) -> Result<TokenStream> {
                     hidden.extend(expand_rust_box(namespace, ident));
                 }
             }
+        } else if let Type::RustVec(ty) = ty {
+            if let Type::Ident(ident) = &ty.inner {
+                if Atom::from(ident).is_none() {
+                    hidden.extend(expand_rust_vec(namespace, ident));
+                }
+            }
+        } else if let Type::CxxVector(ty) = ty {
+            if let Type::Ident(ident) = &ty.inner {
+                if Atom::from(ident).is_none() {
+                    expanded.extend(expand_cxx_vector(namespace, ident));
+                }
+            }
         } else if let Type::UniquePtr(ptr) = ty {
             if let Type::Ident(ident) = &ptr.inner {
                 if Atom::from(ident).is_none() {
                     expanded.extend(expand_unique_ptr(namespace, ident));
                 }
             }
+        } else if let Type::SharedPtr(ptr) | Type::WeakPtr(ptr) = ty {
+            if let Type::Ident(ident) = &ptr.inner {
+                if Atom::from(ident).is_none() {
+                    // WeakPtr::upgrade needs the SharedPtrTarget impl too, even
+                    // if the bridge never mentions SharedPtr<T>, but it must be
+                    // emitted only once.
+                    if !shared_ptr_targets.contains(&ident) {
+                        expanded.extend(expand_shared_ptr(namespace, ident));
+                        shared_ptr_targets.push(ident);
+                    }
+                    if let Type::WeakPtr(_) = ty {
+                        expanded.extend(expand_weak_ptr(namespace, ident));
+                    }
+                }
+            }
         }
     }
 
@@ -89,7 +120,7 @@ pub fn bridge(namespace: &Namespace, ffi: ItemMod) -> Result<TokenStream> {
     })
 }
 
-fn expand_struct(strct: &Struct) -> TokenStream {
+fn expand_struct(strct: &Struct, types: &Types) -> TokenStream {
     let ident = &strct.ident;
     let doc = &strct.doc;
     let derives = &strct.derives;
@@ -99,6 +130,11 @@ fn expand_struct(strct: &Struct) -> TokenStream {
         let vis = Token![pub](field.ident.span());
         quote!(#vis #field)
     });
+    let layout = if types.is_flat(strct) {
+        Some(expand_struct_layout(strct))
+    } else {
+        None
+    };
     quote! {
         #doc
         #[derive(#(#derives),*)]
@@ -106,18 +142,52 @@ fn expand_struct(strct: &Struct) -> TokenStream {
         pub struct #ident {
             #(#fields,)*
         }
+        #layout
+    }
+}
+
+// Counterpart of the static_asserts on the C++ side. Field offsets cannot be
+// taken in a const context, so only the size is checked here, against the
+// fields laid end to end, along with the absence of drop glue that makes a
+// bytewise copy a valid copy.
+fn expand_struct_layout(strct: &Struct) -> TokenStream {
+    let ident = &strct.ident;
+    let mut end = quote!(0);
+    for field in &strct.fields {
+        let ty = &field.ty;
+        end = quote! {
+            ::cxx::private::align_up(#end, ::std::mem::align_of::<#ty>())
+                + ::std::mem::size_of::<#ty>()
+        };
+    }
+    quote! {
+        const _: ::cxx::private::True = {
+            const LAYOUT: bool = (::std::mem::size_of::<#ident>()
+                == ::cxx::private::align_up(#end, ::std::mem::align_of::<#ident>()))
+                & !::std::mem::needs_drop::<#ident>();
+            <[(); LAYOUT as usize] as ::cxx::private::ToBool>::BOOL
+        };
     }
 }
 
 fn expand_cxx_type(ety: &ExternType) -> TokenStream {
     let ident = &ety.ident;
     let doc = &ety.doc;
+    // The Opaque field keeps the type !Send and !Sync unless the bridge
+    // vouches that the C++ type may be used from any thread.
+    let thread_safe = ety.thread_safe.as_ref().map(|thread_safe| {
+        quote_spanned! {thread_safe.span()=>
+            unsafe impl ::std::marker::Send for #ident {}
+            unsafe impl ::std::marker::Sync for #ident {}
+        }
+    });
     quote! {
         #doc
         #[repr(C)]
         pub struct #ident {
             _private: ::cxx::private::Opaque,
         }
+        #thread_safe
     }
 }
 
@@ -128,6 +198,8 @@ fn expand_cxx_function_decl(namespace: &Namespace, efn: &ExternFn, types: &Types
         let ty = expand_extern_type(&arg.ty);
         if arg.ty == RustString {
             quote!(#ident: *const #ty)
+        } else if let Type::RustVec(_) = arg.ty {
+            quote!(#ident: *const #ty)
         } else if let Type::Fn(_) = arg.ty {
             quote!(#ident: ::cxx::private::FatFunction)
         } else if types.needs_indirect_abi(&arg.ty) {
@@ -138,6 +210,8 @@ fn expand_cxx_function_decl(namespace: &Namespace, efn: &ExternFn, types: &Types
     });
     let ret = if efn.throws {
         quote!(-> ::cxx::private::Result)
+    } else if efn.asyncness.is_some() {
+        TokenStream::new()
     } else {
         expand_extern_return_type(&efn.ret, types)
     };
@@ -145,6 +219,8 @@ fn expand_cxx_function_decl(namespace: &Namespace, efn: &ExternFn, types: &Types
     if indirect_return(efn, types) {
         let ret = expand_extern_type(efn.ret.as_ref().unwrap());
         outparam = Some(quote!(__return: *mut #ret));
+    } else if efn.asyncness.is_some() {
+        outparam = Some(quote!(__promise: *mut ::cxx::private::PromiseRepr));
     }
     let link_name = format!("{}cxxbridge02${}", namespace, ident);
     let local_name = format_ident!("__{}", ident);
@@ -159,12 +235,14 @@ fn expand_cxx_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types
     let doc = &efn.doc;
     let decl = expand_cxx_function_decl(namespace, efn, types);
     let args = &efn.args;
+    let ok = match &efn.ret {
+        Some(ret) => quote!(#ret),
+        None => quote!(()),
+    };
     let ret = if efn.throws {
-        let ok = match &efn.ret {
-            Some(ret) => quote!(#ret),
-            None => quote!(()),
-        };
         quote!(-> ::std::result::Result<#ok, ::cxx::Exception>)
+    } else if efn.asyncness.is_some() {
+        quote!(-> ::cxx::CxxFuture<#ok>)
     } else {
         expand_return_type(&efn.ret)
     };
@@ -176,14 +254,23 @@ fn expand_cxx_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types
                 quote!(#var.as_mut_ptr() as *const ::cxx::private::RustString)
             }
             Type::RustBox(_) => quote!(::std::boxed::Box::into_raw(#var)),
+            Type::RustVec(_) => quote!(#var.as_mut_ptr() as *const ::cxx::private::RustVec<_>),
             Type::UniquePtr(_) => quote!(::cxx::UniquePtr::into_raw(#var)),
             Type::Ref(ty) => match &ty.inner {
                 Type::Ident(ident) if ident == RustString => {
                     quote!(::cxx::private::RustString::from_ref(#var))
                 }
+                Type::RustVec(_) => match ty.mutability {
+                    None => quote!(::cxx::private::RustVec::from_ref(#var)),
+                    Some(_) => quote!(::cxx::private::RustVec::from_mut(#var)),
+                },
                 _ => quote!(#var),
             },
             Type::Str(_) => quote!(::cxx::private::RustStr::from(#var)),
+            Type::SliceRef(ty) => match ty.mutability {
+                None => quote!(::cxx::private::RustSlice::from_ref(#var)),
+                Some(_) => quote!(::cxx::private::RustSlice::from_mut(#var)),
+            },
             ty if types.needs_indirect_abi(ty) => quote!(#var.as_mut_ptr()),
             _ => quote!(#var),
         }
@@ -215,8 +302,17 @@ fn expand_cxx_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types
             }
         })
         .collect::<TokenStream>();
+    if efn.batch.is_some() {
+        setup.extend(expand_batch_len_check(efn));
+    }
     let local_name = format_ident!("__{}", ident);
-    let call = if indirect_return {
+    let call = if efn.asyncness.is_some() {
+        setup.extend(quote! {
+            let (__future, mut __promise) = ::cxx::private::future_promise::<#ok>();
+            #local_name(#(#vars,)* &mut __promise);
+        });
+        quote!(__future)
+    } else if indirect_return {
         let ret = expand_extern_type(efn.ret.as_ref().unwrap());
         setup.extend(quote! {
             let mut __return = ::std::mem::MaybeUninit::<#ret>::uninit();
@@ -241,36 +337,57 @@ fn expand_cxx_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types
             #local_name(#(#vars),*)
         }
     };
-    let expr = if efn.throws {
+    let expr = if efn.asyncness.is_some() {
+        None
+    } else if efn.throws {
         efn.ret.as_ref().and_then(|ret| match ret {
             Type::Ident(ident) if ident == RustString => {
                 Some(quote!(#call.map(|r| r.into_string())))
             }
             Type::RustBox(_) => Some(quote!(#call.map(|r| ::std::boxed::Box::from_raw(r)))),
+            Type::RustVec(_) => Some(quote!(#call.map(|r| r.into_vec()))),
             Type::UniquePtr(_) => Some(quote!(#call.map(|r| ::cxx::UniquePtr::from_raw(r)))),
             Type::Ref(ty) => match &ty.inner {
                 Type::Ident(ident) if ident == RustString => {
                     Some(quote!(#call.map(|r| r.as_string())))
                 }
+                Type::RustVec(_) => match ty.mutability {
+                    None => Some(quote!(#call.map(|r| r.as_vec()))),
+                    Some(_) => Some(quote!(#call.map(|r| r.as_mut_vec()))),
+                },
                 _ => None,
             },
             Type::Str(_) => Some(quote!(#call.map(|r| r.as_str()))),
+            Type::SliceRef(ty) => match ty.mutability {
+                None => Some(quote!(#call.map(|r| r.as_slice()))),
+                Some(_) => Some(quote!(#call.map(|r| r.as_mut_slice()))),
+            },
             _ => None,
         })
     } else {
         efn.ret.as_ref().and_then(|ret| match ret {
             Type::Ident(ident) if ident == RustString => Some(quote!(#call.into_string())),
             Type::RustBox(_) => Some(quote!(::std::boxed::Box::from_raw(#call))),
+            Type::RustVec(_) => Some(quote!(#call.into_vec())),
             Type::UniquePtr(_) => Some(quote!(::cxx::UniquePtr::from_raw(#call))),
             Type::Ref(ty) => match &ty.inner {
                 Type::Ident(ident) if ident == RustString => Some(quote!(#call.as_string())),
+                Type::RustVec(_) => match ty.mutability {
+                    None => Some(quote!(#call.as_vec())),
+                    Some(_) => Some(quote!(#call.as_mut_vec())),
+                },
                 _ => None,
             },
             Type::Str(_) => Some(quote!(#call.as_str())),
+            Type::SliceRef(ty) => match ty.mutability {
+                None => Some(quote!(#call.as_slice())),
+                Some(_) => Some(quote!(#call.as_mut_slice())),
+            },
             _ => None,
         })
     }
     .unwrap_or(call);
+    let stats_label = format!("::{}", ident);
     quote! {
         #doc
         pub fn #ident(#(#args),*) #ret {
@@ -278,6 +395,9 @@ fn expand_cxx_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types
                 #decl
             }
             #trampolines
+            static __STATS: ::cxx::private::CallSite =
+                ::cxx::private::CallSite::new(concat!(module_path!(), #stats_label));
+            let __timer = __STATS.start();
             unsafe {
                 #setup
                 #expr
@@ -286,6 +406,22 @@ fn expand_cxx_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types
     }
 }
 
+// The C++ loop of a batched function trusts all of its slices to be as long as
+// the first one.
+fn expand_batch_len_check(sig: &Signature) -> TokenStream {
+    let first = &sig.args[0].ident;
+    let rest = sig.args[1..].iter().map(|arg| &arg.ident);
+    quote! {
+        #(
+            assert_eq!(
+                #first.len(),
+                #rest.len(),
+                "slices passed to a batched function must have the same length",
+            );
+        )*
+    }
+}
+
 fn expand_function_pointer_trampoline(
     namespace: &Namespace,
     efn: &ExternFn,
@@ -296,15 +432,9 @@ fn expand_function_pointer_trampoline(
     let c_trampoline = format!("{}cxxbridge02${}${}$0", namespace, efn.ident, var);
     let r_trampoline = format!("{}cxxbridge02${}${}$1", namespace, efn.ident, var);
     let local_name = parse_quote!(__);
-    let catch_unwind_label = format!("::{}::{}", efn.ident, var);
-    let shim = expand_rust_function_shim_impl(
-        sig,
-        types,
-        &r_trampoline,
-        local_name,
-        catch_unwind_label,
-        None,
-    );
+    let label = format!("::{}::{}", efn.ident, var);
+    let shim =
+        expand_rust_function_shim_impl(sig, types, &r_trampoline, local_name, &label, true, None);
 
     quote! {
         let #var = ::cxx::private::FatFunction {
@@ -328,18 +458,89 @@ fn expand_rust_type(ety: &ExternType) -> TokenStream {
     }
 }
 
+// C++ holds the value in storage of the declared size and alignment, so the
+// type must fit in it. Construction and moves go through Default: a C++ move
+// takes the value and leaves a default one behind for the destructor, since
+// C++ runs the destructor of a moved-from object.
+fn expand_rust_type_layout(namespace: &Namespace, ety: &ExternType) -> TokenStream {
+    let ident = &ety.ident;
+    let layout = ety.layout.as_ref().unwrap();
+    let size = layout.size;
+    let align = layout.align;
+
+    let link_prefix = format!("cxxbridge02$rust_type${}{}$", namespace, ident);
+    let link_new = format!("{}new", link_prefix);
+    let link_take = format!("{}take", link_prefix);
+    let link_assign = format!("{}assign", link_prefix);
+    let link_drop = format!("{}drop", link_prefix);
+
+    let local_prefix = format_ident!("{}__layout_", ident);
+    let local_new = format_ident!("{}new", local_prefix);
+    let local_take = format_ident!("{}take", local_prefix);
+    let local_assign = format_ident!("{}assign", local_prefix);
+    let local_drop = format_ident!("{}drop", local_prefix);
+
+    let label = format!("::{}", ident);
+    let span = ident.span();
+    quote_spanned! {span=>
+        const _: ::cxx::private::True = {
+            const LAYOUT: bool = (::std::mem::size_of::<#ident>() <= #size)
+                & (::std::mem::align_of::<#ident>() <= #align);
+            <[(); LAYOUT as usize] as ::cxx::private::ToBool>::BOOL
+        };
+        #[doc(hidden)]
+        #[export_name = #link_new]
+        unsafe extern "C" fn #local_new(this: *mut #ident) {
+            let __fn = concat!(module_path!(), #label);
+            ::cxx::private::catch_unwind(__fn, move || {
+                ::std::ptr::write(this, <#ident as ::std::default::Default>::default());
+            })
+        }
+        #[doc(hidden)]
+        #[export_name = #link_take]
+        unsafe extern "C" fn #local_take(this: *mut #ident, other: *mut #ident) {
+            let __fn = concat!(module_path!(), #label);
+            ::cxx::private::catch_unwind(__fn, move || {
+                ::std::ptr::write(this, ::std::mem::take(&mut *other));
+            })
+        }
+        #[doc(hidden)]
+        #[export_name = #link_assign]
+        unsafe extern "C" fn #local_assign(this: *mut #ident, other: *mut #ident) {
+            let __fn = concat!(module_path!(), #label);
+            ::cxx::private::catch_unwind(__fn, move || {
+                *this = ::std::mem::take(&mut *other);
+            })
+        }
+        #[doc(hidden)]
+        #[export_name = #link_drop]
+        unsafe extern "C" fn #local_drop(this: *mut #ident) {
+            let __fn = concat!(module_path!(), #label);
+            ::cxx::private::catch_unwind(__fn, move || {
+                ::std::ptr::drop_in_place(this);
+            })
+        }
+    }
+}
+
 fn expand_rust_function_shim(namespace: &Namespace, efn: &ExternFn, types: &Types) -> TokenStream {
     let ident = &efn.ident;
     let link_name = format!("{}cxxbridge02${}", namespace, ident);
     let local_name = format_ident!("__{}", ident);
-    let catch_unwind_label = format!("::{}", ident);
-    let invoke = Some(ident);
+    let label = format!("::{}", ident);
+    let catch_unwind = !efn.nopanic;
+    let invoke = match &efn.batch {
+        Some(item) => expand_rust_batch_loop(efn, item),
+        None => quote!(super::#ident),
+    };
+    let invoke = Some(invoke);
     expand_rust_function_shim_impl(
         efn,
         types,
         &link_name,
         local_name,
-        catch_unwind_label,
+        &label,
+        catch_unwind,
         invoke,
     )
 }
@@ -349,13 +550,16 @@ fn expand_rust_function_shim_impl(
     types: &Types,
     link_name: &str,
     local_name: Ident,
-    catch_unwind_label: String,
-    invoke: Option<&Ident>,
+    label: &str,
+    catch_unwind: bool,
+    invoke: Option<TokenStream>,
 ) -> TokenStream {
     let args = sig.args.iter().map(|arg| {
         let ident = &arg.ident;
         let ty = expand_extern_type(&arg.ty);
-        if types.needs_indirect_abi(&arg.ty) {
+        if let Type::Fn(_) = arg.ty {
+            quote!(#ident: *const ::std::ffi::c_void)
+        } else if types.needs_indirect_abi(&arg.ty) {
             quote!(#ident: *mut #ty)
         } else {
             quote!(#ident: #ty)
@@ -369,19 +573,34 @@ fn expand_rust_function_shim_impl(
                 quote!(::std::mem::take((*#ident).as_mut_string()))
             }
             Type::RustBox(_) => quote!(::std::boxed::Box::from_raw(#ident)),
+            Type::RustVec(_) => quote!(::std::mem::take((*#ident).as_mut_vec())),
             Type::UniquePtr(_) => quote!(::cxx::UniquePtr::from_raw(#ident)),
             Type::Ref(ty) => match &ty.inner {
                 Type::Ident(i) if i == RustString => quote!(#ident.as_string()),
+                Type::RustVec(_) => match ty.mutability {
+                    None => quote!(#ident.as_vec()),
+                    Some(_) => quote!(#ident.as_mut_vec()),
+                },
                 _ => quote!(#ident),
             },
             Type::Str(_) => quote!(#ident.as_str()),
+            Type::SliceRef(ty) => match ty.mutability {
+                None => quote!(#ident.as_slice()),
+                Some(_) => quote!(#ident.as_mut_slice()),
+            },
+            Type::Fn(f) => expand_callable_closure(f, link_name, ident),
             ty if types.needs_indirect_abi(ty) => quote!(::std::ptr::read(#ident)),
             _ => quote!(#ident),
         }
     });
 
+    let pointer = match invoke {
+        None => Some(quote!(__extern: #sig)),
+        Some(_) => None,
+    };
+
     let mut call = match invoke {
-        Some(ident) => quote!(super::#ident),
+        Some(invoke) => invoke,
         None => quote!(__extern),
     };
     call.extend(quote! { (#(#vars),*) });
@@ -394,16 +613,26 @@ fn expand_rust_function_shim_impl(
                 Some(quote!(::cxx::private::RustString::from(#call)))
             }
             Type::RustBox(_) => Some(quote!(::std::boxed::Box::into_raw(#call))),
+            Type::RustVec(_) => Some(quote!(::cxx::private::RustVec::from(#call))),
             Type::UniquePtr(_) => Some(quote!(::cxx::UniquePtr::into_raw(#call))),
             Type::Ref(ty) => match &ty.inner {
                 Type::Ident(ident) if ident == RustString => {
                     Some(quote!(::cxx::private::RustString::from_ref(#call)))
                 }
+                Type::RustVec(_) => match ty.mutability {
+                    None => Some(quote!(::cxx::private::RustVec::from_ref(#call))),
+                    Some(_) => Some(quote!(::cxx::private::RustVec::from_mut(#call))),
+                },
                 _ => None,
             },
             Type::Str(_) => Some(quote!(::cxx::private::RustStr::from(#call))),
+            Type::SliceRef(ty) => match ty.mutability {
+                None => Some(quote!(::cxx::private::RustSlice::from_ref(#call))),
+                Some(_) => Some(quote!(::cxx::private::RustSlice::from_mut(#call))),
+            },
             _ => None,
         })
+        .filter(|_| sig.asyncness.is_none())
         .unwrap_or(call);
 
     let mut outparam = None;
@@ -412,39 +641,152 @@ fn expand_rust_function_shim_impl(
         let ret = expand_extern_type(sig.ret.as_ref().unwrap());
         outparam = Some(quote!(__return: *mut #ret,));
     }
-    if sig.throws {
+    if sig.asyncness.is_some() {
+        // The C++ caller gets the output through the callable it passed, once
+        // the future is ready.
+        outparam = Some(quote!(__promise: *mut ::cxx::private::PromiseRepr,));
+        let output = match &sig.ret {
+            Some(ret) => quote!(#ret),
+            None => quote!(()),
+        };
+        expr = quote! {
+            ::cxx::private::spawn::<#output, _>(
+                concat!(module_path!(), #label),
+                #expr,
+                ::std::ptr::read(__promise),
+            )
+        };
+    } else if sig.throws {
         let out = match sig.ret {
             Some(_) => quote!(__return),
             None => quote!(&mut ()),
         };
-        expr = quote!(::cxx::private::r#try(#out, #expr));
+        expr = quote! {
+            ::cxx::private::r#try(#out, #expr.map_err(|err| {
+                #[allow(unused_imports)]
+                use ::cxx::private::{ToCError, ToCErrorCode};
+                (&err).__to_c_error()
+            }))
+        };
     } else if indirect_return {
         expr = quote!(::std::ptr::write(__return, #expr));
     }
 
-    expr = quote!(::cxx::private::catch_unwind(__fn, move || #expr));
+    expr = if catch_unwind {
+        quote! {
+            let __fn = concat!(module_path!(), #label);
+            ::cxx::private::catch_unwind(__fn, move || #expr)
+        }
+    } else {
+        quote! {
+            let __guard = ::cxx::private::AbortOnUnwind {
+                label: concat!(module_path!(), #label),
+            };
+            let __ret = #expr;
+            ::std::mem::forget(__guard);
+            __ret
+        }
+    };
 
     let ret = if sig.throws {
         quote!(-> ::cxx::private::Result)
+    } else if sig.asyncness.is_some() {
+        TokenStream::new()
     } else {
         expand_extern_return_type(&sig.ret, types)
     };
 
-    let pointer = match invoke {
-        None => Some(quote!(__extern: #sig)),
-        Some(_) => None,
-    };
-
     quote! {
         #[doc(hidden)]
         #[export_name = #link_name]
         unsafe extern "C" fn #local_name(#(#args,)* #outparam #pointer) #ret {
-            let __fn = concat!(module_path!(), #catch_unwind_label);
+            static __STATS: ::cxx::private::CallSite =
+                ::cxx::private::CallSite::new(concat!(module_path!(), #label));
+            let __timer = __STATS.start();
             #expr
         }
     }
 }
 
+// Stands in for a C++ callable passed to a Rust function, which receives it as
+// `&impl Fn`. The closure holds only the address of the rust::Fn on the C++
+// side and calls it through the thunk generated next to the Rust function
+// declaration, so nothing is allocated in either language.
+fn expand_callable_closure(sig: &Signature, link_name: &str, var: &Ident) -> TokenStream {
+    let thunk = format!("{}${}$2", link_name, var);
+    let params = sig.args.iter().map(|arg| &arg.ident).collect::<Vec<_>>();
+    let tys = sig.args.iter().map(|arg| &arg.ty).collect::<Vec<_>>();
+    let ret = sig.ret.as_ref().map(|ret| quote!(-> #ret));
+    quote! {
+        &move |#(#params: #tys),*| #ret {
+            extern "C" {
+                #[link_name = #thunk]
+                fn __thunk(__f: *const ::std::ffi::c_void, #(#params: #tys),*) #ret;
+            }
+            __thunk(#var, #(#params),*)
+        }
+    }
+}
+
+// Closure that the shim of a batched Rust function calls in place of a function
+// defined by the user. It calls the per-item function once for each element.
+fn expand_rust_batch_loop(efn: &ExternFn, item: &Ident) -> TokenStream {
+    let params = efn.args.iter().map(|arg| {
+        let ident = &arg.ident;
+        let ty = &arg.ty;
+        quote!(#ident: #ty)
+    });
+    let len_check = expand_batch_len_check(efn);
+    let first = &efn.args[0].ident;
+    let item_args = efn.args.iter().filter(|arg| arg.ident != "out").map(|arg| {
+        let ident = &arg.ident;
+        let by_value = match &arg.ty {
+            Type::SliceRef(ty) => match &ty.inner {
+                Type::Slice(slice) => match &slice.inner {
+                    Type::Ident(ident) => Atom::from(ident).is_some(),
+                    _ => false,
+                },
+                _ => false,
+            },
+            _ => false,
+        };
+        if by_value {
+            quote!(#ident[__i])
+        } else {
+            quote!(&#ident[__i])
+        }
+    });
+    let mut call = quote!(super::#item(#(#item_args),*));
+    if efn.throws {
+        call = quote! {
+            match #call {
+                ::std::result::Result::Ok(ok) => ok,
+                ::std::result::Result::Err(err) => return ::std::result::Result::Err(err),
+            }
+        };
+    }
+    let has_out = efn.args.iter().any(|arg| arg.ident == "out");
+    let body = if has_out {
+        quote!(out[__i] = #call;)
+    } else {
+        quote!(#call;)
+    };
+    let ok = if efn.throws {
+        Some(quote!(::std::result::Result::Ok(())))
+    } else {
+        None
+    };
+    quote! {
+        (|#(#params),*| {
+            #len_check
+            for __i in 0..#first.len() {
+                #body
+            }
+            #ok
+        })
+    }
+}
+
 fn expand_rust_box(namespace: &Namespace, ident: &Ident) -> TokenStream {
     let link_prefix = format!("cxxbridge02$box${}{}$", namespace, ident);
     let link_uninit = format!("{}uninit", link_prefix);
@@ -474,6 +816,73 @@ fn expand_rust_box(namespace: &Namespace, ident: &Ident) -> TokenStream {
     }
 }
 
+fn expand_rust_vec(namespace: &Namespace, ident: &Ident) -> TokenStream {
+    let link_prefix = format!("cxxbridge02$rust_vec${}{}$", namespace, ident);
+    let link_new = format!("{}new", link_prefix);
+    let link_drop = format!("{}drop", link_prefix);
+    let link_len = format!("{}len", link_prefix);
+    let link_data = format!("{}data", link_prefix);
+    let link_reserve_total = format!("{}reserve_total", link_prefix);
+    let link_set_len = format!("{}set_len", link_prefix);
+    let link_layout = format!("{}layout", link_prefix);
+
+    let local_prefix = format_ident!("{}__vec_", ident);
+    let local_new = format_ident!("{}new", local_prefix);
+    let local_drop = format_ident!("{}drop", local_prefix);
+    let local_len = format_ident!("{}len", local_prefix);
+    let local_data = format_ident!("{}data", local_prefix);
+    let local_reserve_total = format_ident!("{}reserve_total", local_prefix);
+    let local_set_len = format_ident!("{}set_len", local_prefix);
+    let local_layout = format_ident!("{}layout", local_prefix);
+
+    let span = ident.span();
+    quote_spanned! {span=>
+        #[doc(hidden)]
+        #[export_name = #link_new]
+        unsafe extern "C" fn #local_new(this: *mut ::cxx::private::RustVec<#ident>) {
+            ::std::ptr::write(this, ::cxx::private::RustVec::new());
+        }
+        #[doc(hidden)]
+        #[export_name = #link_drop]
+        unsafe extern "C" fn #local_drop(this: *mut ::cxx::private::RustVec<#ident>) {
+            ::std::ptr::drop_in_place(this);
+        }
+        #[doc(hidden)]
+        #[export_name = #link_len]
+        unsafe extern "C" fn #local_len(this: *const ::cxx::private::RustVec<#ident>) -> usize {
+            (*this).len()
+        }
+        #[doc(hidden)]
+        #[export_name = #link_data]
+        unsafe extern "C" fn #local_data(
+            this: *const ::cxx::private::RustVec<#ident>,
+        ) -> *const #ident {
+            (*this).as_ptr()
+        }
+        #[doc(hidden)]
+        #[export_name = #link_reserve_total]
+        unsafe extern "C" fn #local_reserve_total(
+            this: *mut ::cxx::private::RustVec<#ident>,
+            cap: usize,
+        ) -> bool {
+            (*this).reserve_total(cap)
+        }
+        #[doc(hidden)]
+        #[export_name = #link_set_len]
+        unsafe extern "C" fn #local_set_len(
+            this: *mut ::cxx::private::RustVec<#ident>,
+            len: usize,
+        ) {
+            (*this).set_len(len);
+        }
+        #[doc(hidden)]
+        #[export_name = #link_layout]
+        extern "C" fn #local_layout(ptr: &mut usize, len: &mut usize, cap: &mut usize) -> bool {
+            ::cxx::private::RustVec::<#ident>::layout(ptr, len, cap)
+        }
+    }
+}
+
 fn expand_unique_ptr(namespace: &Namespace, ident: &Ident) -> TokenStream {
     let prefix = format!("cxxbridge02$unique_ptr${}{}$", namespace, ident);
     let link_null = format!("{}null", prefix);
@@ -537,6 +946,180 @@ fn expand_unique_ptr(namespace: &Namespace, ident: &Ident) -> TokenStream {
     }
 }
 
+fn expand_shared_ptr(namespace: &Namespace, ident: &Ident) -> TokenStream {
+    let prefix = format!("cxxbridge02$shared_ptr${}{}$", namespace, ident);
+    let link_null = format!("{}null", prefix);
+    let link_clone = format!("{}clone", prefix);
+    let link_get = format!("{}get", prefix);
+    let link_drop = format!("{}drop", prefix);
+
+    quote! {
+        unsafe impl ::cxx::private::SharedPtrTarget for #ident {
+            unsafe fn __null(new: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_null]
+                    fn __null(new: *mut ::std::ffi::c_void);
+                }
+                __null(new);
+            }
+            unsafe fn __clone(this: *const ::std::ffi::c_void, new: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_clone]
+                    fn __clone(this: *const ::std::ffi::c_void, new: *mut ::std::ffi::c_void);
+                }
+                __clone(this, new);
+            }
+            unsafe fn __get(this: *const ::std::ffi::c_void) -> *const Self {
+                extern "C" {
+                    #[link_name = #link_get]
+                    fn __get(this: *const ::std::ffi::c_void) -> *const #ident;
+                }
+                __get(this)
+            }
+            unsafe fn __drop(this: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_drop]
+                    fn __drop(this: *mut ::std::ffi::c_void);
+                }
+                __drop(this);
+            }
+        }
+    }
+}
+
+fn expand_weak_ptr(namespace: &Namespace, ident: &Ident) -> TokenStream {
+    let prefix = format!("cxxbridge02$weak_ptr${}{}$", namespace, ident);
+    let link_null = format!("{}null", prefix);
+    let link_clone = format!("{}clone", prefix);
+    let link_downgrade = format!("{}downgrade", prefix);
+    let link_upgrade = format!("{}upgrade", prefix);
+    let link_drop = format!("{}drop", prefix);
+
+    quote! {
+        unsafe impl ::cxx::private::WeakPtrTarget for #ident {
+            unsafe fn __null(new: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_null]
+                    fn __null(new: *mut ::std::ffi::c_void);
+                }
+                __null(new);
+            }
+            unsafe fn __clone(this: *const ::std::ffi::c_void, new: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_clone]
+                    fn __clone(this: *const ::std::ffi::c_void, new: *mut ::std::ffi::c_void);
+                }
+                __clone(this, new);
+            }
+            unsafe fn __downgrade(shared: *const ::std::ffi::c_void, new: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_downgrade]
+                    fn __downgrade(shared: *const ::std::ffi::c_void, new: *mut ::std::ffi::c_void);
+                }
+                __downgrade(shared, new);
+            }
+            unsafe fn __upgrade(weak: *const ::std::ffi::c_void, shared: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_upgrade]
+                    fn __upgrade(weak: *const ::std::ffi::c_void, shared: *mut ::std::ffi::c_void);
+                }
+                __upgrade(weak, shared);
+            }
+            unsafe fn __drop(this: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_drop]
+                    fn __drop(this: *mut ::std::ffi::c_void);
+                }
+                __drop(this);
+            }
+        }
+    }
+}
+
+fn expand_cxx_vector(namespace: &Namespace, ident: &Ident) -> TokenStream {
+    let prefix = format!("cxxbridge02$std$vector${}{}$", namespace, ident);
+    let link_size = format!("{}size", prefix);
+    let link_data = format!("{}data", prefix);
+    let unique_ptr_prefix = format!("cxxbridge02$unique_ptr$std$vector${}{}$", namespace, ident);
+    let link_unique_ptr_null = format!("{}null", unique_ptr_prefix);
+    let link_unique_ptr_raw = format!("{}raw", unique_ptr_prefix);
+    let link_unique_ptr_get = format!("{}get", unique_ptr_prefix);
+    let link_unique_ptr_release = format!("{}release", unique_ptr_prefix);
+    let link_unique_ptr_drop = format!("{}drop", unique_ptr_prefix);
+
+    let span = ident.span();
+    quote_spanned! {span=>
+        unsafe impl ::cxx::private::VectorElement for #ident {
+            fn __vector_size(v: &::cxx::CxxVector<Self>) -> usize {
+                extern "C" {
+                    #[link_name = #link_size]
+                    fn __vector_size(_: &::cxx::CxxVector<#ident>) -> usize;
+                }
+                unsafe { __vector_size(v) }
+            }
+            unsafe fn __vector_data(v: &::cxx::CxxVector<Self>) -> *const Self {
+                extern "C" {
+                    #[link_name = #link_data]
+                    fn __vector_data(_: &::cxx::CxxVector<#ident>) -> *const #ident;
+                }
+                __vector_data(v)
+            }
+            fn __unique_ptr_null() -> *mut ::std::ffi::c_void {
+                extern "C" {
+                    #[link_name = #link_unique_ptr_null]
+                    fn __unique_ptr_null(this: *mut *mut ::std::ffi::c_void);
+                }
+                let mut repr = ::std::ptr::null_mut::<::std::ffi::c_void>();
+                unsafe { __unique_ptr_null(&mut repr) }
+                repr
+            }
+            unsafe fn __unique_ptr_raw(
+                raw: *mut ::cxx::CxxVector<Self>,
+            ) -> *mut ::std::ffi::c_void {
+                extern "C" {
+                    #[link_name = #link_unique_ptr_raw]
+                    fn __unique_ptr_raw(
+                        this: *mut *mut ::std::ffi::c_void,
+                        raw: *mut ::cxx::CxxVector<#ident>,
+                    );
+                }
+                let mut repr = ::std::ptr::null_mut::<::std::ffi::c_void>();
+                __unique_ptr_raw(&mut repr, raw);
+                repr
+            }
+            unsafe fn __unique_ptr_get(
+                repr: *mut ::std::ffi::c_void,
+            ) -> *const ::cxx::CxxVector<Self> {
+                extern "C" {
+                    #[link_name = #link_unique_ptr_get]
+                    fn __unique_ptr_get(
+                        this: *const *mut ::std::ffi::c_void,
+                    ) -> *const ::cxx::CxxVector<#ident>;
+                }
+                __unique_ptr_get(&repr)
+            }
+            unsafe fn __unique_ptr_release(
+                mut repr: *mut ::std::ffi::c_void,
+            ) -> *mut ::cxx::CxxVector<Self> {
+                extern "C" {
+                    #[link_name = #link_unique_ptr_release]
+                    fn __unique_ptr_release(
+                        this: *mut *mut ::std::ffi::c_void,
+                    ) -> *mut ::cxx::CxxVector<#ident>;
+                }
+                __unique_ptr_release(&mut repr)
+            }
+            unsafe fn __unique_ptr_drop(mut repr: *mut ::std::ffi::c_void) {
+                extern "C" {
+                    #[link_name = #link_unique_ptr_drop]
+                    fn __unique_ptr_drop(this: *mut *mut ::std::ffi::c_void);
+                }
+                __unique_ptr_drop(&mut repr);
+            }
+        }
+    }
+}
+
 fn expand_return_type(ret: &Option<Type>) -> TokenStream {
     match ret {
         Some(ret) => quote!(-> #ret),
@@ -545,9 +1128,11 @@ fn expand_return_type(ret: &Option<Type>) -> TokenStream {
 }
 
 fn indirect_return(sig: &Signature, types: &Types) -> bool {
-    sig.ret
-        .as_ref()
-        .map_or(false, |ret| sig.throws || types.needs_indirect_abi(ret))
+    sig.asyncness.is_none()
+        && sig
+            .ret
+            .as_ref()
+            .map_or(false, |ret| sig.throws || types.needs_indirect_abi(ret))
 }
 
 fn expand_extern_type(ty: &Type) -> TokenStream {
@@ -557,11 +1142,23 @@ fn expand_extern_type(ty: &Type) -> TokenStream {
             let inner = &ty.inner;
             quote!(*mut #inner)
         }
+        Type::RustVec(ty) => {
+            let inner = &ty.inner;
+            quote!(::cxx::private::RustVec<#inner>)
+        }
         Type::Ref(ty) => match &ty.inner {
             Type::Ident(ident) if ident == RustString => quote!(&::cxx::private::RustString),
+            Type::RustVec(vec) => {
+                let inner = &vec.inner;
+                match ty.mutability {
+                    None => quote!(&::cxx::private::RustVec<#inner>),
+                    Some(_) => quote!(&mut ::cxx::private::RustVec<#inner>),
+                }
+            }
             _ => quote!(#ty),
         },
         Type::Str(_) => quote!(::cxx::private::RustStr),
+        Type::SliceRef(_) => quote!(::cxx::private::RustSlice),
         _ => quote!(#ty),
     }
 }
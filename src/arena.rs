@@ -0,0 +1,210 @@
+use std::alloc::{self, Layout};
+use std::cell::Cell;
+use std::cmp;
+use std::fmt::{self, Debug};
+use std::mem;
+use std::panic::{RefUnwindSafe, UnwindSafe};
+use std::ptr::{self, NonNull};
+
+/// Bump allocator for short-lived objects shared with C++, referred to as
+/// `rust::Arena` on the C++ side.
+///
+/// A `&Arena` can be passed across the bridge in either direction. Objects
+/// allocated from it, whether by [`alloc`](Arena::alloc) in Rust or by
+/// `arena.make<T>(...)` in C++, live until the arena is dropped or
+/// [`reset`](Arena::reset), which releases all of them at once instead of
+/// freeing each one. Their destructors are never run; C++ only accepts
+/// trivially destructible types for this reason.
+///
+/// A C++ function that takes the arena and returns a reference, such as `fn
+/// make_thing(arena: &Arena) -> &Thing`, hands out an object whose lifetime the
+/// borrow checker ties to the arena.
+#[repr(C)]
+pub struct Arena {
+    // Bump region within the newest chunk.
+    next: Cell<usize>,
+    end: Cell<usize>,
+    // Newest chunk, or null. Chunks are linked through a header at their start
+    // so that the arena allocates nothing besides the chunks themselves.
+    chunk: Cell<*mut ChunkHeader>,
+}
+
+#[repr(C)]
+struct ChunkHeader {
+    prev: *mut ChunkHeader,
+    size: usize,
+}
+
+const CHUNK_ALIGN: usize = 16;
+const HEADER_SIZE: usize = 16;
+const MIN_CHUNK_SIZE: usize = 4096;
+const MAX_CHUNK_SIZE: usize = 1 << 20;
+
+const_assert!(mem::size_of::<ChunkHeader>() <= HEADER_SIZE);
+const_assert!(mem::align_of::<ChunkHeader>() <= CHUNK_ALIGN);
+
+impl Arena {
+    /// Creates an arena that allocates its first chunk on first use.
+    pub fn new() -> Self {
+        Arena {
+            next: Cell::new(0),
+            end: Cell::new(0),
+            chunk: Cell::new(ptr::null_mut()),
+        }
+    }
+
+    /// Creates an arena whose first chunk holds at least `bytes` bytes.
+    pub fn with_capacity(bytes: usize) -> Self {
+        let arena = Arena::new();
+        if bytes > 0 && !arena.grow(bytes) {
+            panic!("arena capacity of {} bytes could not be allocated", bytes);
+        }
+        arena
+    }
+
+    /// Moves `value` into the arena. Its destructor will not run.
+    pub fn alloc<T>(&self, value: T) -> &mut T {
+        let ptr = self.alloc_layout(Layout::new::<T>()).cast::<T>();
+        unsafe {
+            ptr::write(ptr.as_ptr(), value);
+            &mut *ptr.as_ptr()
+        }
+    }
+
+    /// Releases every object allocated so far. The newest chunk is kept for
+    /// reuse, so an arena reset once per request stops allocating after the
+    /// first few requests.
+    pub fn reset(&mut self) {
+        let chunk = self.chunk.get();
+        if chunk.is_null() {
+            return;
+        }
+        unsafe {
+            free_chunks((*chunk).prev);
+            (*chunk).prev = ptr::null_mut();
+            self.next.set(chunk as usize + HEADER_SIZE);
+            self.end.set(chunk as usize + (*chunk).size);
+        }
+    }
+
+    /// Total size of the chunks currently held by the arena.
+    pub fn capacity(&self) -> usize {
+        let mut capacity = 0;
+        let mut chunk = self.chunk.get();
+        while !chunk.is_null() {
+            unsafe {
+                capacity += (*chunk).size;
+                chunk = (*chunk).prev;
+            }
+        }
+        capacity
+    }
+
+    fn alloc_layout(&self, layout: Layout) -> NonNull<u8> {
+        match self.try_alloc_layout(layout) {
+            Some(ptr) => ptr,
+            None => alloc::handle_alloc_error(layout),
+        }
+    }
+
+    // None if no chunk big enough for the layout can be allocated. Does not
+    // panic, since C++ reaches it through arena_alloc.
+    fn try_alloc_layout(&self, layout: Layout) -> Option<NonNull<u8>> {
+        if let Some(ptr) = self.bump(layout) {
+            return Some(ptr);
+        }
+        if !self.grow(layout.size().checked_add(layout.align())?) {
+            return None;
+        }
+        self.bump(layout)
+    }
+
+    fn bump(&self, layout: Layout) -> Option<NonNull<u8>> {
+        let start = self.next.get().checked_add(layout.align() - 1)? & !(layout.align() - 1);
+        let end = start.checked_add(layout.size())?;
+        if end > self.end.get() {
+            return None;
+        }
+        self.next.set(end);
+        // The chunk is never at address 0, and a zero-sized allocation in an
+        // arena that has no chunk yet gets an aligned dangling pointer.
+        NonNull::new(start as *mut u8).or_else(|| NonNull::new(layout.align() as *mut u8))
+    }
+
+    // Returns false, leaving the arena as it was, if the chunk size overflows
+    // or the allocator fails.
+    fn grow(&self, min_size: usize) -> bool {
+        let prev = self.chunk.get();
+        let prev_size = if prev.is_null() {
+            0
+        } else {
+            unsafe { (*prev).size }
+        };
+        let doubled = cmp::min(prev_size.saturating_mul(2), MAX_CHUNK_SIZE);
+        let size = cmp::max(
+            cmp::max(doubled, MIN_CHUNK_SIZE),
+            min_size.saturating_add(HEADER_SIZE),
+        );
+        let layout = match Layout::from_size_align(size, CHUNK_ALIGN) {
+            Ok(layout) => layout,
+            Err(_) => return false,
+        };
+        let chunk = unsafe { alloc::alloc(layout) } as *mut ChunkHeader;
+        if chunk.is_null() {
+            return false;
+        }
+        unsafe { ptr::write(chunk, ChunkHeader { prev, size }) };
+        self.chunk.set(chunk);
+        self.next.set(chunk as usize + HEADER_SIZE);
+        self.end.set(chunk as usize + size);
+        true
+    }
+}
+
+unsafe fn free_chunks(mut chunk: *mut ChunkHeader) {
+    while !chunk.is_null() {
+        let prev = (*chunk).prev;
+        let layout = Layout::from_size_align_unchecked((*chunk).size, CHUNK_ALIGN);
+        alloc::dealloc(chunk as *mut u8, layout);
+        chunk = prev;
+    }
+}
+
+impl Default for Arena {
+    fn default() -> Self {
+        Arena::new()
+    }
+}
+
+impl Drop for Arena {
+    fn drop(&mut self) {
+        unsafe { free_chunks(self.chunk.get()) }
+    }
+}
+
+impl Debug for Arena {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Arena")
+            .field("capacity", &self.capacity())
+            .finish()
+    }
+}
+
+// The chunks are plain memory owned by the arena, and nothing in it is tied to
+// the thread that created it.
+unsafe impl Send for Arena {}
+
+// A panic cannot leave the bump pointers describing memory outside the newest
+// chunk, so an arena that was in use during a panic is still sound to use.
+impl RefUnwindSafe for Arena {}
+impl UnwindSafe for Arena {}
+
+#[export_name = "cxxbridge02$arena$alloc"]
+extern "C" fn arena_alloc(this: &Arena, size: usize, align: usize) -> *mut u8 {
+    // rust::Arena::allocate is public, so the size is not necessarily that of
+    // a C++ type. Null makes it throw std::bad_alloc.
+    Layout::from_size_align(size, align)
+        .ok()
+        .and_then(|layout| this.try_alloc_layout(layout))
+        .map_or(ptr::null_mut(), NonNull::as_ptr)
+}
@@ -16,6 +16,13 @@ impl ToBool for [(); 1] {
     const BOOL: Self::Bool = True;
 }
 
+// Rounds offset up to a multiple of align, which is where #[repr(C)] places a
+// field with that alignment. Used by the layout assertions that are generated
+// for shared structs.
+pub const fn align_up(offset: usize, align: usize) -> usize {
+    (offset + align - 1) / align * align
+}
+
 macro_rules! bool {
     ($e:expr) => {{
         const EXPR: bool = $e;
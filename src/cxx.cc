@@ -1,8 +1,33 @@
 #include "../include/cxx.h"
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Set by build.rs when the inline-cxx-string feature lets Rust read
+// std::string in place; see raw_parts in cxx_string.rs. Fail the build here
+// rather than misread strings at runtime if the guessed library is wrong.
+#if defined(CXXBRIDGE02_CXX_STRING_LIBSTDCXX)
+#if !defined(__GLIBCXX__) || !_GLIBCXX_USE_CXX11_ABI
+#error "inline-cxx-string: expected libstdc++ with the C++11 string ABI"
+#endif
+static_assert(sizeof(std::string) == 4 * sizeof(void *),
+              "unexpected libstdc++ std::string layout");
+#elif defined(CXXBRIDGE02_CXX_STRING_LIBCXX)
+#if !defined(_LIBCPP_VERSION) || defined(_LIBCPP_ABI_ALTERNATE_STRING_LAYOUT)
+#error "inline-cxx-string: expected libc++ with the default string layout"
+#endif
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "inline-cxx-string: libc++ layout is only handled on little endian"
+#endif
+static_assert(sizeof(std::string) == 3 * sizeof(void *),
+              "unexpected libc++ std::string layout");
+#endif
 
 extern "C" {
 const char *cxxbridge02$cxx_string$data(const std::string &s) noexcept {
@@ -13,18 +38,33 @@ size_t cxxbridge02$cxx_string$length(const std::string &s) noexcept {
   return s.length();
 }
 
+const char *cxxbridge02$cxx_string$view(const std::string &s,
+                                        size_t *len) noexcept {
+  *len = s.length();
+  return s.data();
+}
+
 // rust::String
 void cxxbridge02$string$new(rust::String *self) noexcept;
 void cxxbridge02$string$clone(rust::String *self,
                               const rust::String &other) noexcept;
-bool cxxbridge02$string$from(rust::String *self, const char *ptr,
-                             size_t len) noexcept;
+void cxxbridge02$string$from_unchecked(rust::String *self, const char *ptr,
+                                       size_t len) noexcept;
 void cxxbridge02$string$drop(rust::String *self) noexcept;
 const char *cxxbridge02$string$ptr(const rust::String *self) noexcept;
 size_t cxxbridge02$string$len(const rust::String *self) noexcept;
+bool cxxbridge02$string$layout(size_t *ptr, size_t *len,
+                              std::array<uintptr_t, 3> *empty) noexcept;
 
-// rust::Str
-bool cxxbridge02$str$valid(const char *ptr, size_t len) noexcept;
+// rust::Arena
+void *cxxbridge02$arena$alloc(const rust::Arena &self, size_t size,
+                              size_t align) noexcept;
+
+// utf8.cc
+bool cxxbridge02$utf8$valid(const char *ptr, size_t len) noexcept;
+
+// rust::bridge_stats
+size_t cxxbridge02$stats$collect(rust::BridgeStats *out, size_t cap) noexcept;
 } // extern "C"
 
 namespace rust {
@@ -36,41 +76,42 @@ String::String(const String &other) noexcept {
   cxxbridge02$string$clone(this, other);
 }
 
-String::String(String &&other) noexcept {
-  this->repr = other.repr;
-  cxxbridge02$string$new(&other);
-}
-
 String::~String() noexcept { cxxbridge02$string$drop(this); }
 
 String::String(const std::string &s) {
   auto ptr = s.data();
   auto len = s.length();
-  if (!cxxbridge02$string$from(this, ptr, len)) {
+  if (!cxxbridge02$utf8$valid(ptr, len)) {
     throw std::invalid_argument("data for rust::String is not utf-8");
   }
+  cxxbridge02$string$from_unchecked(this, ptr, len);
+}
+
+String::String(std::string &&s)
+    : String(static_cast<const std::string &>(s)) {
+  std::string().swap(s);
 }
 
 String::String(const char *s) {
   auto len = std::strlen(s);
-  if (!cxxbridge02$string$from(this, s, len)) {
+  if (!cxxbridge02$utf8$valid(s, len)) {
     throw std::invalid_argument("data for rust::String is not utf-8");
   }
+  cxxbridge02$string$from_unchecked(this, s, len);
 }
 
-String &String::operator=(const String &other) noexcept {
-  if (this != &other) {
-    cxxbridge02$string$drop(this);
-    cxxbridge02$string$clone(this, other);
-  }
-  return *this;
+String::String(unchecked_t, const char *ptr, size_t len) noexcept {
+  cxxbridge02$string$from_unchecked(this, ptr, len);
+}
+
+String String::from_utf8_unchecked(const char *ptr, size_t len) noexcept {
+  return String(unchecked_t{}, ptr, len);
 }
 
-String &String::operator=(String &&other) noexcept {
+String &String::operator=(const String &other) noexcept {
   if (this != &other) {
     cxxbridge02$string$drop(this);
-    this->repr = other.repr;
-    cxxbridge02$string$new(&other);
+    cxxbridge02$string$clone(this, other);
   }
   return *this;
 }
@@ -79,13 +120,38 @@ String::operator std::string() const {
   return std::string(this->data(), this->size());
 }
 
-const char *String::data() const noexcept {
+const char *String::ffi_data() const noexcept {
   return cxxbridge02$string$ptr(this);
 }
 
-size_t String::size() const noexcept { return cxxbridge02$string$len(this); }
+size_t String::ffi_size() const noexcept {
+  return cxxbridge02$string$len(this);
+}
 
-size_t String::length() const noexcept { return cxxbridge02$string$len(this); }
+void String::ffi_new() noexcept { cxxbridge02$string$new(this); }
+
+String::Layout String::layout = []() noexcept -> String::Layout {
+  size_t ptr, len;
+  std::array<uintptr_t, 3> empty;
+  if (cxxbridge02$string$layout(&ptr, &len, &empty)) {
+    return {true, static_cast<uint8_t>(ptr), static_cast<uint8_t>(len), empty};
+  }
+  return {false, 0, 0, {}};
+}();
+
+void vec_capacity_overflow() {
+  throw std::length_error("capacity overflow in rust::Vec");
+}
+
+VecLayout VecLayout::probe(bool (*shim)(size_t *ptr, size_t *len,
+                                        size_t *cap)) noexcept {
+  size_t ptr, len, cap;
+  if (shim(&ptr, &len, &cap)) {
+    return {true, static_cast<uint8_t>(ptr), static_cast<uint8_t>(len),
+            static_cast<uint8_t>(cap)};
+  }
+  return {false, 0, 0, 0};
+}
 
 String::String(unsafe_bitcopy_t, const String &bits) noexcept
     : repr(bits.repr) {}
@@ -100,17 +166,21 @@ Str::Str() noexcept : repr(Repr{reinterpret_cast<const char *>(this), 0}) {}
 Str::Str(const Str &) noexcept = default;
 
 Str::Str(const std::string &s) : repr(Repr{s.data(), s.length()}) {
-  if (!cxxbridge02$str$valid(this->repr.ptr, this->repr.len)) {
+  if (!cxxbridge02$utf8$valid(this->repr.ptr, this->repr.len)) {
     throw std::invalid_argument("data for rust::Str is not utf-8");
   }
 }
 
 Str::Str(const char *s) : repr(Repr{s, std::strlen(s)}) {
-  if (!cxxbridge02$str$valid(this->repr.ptr, this->repr.len)) {
+  if (!cxxbridge02$utf8$valid(this->repr.ptr, this->repr.len)) {
     throw std::invalid_argument("data for rust::Str is not utf-8");
   }
 }
 
+Str Str::from_utf8_unchecked(const char *ptr, size_t len) noexcept {
+  return Str(Repr{ptr, len});
+}
+
 Str &Str::operator=(Str other) noexcept {
   this->repr = other.repr;
   return *this;
@@ -135,32 +205,145 @@ std::ostream &operator<<(std::ostream &os, const Str &s) {
   return os;
 }
 
+namespace {
+// Short messages travel from Rust to the Error constructor through this
+// buffer instead of the heap. The generated shim constructs the Error on the
+// same thread right after the Rust function returns, before anything else can
+// stage another message.
+constexpr size_t error_small_capacity = 48;
+thread_local char error_staging[error_small_capacity];
+thread_local int64_t error_staging_code;
+
+// Longer messages are preceded by their reference count.
+using error_refcount = std::atomic<size_t>;
+
+error_refcount &error_refs(const char *msg) noexcept {
+  return *reinterpret_cast<error_refcount *>(const_cast<char *>(msg) -
+                                             sizeof(error_refcount));
+}
+} // namespace
+
 extern "C" {
-const char *cxxbridge02$error(const char *ptr, size_t len) {
-  char *copy = new char[len];
-  strncpy(copy, ptr, len);
+const char *cxxbridge02$error(const char *ptr, size_t len) noexcept {
+  if (len < error_small_capacity) {
+    std::memcpy(error_staging, ptr, len);
+    error_staging[len] = '\0';
+    error_staging_code = 0;
+    return error_staging;
+  }
+  void *alloc = ::operator new(sizeof(error_refcount) + len + 1);
+  new (alloc) error_refcount(1);
+  char *copy = static_cast<char *>(alloc) + sizeof(error_refcount);
+  std::memcpy(copy, ptr, len);
+  copy[len] = '\0';
   return copy;
 }
+
+const char *cxxbridge02$error$code(int64_t code, size_t *len) noexcept {
+  int n = std::snprintf(error_staging, error_small_capacity, "error code %lld",
+                        static_cast<long long>(code));
+  *len = static_cast<size_t>(n);
+  error_staging_code = code;
+  return error_staging;
+}
 } // extern "C"
 
-Error::Error(Str::Repr msg) noexcept : msg(msg) {}
+Error::Error(Str::Repr msg) noexcept : errcode(0) {
+  static_assert(sizeof(this->small) == error_small_capacity, "");
+  if (msg.ptr == error_staging) {
+    std::memcpy(this->small, msg.ptr, msg.len + 1);
+    this->msg = Str::Repr{this->small, msg.len};
+    this->errcode = error_staging_code;
+  } else {
+    this->msg = msg;
+  }
+}
+
+Error::Error(const Error &other) noexcept { this->copy_from(other); }
+
+Error::Error(Error &&other) noexcept { this->move_from(std::move(other)); }
+
+Error::~Error() noexcept { this->release(); }
+
+Error &Error::operator=(const Error &other) noexcept {
+  if (this != &other) {
+    this->release();
+    this->copy_from(other);
+  }
+  return *this;
+}
+
+Error &Error::operator=(Error &&other) noexcept {
+  if (this != &other) {
+    this->release();
+    this->move_from(std::move(other));
+  }
+  return *this;
+}
 
-Error::Error(const Error &other) {
-  this->msg.ptr = cxxbridge02$error(other.msg.ptr, other.msg.len);
-  this->msg.len = other.msg.len;
+// An inline message is copied into this error's own buffer; msg must never
+// point into another error's small buffer.
+void Error::copy_from(const Error &other) noexcept {
+  this->errcode = other.errcode;
+  if (other.msg.ptr == other.small) {
+    std::memcpy(this->small, other.small, other.msg.len + 1);
+    this->msg = Str::Repr{this->small, other.msg.len};
+  } else {
+    error_refs(other.msg.ptr).fetch_add(1, std::memory_order_relaxed);
+    this->msg = other.msg;
+  }
 }
 
-Error::Error(Error &&other) noexcept {
-  delete[] this->msg.ptr;
-  this->msg = other.msg;
-  other.msg.ptr = nullptr;
-  other.msg.len = 0;
+// Takes over other's reference to a heap message, leaving other empty.
+void Error::move_from(Error &&other) noexcept {
+  this->errcode = other.errcode;
+  if (other.msg.ptr == other.small) {
+    std::memcpy(this->small, other.small, other.msg.len + 1);
+    this->msg = Str::Repr{this->small, other.msg.len};
+  } else {
+    this->msg = other.msg;
+    other.small[0] = '\0';
+    other.msg = Str::Repr{other.small, 0};
+  }
 }
 
-Error::~Error() noexcept { delete[] this->msg.ptr; }
+void Error::release() noexcept {
+  if (this->msg.ptr != this->small &&
+      error_refs(this->msg.ptr).fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    error_refcount &refs = error_refs(this->msg.ptr);
+    refs.~error_refcount();
+    ::operator delete(&refs);
+  }
+}
 
 const char *Error::what() const noexcept { return this->msg.ptr; }
 
+int64_t Error::code() const noexcept { return this->errcode; }
+
+void Error::raise(Str::Repr msg) { throw Error(msg); }
+
+void *Arena::allocate(size_t size, size_t align) const {
+  void *ptr = cxxbridge02$arena$alloc(*this, size, align);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+static_assert(sizeof(BridgeStats) == sizeof(Str::Repr) + 2 * sizeof(uint64_t),
+              "BridgeStats layout must match CallStatsRepr in stats.rs");
+
+std::vector<BridgeStats> bridge_stats() {
+  std::vector<BridgeStats> stats;
+  size_t len;
+  while ((len = cxxbridge02$stats$collect(stats.data(), stats.size())) >
+         stats.size()) {
+    stats.resize(len);
+  }
+  stats.resize(len);
+  return stats;
+}
+
 } // namespace cxxbridge02
 } // namespace rust
 
@@ -190,3 +373,187 @@ void cxxbridge02$unique_ptr$std$string$drop(
   ptr->~unique_ptr();
 }
 } // extern "C"
+
+extern "C" {
+void cxxbridge02$shared_ptr$std$string$null(
+    std::shared_ptr<std::string> *ptr) noexcept {
+  new (ptr) std::shared_ptr<std::string>();
+}
+void cxxbridge02$shared_ptr$std$string$clone(
+    const std::shared_ptr<std::string> &self,
+    std::shared_ptr<std::string> *ptr) noexcept {
+  new (ptr) std::shared_ptr<std::string>(self);
+}
+const std::string *cxxbridge02$shared_ptr$std$string$get(
+    const std::shared_ptr<std::string> &self) noexcept {
+  return self.get();
+}
+void cxxbridge02$shared_ptr$std$string$drop(
+    std::shared_ptr<std::string> *self) noexcept {
+  self->~shared_ptr();
+}
+
+void cxxbridge02$weak_ptr$std$string$null(
+    std::weak_ptr<std::string> *ptr) noexcept {
+  new (ptr) std::weak_ptr<std::string>();
+}
+void cxxbridge02$weak_ptr$std$string$clone(
+    const std::weak_ptr<std::string> &self,
+    std::weak_ptr<std::string> *ptr) noexcept {
+  new (ptr) std::weak_ptr<std::string>(self);
+}
+void cxxbridge02$weak_ptr$std$string$downgrade(
+    const std::shared_ptr<std::string> &shared,
+    std::weak_ptr<std::string> *weak) noexcept {
+  new (weak) std::weak_ptr<std::string>(shared);
+}
+void cxxbridge02$weak_ptr$std$string$upgrade(
+    const std::weak_ptr<std::string> &weak,
+    std::shared_ptr<std::string> *shared) noexcept {
+  new (shared) std::shared_ptr<std::string>(weak.lock());
+}
+void cxxbridge02$weak_ptr$std$string$drop(
+    std::weak_ptr<std::string> *self) noexcept {
+  self->~weak_ptr();
+}
+} // extern "C"
+
+#define RUST_VEC_EXTERNS(RUST_TYPE, CXX_TYPE)                                  \
+  void cxxbridge02$rust_vec$##RUST_TYPE##$new(                                 \
+      rust::Vec<CXX_TYPE> *ptr) noexcept;                                      \
+  void cxxbridge02$rust_vec$##RUST_TYPE##$drop(                                \
+      rust::Vec<CXX_TYPE> *ptr) noexcept;                                      \
+  size_t cxxbridge02$rust_vec$##RUST_TYPE##$len(                               \
+      const rust::Vec<CXX_TYPE> *ptr) noexcept;                                \
+  const CXX_TYPE *cxxbridge02$rust_vec$##RUST_TYPE##$data(                     \
+      const rust::Vec<CXX_TYPE> *ptr) noexcept;                                \
+  bool cxxbridge02$rust_vec$##RUST_TYPE##$reserve_total(                       \
+      rust::Vec<CXX_TYPE> *ptr, size_t cap) noexcept;                          \
+  void cxxbridge02$rust_vec$##RUST_TYPE##$set_len(rust::Vec<CXX_TYPE> *ptr,    \
+                                                  size_t len) noexcept;        \
+  bool cxxbridge02$rust_vec$##RUST_TYPE##$layout(size_t *ptr, size_t *len,     \
+                                                 size_t *cap) noexcept;
+
+#define RUST_VEC_OPS(RUST_TYPE, CXX_TYPE)                                      \
+  template <>                                                                  \
+  void Vec<CXX_TYPE>::init() noexcept {                                        \
+    cxxbridge02$rust_vec$##RUST_TYPE##$new(this);                              \
+  }                                                                            \
+  template <>                                                                  \
+  void Vec<CXX_TYPE>::drop() noexcept {                                        \
+    cxxbridge02$rust_vec$##RUST_TYPE##$drop(this);                             \
+  }                                                                            \
+  template <>                                                                  \
+  size_t Vec<CXX_TYPE>::ffi_size() const noexcept {                            \
+    return cxxbridge02$rust_vec$##RUST_TYPE##$len(this);                       \
+  }                                                                            \
+  template <>                                                                  \
+  const CXX_TYPE *Vec<CXX_TYPE>::ffi_data() const noexcept {                   \
+    return cxxbridge02$rust_vec$##RUST_TYPE##$data(this);                      \
+  }                                                                            \
+  template <>                                                                  \
+  bool Vec<CXX_TYPE>::ffi_reserve_total(size_t cap) noexcept {                 \
+    return cxxbridge02$rust_vec$##RUST_TYPE##$reserve_total(this, cap);        \
+  }                                                                            \
+  template <>                                                                  \
+  void Vec<CXX_TYPE>::set_len(size_t len) noexcept {                           \
+    cxxbridge02$rust_vec$##RUST_TYPE##$set_len(this, len);                     \
+  }                                                                            \
+  template <>                                                                  \
+  VecLayout Vec<CXX_TYPE>::layout =                                            \
+      VecLayout::probe(cxxbridge02$rust_vec$##RUST_TYPE##$layout);
+
+// size_t and its signed counterpart are usually the same C++ type as one of
+// the fixed-width integers, whose instantiation then already covers them. In
+// that case they are swapped for a placeholder here so that the same
+// specialization is not defined twice. The signed one is spelled with
+// make_signed because ssize_t is POSIX only.
+struct cxxbridge02$usize_placeholder;
+struct cxxbridge02$isize_placeholder;
+using cxxbridge02$ssize = std::make_signed<size_t>::type;
+using cxxbridge02$usize =
+    std::conditional<std::is_same<size_t, uint64_t>::value ||
+                         std::is_same<size_t, uint32_t>::value,
+                     cxxbridge02$usize_placeholder, size_t>::type;
+using cxxbridge02$isize =
+    std::conditional<std::is_same<cxxbridge02$ssize, int64_t>::value ||
+                         std::is_same<cxxbridge02$ssize, int32_t>::value,
+                     cxxbridge02$isize_placeholder, cxxbridge02$ssize>::type;
+
+// Keep in sync with rust_vec_shims_for_primitive! in rust_vec.rs.
+#define FOR_EACH_RUST_VEC_PRIMITIVE(MACRO)                                     \
+  MACRO(bool, bool)                                                            \
+  MACRO(u8, uint8_t)                                                           \
+  MACRO(u16, uint16_t)                                                         \
+  MACRO(u32, uint32_t)                                                         \
+  MACRO(u64, uint64_t)                                                         \
+  MACRO(usize, cxxbridge02$usize)                                              \
+  MACRO(i8, int8_t)                                                            \
+  MACRO(i16, int16_t)                                                          \
+  MACRO(i32, int32_t)                                                          \
+  MACRO(i64, int64_t)                                                          \
+  MACRO(isize, cxxbridge02$isize)                                              \
+  MACRO(f32, float)                                                            \
+  MACRO(f64, double)
+
+extern "C" {
+FOR_EACH_RUST_VEC_PRIMITIVE(RUST_VEC_EXTERNS)
+} // extern "C"
+
+namespace rust {
+inline namespace cxxbridge02 {
+FOR_EACH_RUST_VEC_PRIMITIVE(RUST_VEC_OPS)
+} // namespace cxxbridge02
+} // namespace rust
+
+#define STD_VECTOR_OPS(RUST_TYPE, CXX_TYPE)                                    \
+  size_t cxxbridge02$std$vector$##RUST_TYPE##$size(                            \
+      const std::vector<CXX_TYPE> &s) noexcept {                               \
+    return s.size();                                                           \
+  }                                                                            \
+  const CXX_TYPE *cxxbridge02$std$vector$##RUST_TYPE##$data(                   \
+      const std::vector<CXX_TYPE> &s) noexcept {                               \
+    return s.data();                                                           \
+  }                                                                            \
+  void cxxbridge02$unique_ptr$std$vector$##RUST_TYPE##$null(                   \
+      std::unique_ptr<std::vector<CXX_TYPE>> *ptr) noexcept {                  \
+    new (ptr) std::unique_ptr<std::vector<CXX_TYPE>>();                        \
+  }                                                                            \
+  void cxxbridge02$unique_ptr$std$vector$##RUST_TYPE##$raw(                    \
+      std::unique_ptr<std::vector<CXX_TYPE>> *ptr,                             \
+      std::vector<CXX_TYPE> *raw) noexcept {                                   \
+    new (ptr) std::unique_ptr<std::vector<CXX_TYPE>>(raw);                     \
+  }                                                                            \
+  const std::vector<CXX_TYPE> *                                                \
+      cxxbridge02$unique_ptr$std$vector$##RUST_TYPE##$get(                     \
+      const std::unique_ptr<std::vector<CXX_TYPE>> &ptr) noexcept {            \
+    return ptr.get();                                                          \
+  }                                                                            \
+  std::vector<CXX_TYPE> *                                                      \
+      cxxbridge02$unique_ptr$std$vector$##RUST_TYPE##$release(                 \
+      std::unique_ptr<std::vector<CXX_TYPE>> &ptr) noexcept {                  \
+    return ptr.release();                                                      \
+  }                                                                            \
+  void cxxbridge02$unique_ptr$std$vector$##RUST_TYPE##$drop(                   \
+      std::unique_ptr<std::vector<CXX_TYPE>> *ptr) noexcept {                  \
+    ptr->~unique_ptr();                                                        \
+  }
+
+// Keep in sync with vector_element_for_primitive! in cxx_vector.rs. Unlike
+// rust::Vec these are plain functions rather than template specializations,
+// so size_t and its signed counterpart can be listed even if they alias a
+// fixed-width type, and need no placeholder.
+extern "C" {
+STD_VECTOR_OPS(u8, uint8_t)
+STD_VECTOR_OPS(u16, uint16_t)
+STD_VECTOR_OPS(u32, uint32_t)
+STD_VECTOR_OPS(u64, uint64_t)
+STD_VECTOR_OPS(usize, size_t)
+STD_VECTOR_OPS(i8, int8_t)
+STD_VECTOR_OPS(i16, int16_t)
+STD_VECTOR_OPS(i32, int32_t)
+STD_VECTOR_OPS(i64, int64_t)
+STD_VECTOR_OPS(isize, cxxbridge02$ssize)
+STD_VECTOR_OPS(f32, float)
+STD_VECTOR_OPS(f64, double)
+} // extern "C"
@@ -0,0 +1,309 @@
+use std::any::Any;
+use std::ffi::c_void;
+use std::fmt::{self, Debug};
+use std::io::{self, Read, Write};
+use std::panic::{self, AssertUnwindSafe};
+use std::slice;
+
+extern "C" {
+    #[link_name = "cxxbridge02$istream$read"]
+    fn istream_read(_: &mut CxxIstream, buf: *mut u8, len: usize, n: &mut usize) -> bool;
+    #[link_name = "cxxbridge02$ostream$write"]
+    fn ostream_write(_: &mut CxxOstream, buf: *const u8, len: usize) -> bool;
+    #[link_name = "cxxbridge02$ostream$flush"]
+    fn ostream_flush(_: &mut CxxOstream) -> bool;
+    #[link_name = "cxxbridge02$istream$scope"]
+    fn istream_scope(
+        source: *mut c_void,
+        buf: *mut u8,
+        len: usize,
+        f: unsafe extern "C" fn(*mut c_void, &mut CxxIstream),
+        ctx: *mut c_void,
+    );
+    #[link_name = "cxxbridge02$ostream$scope"]
+    fn ostream_scope(
+        sink: *mut c_void,
+        buf: *mut u8,
+        len: usize,
+        f: unsafe extern "C" fn(*mut c_void, &mut CxxOstream),
+        ctx: *mut c_void,
+    );
+}
+
+/// Binding to C++ `std::istream`.
+///
+/// Like [`CxxString`](crate::CxxString), a stream is never seen by value in
+/// Rust, only as `&mut CxxIstream` in the signature of a bridge function. It
+/// implements [`Read`], so `io::copy(stream, &mut file)` moves a C++ stream into
+/// a Rust writer one buffer at a time. In the other direction,
+/// [`with_reader`](CxxIstream::with_reader) makes a `std::istream` that pulls
+/// from a Rust reader for C++ code to consume.
+#[repr(C)]
+pub struct CxxIstream {
+    _private: [u8; 0],
+}
+
+/// Binding to C++ `std::ostream`.
+///
+/// The counterpart of [`CxxIstream`]: `&mut CxxOstream` implements [`Write`],
+/// and [`with_writer`](CxxOstream::with_writer) makes a `std::ostream` that
+/// pushes to a Rust writer.
+#[repr(C)]
+pub struct CxxOstream {
+    _private: [u8; 0],
+}
+
+impl CxxIstream {
+    /// Calls `f` with a `std::istream` that reads from `reader`.
+    ///
+    /// The stream is buffered in `buf`, which is refilled by one call to
+    /// `reader.read` at a time; a C++ read of at least `buf.len()` bytes goes
+    /// to the reader directly without a copy. Nothing is allocated. An error
+    /// from the reader sets `badbit` on the stream, and once `f` returns, the
+    /// error is returned in place of its result. A panic in the reader is
+    /// resumed after `f` returns.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `buf` is empty.
+    pub fn with_reader<R, F, T>(mut reader: R, buf: &mut [u8], f: F) -> io::Result<T>
+    where
+        R: Read,
+        F: FnOnce(&mut CxxIstream) -> T,
+    {
+        assert!(!buf.is_empty(), "stream buffer must not be empty");
+        let mut source = Source {
+            reader: &mut reader,
+            failure: Failure::default(),
+        };
+        let mut scope = Scope::new(f);
+        unsafe {
+            istream_scope(
+                &mut source as *mut Source as *mut c_void,
+                buf.as_mut_ptr(),
+                buf.len(),
+                Scope::<F, T>::call::<CxxIstream>,
+                scope.as_ctx(),
+            );
+        }
+        source.failure.finish(scope.finish())
+    }
+}
+
+impl CxxOstream {
+    /// Calls `f` with a `std::ostream` that writes to `writer`.
+    ///
+    /// Output is collected in `buf` and handed to `writer.write_all` whenever
+    /// it is full, when C++ flushes the stream, and once more after `f`
+    /// returns. A C++ write that does not fit in `buf` goes to the writer
+    /// directly. Nothing is allocated. An error from the writer sets `badbit`
+    /// on the stream, and once `f` returns, the error is returned in place of
+    /// its result. A panic in the writer is resumed after `f` returns.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `buf` is empty.
+    pub fn with_writer<W, F, T>(mut writer: W, buf: &mut [u8], f: F) -> io::Result<T>
+    where
+        W: Write,
+        F: FnOnce(&mut CxxOstream) -> T,
+    {
+        assert!(!buf.is_empty(), "stream buffer must not be empty");
+        let mut sink = Sink {
+            writer: &mut writer,
+            failure: Failure::default(),
+        };
+        let mut scope = Scope::new(f);
+        unsafe {
+            ostream_scope(
+                &mut sink as *mut Sink as *mut c_void,
+                buf.as_mut_ptr(),
+                buf.len(),
+                Scope::<F, T>::call::<CxxOstream>,
+                scope.as_ctx(),
+            );
+        }
+        sink.failure.finish(scope.finish())
+    }
+}
+
+// Reads of a std::istream block until the buffer is full or the stream ends,
+// so only the last read before the end returns less than asked for.
+impl Read for CxxIstream {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let mut n = 0;
+        let ok = unsafe { istream_read(self, buf.as_mut_ptr(), buf.len(), &mut n) };
+        if ok || n > 0 {
+            Ok(n)
+        } else {
+            Err(io::Error::new(
+                io::ErrorKind::Other,
+                "std::istream read failed",
+            ))
+        }
+    }
+}
+
+impl Write for CxxOstream {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        if unsafe { ostream_write(self, buf.as_ptr(), buf.len()) } {
+            Ok(buf.len())
+        } else {
+            Err(io::Error::new(
+                io::ErrorKind::Other,
+                "std::ostream write failed",
+            ))
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        if unsafe { ostream_flush(self) } {
+            Ok(())
+        } else {
+            Err(io::Error::new(
+                io::ErrorKind::Other,
+                "std::ostream flush failed",
+            ))
+        }
+    }
+}
+
+impl Debug for CxxIstream {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.write_str("CxxIstream")
+    }
+}
+
+impl Debug for CxxOstream {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.write_str("CxxOstream")
+    }
+}
+
+struct Source<'a> {
+    reader: &'a mut dyn Read,
+    failure: Failure,
+}
+
+struct Sink<'a> {
+    writer: &'a mut dyn Write,
+    failure: Failure,
+}
+
+// Neither an io::Error nor a panic can cross into C++, so the first one from
+// the reader or writer is kept here and surfaces once the C++ code is done.
+#[derive(Default)]
+struct Failure {
+    error: Option<io::Error>,
+    panic: Option<Box<dyn Any + Send>>,
+}
+
+impl Failure {
+    fn run<T>(&mut self, op: impl FnOnce() -> io::Result<T>) -> Option<T> {
+        if self.error.is_some() || self.panic.is_some() {
+            return None;
+        }
+        match panic::catch_unwind(AssertUnwindSafe(op)) {
+            Ok(Ok(ret)) => Some(ret),
+            Ok(Err(error)) => {
+                self.error = Some(error);
+                None
+            }
+            Err(panic) => {
+                self.panic = Some(panic);
+                None
+            }
+        }
+    }
+
+    fn finish<T>(self, ret: T) -> io::Result<T> {
+        if let Some(panic) = self.panic {
+            panic::resume_unwind(panic);
+        }
+        match self.error {
+            Some(error) => Err(error),
+            None => Ok(ret),
+        }
+    }
+}
+
+// The closure given to with_reader or with_writer, called back from C++ with
+// the stream it constructed on its stack.
+struct Scope<F, T> {
+    f: Option<F>,
+    ret: Option<T>,
+    panic: Option<Box<dyn Any + Send>>,
+}
+
+impl<F, T> Scope<F, T> {
+    fn new(f: F) -> Self {
+        Scope {
+            f: Some(f),
+            ret: None,
+            panic: None,
+        }
+    }
+
+    fn as_ctx(&mut self) -> *mut c_void {
+        self as *mut Self as *mut c_void
+    }
+
+    unsafe extern "C" fn call<S>(ctx: *mut c_void, stream: &mut S)
+    where
+        F: FnOnce(&mut S) -> T,
+    {
+        let scope = &mut *(ctx as *mut Self);
+        let f = scope.f.take().unwrap();
+        match panic::catch_unwind(AssertUnwindSafe(|| f(stream))) {
+            Ok(ret) => scope.ret = Some(ret),
+            Err(panic) => scope.panic = Some(panic),
+        }
+    }
+
+    fn finish(self) -> T {
+        if let Some(panic) = self.panic {
+            panic::resume_unwind(panic);
+        }
+        self.ret.unwrap()
+    }
+}
+
+#[export_name = "cxxbridge02$rust_read$read"]
+unsafe extern "C" fn source_read(
+    source: *mut c_void,
+    buf: *mut u8,
+    len: usize,
+    n: &mut usize,
+) -> bool {
+    let source = &mut *(source as *mut Source);
+    let buf = slice::from_raw_parts_mut(buf, len);
+    let reader = &mut source.reader;
+    let read = source.failure.run(|| loop {
+        match reader.read(buf) {
+            Err(err) if err.kind() == io::ErrorKind::Interrupted => {}
+            result => return result,
+        }
+    });
+    match read {
+        Some(read) => {
+            *n = read;
+            true
+        }
+        None => false,
+    }
+}
+
+#[export_name = "cxxbridge02$rust_write$write"]
+unsafe extern "C" fn sink_write(sink: *mut c_void, buf: *const u8, len: usize) -> bool {
+    let sink = &mut *(sink as *mut Sink);
+    let buf = slice::from_raw_parts(buf, len);
+    let writer = &mut sink.writer;
+    sink.failure.run(|| writer.write_all(buf)).is_some()
+}
+
+#[export_name = "cxxbridge02$rust_write$flush"]
+unsafe extern "C" fn sink_flush(sink: *mut c_void) -> bool {
+    let sink = &mut *(sink as *mut Sink);
+    let writer = &mut sink.writer;
+    sink.failure.run(|| writer.flush()).is_some()
+}
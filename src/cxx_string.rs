@@ -1,13 +1,20 @@
+use crate::unique_ptr::UniquePtr;
 use std::borrow::Cow;
 use std::fmt::{self, Debug, Display};
+use std::ops::Deref;
 use std::slice;
 use std::str::{self, Utf8Error};
+use std::string::FromUtf8Error;
 
 extern "C" {
     #[link_name = "cxxbridge02$cxx_string$data"]
     fn string_data(_: &CxxString) -> *const u8;
     #[link_name = "cxxbridge02$cxx_string$length"]
     fn string_length(_: &CxxString) -> usize;
+    #[link_name = "cxxbridge02$cxx_string$view"]
+    fn string_view(_: &CxxString, len: &mut usize) -> *const u8;
+    #[link_name = "cxxbridge02$utf8$valid"]
+    fn utf8_valid(ptr: *const u8, len: usize) -> bool;
 }
 
 /// Binding to C++ `std::string`.
@@ -32,7 +39,11 @@ impl CxxString {
     ///
     /// [size]: https://en.cppreference.com/w/cpp/string/basic_string/size
     pub fn len(&self) -> usize {
-        unsafe { string_length(self) }
+        if cfg!(cxx_string_layout) {
+            self.as_cxx_str().len()
+        } else {
+            unsafe { string_length(self) }
+        }
     }
 
     /// Returns true if `self` has a length of zero bytes.
@@ -42,9 +53,20 @@ impl CxxString {
 
     /// Returns a byte slice of this string's contents.
     pub fn as_bytes(&self) -> &[u8] {
-        let data = self.as_ptr();
-        let len = self.len();
-        unsafe { slice::from_raw_parts(data, len) }
+        self.as_cxx_str().as_bytes()
+    }
+
+    /// Borrows the contents of the string as a [`CxxStr`], looking up the
+    /// pointer and length only once for as long as the view is held.
+    ///
+    /// Prefer this over repeated calls to `as_bytes()`, `len()` or `==` on
+    /// the same `&CxxString`, each of which calls into C++ again.
+    ///
+    /// [`CxxStr`]: struct.CxxStr.html
+    pub fn as_cxx_str(&self) -> CxxStr {
+        let (data, len) = unsafe { raw_parts(self) };
+        let bytes = unsafe { slice::from_raw_parts(data, len) };
+        CxxStr { bytes }
     }
 
     /// Produces a pointer to the first character of the string.
@@ -58,7 +80,11 @@ impl CxxString {
     ///
     /// [data]: https://en.cppreference.com/w/cpp/string/basic_string/data
     pub fn as_ptr(&self) -> *const u8 {
-        unsafe { string_data(self) }
+        if cfg!(cxx_string_layout) {
+            self.as_cxx_str().as_ptr()
+        } else {
+            unsafe { string_data(self) }
+        }
     }
 
     /// Validates that the C++ string contains UTF-8 data and produces a view of
@@ -78,6 +104,48 @@ impl CxxString {
     }
 }
 
+/// Taking the contents out of an owned C++ string.
+///
+/// The bytes are copied once into a Rust allocation of exactly the right size
+/// and the C++ string is destroyed right away. Its buffer cannot be adopted
+/// instead, because it comes from the C++ allocator and may even be inline in
+/// the std::string for a short string, while a Rust `Vec` must be freed by
+/// Rust's global allocator. A null `UniquePtr` produces an empty result.
+impl UniquePtr<CxxString> {
+    /// Moves the contents of the string into a `Vec<u8>`.
+    pub fn into_bytes(self) -> Vec<u8> {
+        match self.as_ref() {
+            Some(s) => s.as_bytes().to_vec(),
+            None => Vec::new(),
+        }
+    }
+
+    /// Moves the contents of the string into a `String` if they are valid
+    /// UTF-8, otherwise returns the bytes inside of the error.
+    ///
+    /// Validation uses the same vectorized check as the C++ `rust::Str` and
+    /// `rust::String` constructors.
+    pub fn into_string(self) -> Result<String, FromUtf8Error> {
+        let bytes = self.into_bytes();
+        if unsafe { utf8_valid(bytes.as_ptr(), bytes.len()) } {
+            Ok(unsafe { String::from_utf8_unchecked(bytes) })
+        } else {
+            String::from_utf8(bytes)
+        }
+    }
+
+    /// Moves the contents of the string into a `String` without checking
+    /// that they are UTF-8.
+    ///
+    /// # Safety
+    ///
+    /// The string must contain valid UTF-8, for example because the C++ side
+    /// built it from a `rust::String` or `rust::Str`, or already validated it.
+    pub unsafe fn into_string_unchecked(self) -> String {
+        String::from_utf8_unchecked(self.into_bytes())
+    }
+}
+
 impl Display for CxxString {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         Display::fmt(self.to_string_lossy().as_ref(), f)
@@ -107,3 +175,127 @@ impl PartialEq<str> for CxxString {
         self.as_bytes() == other.as_bytes()
     }
 }
+
+/// Borrowed view of the contents of a [`CxxString`], obtained by
+/// [`CxxString::as_cxx_str`].
+///
+/// The pointer and length of the C++ string are read once when the view is
+/// created, after which it behaves like a `&[u8]` without calling into C++.
+///
+/// [`CxxString`]: struct.CxxString.html
+/// [`CxxString::as_cxx_str`]: struct.CxxString.html#method.as_cxx_str
+#[derive(Copy, Clone, Eq, Hash, PartialOrd, Ord)]
+pub struct CxxStr<'a> {
+    bytes: &'a [u8],
+}
+
+impl<'a> CxxStr<'a> {
+    /// Returns the contents of the view as a byte slice.
+    pub fn as_bytes(&self) -> &'a [u8] {
+        self.bytes
+    }
+
+    /// Validates that the string contains UTF-8 data and produces a view of
+    /// it as a Rust &amp;str, otherwise an error.
+    pub fn to_str(&self) -> Result<&'a str, Utf8Error> {
+        str::from_utf8(self.bytes)
+    }
+
+    /// Like [`CxxString::to_string_lossy`].
+    ///
+    /// [`CxxString::to_string_lossy`]: struct.CxxString.html#method.to_string_lossy
+    pub fn to_string_lossy(&self) -> Cow<'a, str> {
+        String::from_utf8_lossy(self.bytes)
+    }
+}
+
+impl Deref for CxxStr<'_> {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        self.bytes
+    }
+}
+
+impl Display for CxxStr<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        Display::fmt(self.to_string_lossy().as_ref(), f)
+    }
+}
+
+impl Debug for CxxStr<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        Debug::fmt(self.to_string_lossy().as_ref(), f)
+    }
+}
+
+impl<'a, 'b> PartialEq<CxxStr<'b>> for CxxStr<'a> {
+    fn eq(&self, other: &CxxStr<'b>) -> bool {
+        self.bytes == other.bytes
+    }
+}
+
+impl PartialEq<str> for CxxStr<'_> {
+    fn eq(&self, other: &str) -> bool {
+        self.bytes == other.as_bytes()
+    }
+}
+
+impl PartialEq<&str> for CxxStr<'_> {
+    fn eq(&self, other: &&str) -> bool {
+        self.bytes == other.as_bytes()
+    }
+}
+
+impl PartialEq<[u8]> for CxxStr<'_> {
+    fn eq(&self, other: &[u8]) -> bool {
+        self.bytes == other
+    }
+}
+
+impl PartialEq<CxxStr<'_>> for str {
+    fn eq(&self, other: &CxxStr) -> bool {
+        self.as_bytes() == other.bytes
+    }
+}
+
+// With the inline-cxx-string feature, build.rs recognizes the standard
+// library being compiled against and cxx.cc checks that guess, so the string
+// can be read in place. Every C++ translation unit in the program must use the
+// same standard library ABI for this to hold. Otherwise one FFI call returns
+// both the pointer and the length.
+#[cfg(cxx_string_layout = "libstdcxx")]
+unsafe fn raw_parts(s: &CxxString) -> (*const u8, usize) {
+    // struct { char *ptr; size_t len; union { char buf[16]; size_t cap; } }
+    // The pointer refers to buf when the string is short.
+    let words = s as *const CxxString as *const usize;
+    let parts = (*words as *const u8, *words.add(1));
+    debug_assert_eq!(parts, ffi_raw_parts(s));
+    parts
+}
+
+#[cfg(cxx_string_layout = "libcxx")]
+unsafe fn raw_parts(s: &CxxString) -> (*const u8, usize) {
+    // Long: struct { size_t cap | 1; size_t len; char *ptr; }
+    // Short: struct { uint8_t len << 1; char buf[23]; }
+    let bytes = s as *const CxxString as *const u8;
+    let parts = if *bytes & 1 == 0 {
+        (bytes.add(1), (*bytes >> 1) as usize)
+    } else {
+        let words = bytes as *const usize;
+        (*words.add(2) as *const u8, *words.add(1))
+    };
+    debug_assert_eq!(parts, ffi_raw_parts(s));
+    parts
+}
+
+#[cfg(not(cxx_string_layout))]
+unsafe fn raw_parts(s: &CxxString) -> (*const u8, usize) {
+    ffi_raw_parts(s)
+}
+
+unsafe fn ffi_raw_parts(s: &CxxString) -> (*const u8, usize) {
+    let mut len = 0;
+    let data = string_view(s, &mut len);
+    (data, len)
+}
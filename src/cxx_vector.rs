@@ -0,0 +1,318 @@
+use crate::unique_ptr::UniquePtrTarget;
+use std::ffi::c_void;
+use std::fmt::{self, Debug};
+use std::marker::PhantomData;
+use std::slice;
+
+/// Binding to C++ `std::vector<T, std::allocator<T>>`.
+///
+/// # Invariants
+///
+/// As an invariant of this API and the static analysis of the cxx::bridge
+/// macro, in Rust code we can never obtain a `CxxVector` by value. Instead in
+/// Rust code we will only ever look at a vector behind a reference or smart
+/// pointer, as in `&CxxVector<T>` or `UniquePtr<CxxVector<T>>`.
+#[repr(C)]
+pub struct CxxVector<T> {
+    _private: [u8; 0],
+    ty: PhantomData<T>,
+}
+
+impl<T> CxxVector<T>
+where
+    T: VectorElement,
+{
+    /// Returns the number of elements in the vector.
+    ///
+    /// Matches the behavior of C++ [std::vector\<T\>::size][size].
+    ///
+    /// [size]: https://en.cppreference.com/w/cpp/container/vector/size
+    pub fn len(&self) -> usize {
+        T::__vector_size(self)
+    }
+
+    /// Returns true if the vector contains no elements.
+    ///
+    /// Matches the behavior of C++ [std::vector\<T\>::empty][empty].
+    ///
+    /// [empty]: https://en.cppreference.com/w/cpp/container/vector/empty
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns a reference to an element at the given position, or `None` if
+    /// out of bounds.
+    pub fn get(&self, pos: usize) -> Option<&T> {
+        self.as_slice().get(pos)
+    }
+
+    /// Returns a slice over the contiguous storage of the vector, without
+    /// copying. The data pointer and length are each read from C++ once, so
+    /// iterating or indexing the slice makes no further calls.
+    pub fn as_slice(&self) -> &[T] {
+        let len = self.len();
+        if len == 0 {
+            // An empty std::vector may report a null data pointer, which is
+            // not allowed in a Rust slice.
+            &[]
+        } else {
+            unsafe { slice::from_raw_parts(T::__vector_data(self), len) }
+        }
+    }
+}
+
+impl<T> Debug for CxxVector<T>
+where
+    T: Debug + VectorElement,
+{
+    fn fmt(&self, formatter: &mut fmt::Formatter) -> fmt::Result {
+        Debug::fmt(self.as_slice(), formatter)
+    }
+}
+
+impl<T> PartialEq for CxxVector<T>
+where
+    T: PartialEq + VectorElement,
+{
+    fn eq(&self, other: &CxxVector<T>) -> bool {
+        self.as_slice() == other.as_slice()
+    }
+}
+
+// Methods are private; not intended to be implemented outside of cxxbridge
+// codebase.
+pub unsafe trait VectorElement: Sized {
+    #[doc(hidden)]
+    fn __vector_size(v: &CxxVector<Self>) -> usize;
+    #[doc(hidden)]
+    unsafe fn __vector_data(v: &CxxVector<Self>) -> *const Self;
+    #[doc(hidden)]
+    fn __unique_ptr_null() -> *mut c_void;
+    #[doc(hidden)]
+    unsafe fn __unique_ptr_raw(raw: *mut CxxVector<Self>) -> *mut c_void;
+    #[doc(hidden)]
+    unsafe fn __unique_ptr_get(repr: *mut c_void) -> *const CxxVector<Self>;
+    #[doc(hidden)]
+    unsafe fn __unique_ptr_release(repr: *mut c_void) -> *mut CxxVector<Self>;
+    #[doc(hidden)]
+    unsafe fn __unique_ptr_drop(repr: *mut c_void);
+}
+
+unsafe impl<T> UniquePtrTarget for CxxVector<T>
+where
+    T: VectorElement,
+{
+    fn __null() -> *mut c_void {
+        T::__unique_ptr_null()
+    }
+    fn __new(value: Self) -> *mut c_void {
+        // Unreachable because a CxxVector is never held by value in Rust.
+        let _ = value;
+        unreachable!()
+    }
+    unsafe fn __raw(raw: *mut Self) -> *mut c_void {
+        T::__unique_ptr_raw(raw)
+    }
+    unsafe fn __get(repr: *mut c_void) -> *const Self {
+        T::__unique_ptr_get(repr)
+    }
+    unsafe fn __release(repr: *mut c_void) -> *mut Self {
+        T::__unique_ptr_release(repr)
+    }
+    unsafe fn __drop(repr: *mut c_void) {
+        T::__unique_ptr_drop(repr)
+    }
+}
+
+// Shared structs get the same impl from the cxxbridge macro, in
+// expand_cxx_vector. Primitives are instantiated once here, against the
+// shims in cxx.cc.
+macro_rules! vector_element_for_primitive {
+    (
+        $ty:ty,
+        $size:literal,
+        $data:literal,
+        $null:literal,
+        $raw:literal,
+        $get:literal,
+        $release:literal,
+        $drop:literal $(,)?
+    ) => {
+        unsafe impl VectorElement for $ty {
+            fn __vector_size(v: &CxxVector<$ty>) -> usize {
+                extern "C" {
+                    #[link_name = $size]
+                    fn __vector_size(_: &CxxVector<$ty>) -> usize;
+                }
+                unsafe { __vector_size(v) }
+            }
+            unsafe fn __vector_data(v: &CxxVector<$ty>) -> *const $ty {
+                extern "C" {
+                    #[link_name = $data]
+                    fn __vector_data(_: &CxxVector<$ty>) -> *const $ty;
+                }
+                __vector_data(v)
+            }
+            fn __unique_ptr_null() -> *mut c_void {
+                extern "C" {
+                    #[link_name = $null]
+                    fn __unique_ptr_null(this: *mut *mut c_void);
+                }
+                let mut repr = std::ptr::null_mut::<c_void>();
+                unsafe { __unique_ptr_null(&mut repr) }
+                repr
+            }
+            unsafe fn __unique_ptr_raw(raw: *mut CxxVector<$ty>) -> *mut c_void {
+                extern "C" {
+                    #[link_name = $raw]
+                    fn __unique_ptr_raw(this: *mut *mut c_void, raw: *mut CxxVector<$ty>);
+                }
+                let mut repr = std::ptr::null_mut::<c_void>();
+                __unique_ptr_raw(&mut repr, raw);
+                repr
+            }
+            unsafe fn __unique_ptr_get(repr: *mut c_void) -> *const CxxVector<$ty> {
+                extern "C" {
+                    #[link_name = $get]
+                    fn __unique_ptr_get(this: *const *mut c_void) -> *const CxxVector<$ty>;
+                }
+                __unique_ptr_get(&repr)
+            }
+            unsafe fn __unique_ptr_release(mut repr: *mut c_void) -> *mut CxxVector<$ty> {
+                extern "C" {
+                    #[link_name = $release]
+                    fn __unique_ptr_release(this: *mut *mut c_void) -> *mut CxxVector<$ty>;
+                }
+                __unique_ptr_release(&mut repr)
+            }
+            unsafe fn __unique_ptr_drop(mut repr: *mut c_void) {
+                extern "C" {
+                    #[link_name = $drop]
+                    fn __unique_ptr_drop(this: *mut *mut c_void);
+                }
+                __unique_ptr_drop(&mut repr);
+            }
+        }
+    };
+}
+
+vector_element_for_primitive!(
+    u8,
+    "cxxbridge02$std$vector$u8$size",
+    "cxxbridge02$std$vector$u8$data",
+    "cxxbridge02$unique_ptr$std$vector$u8$null",
+    "cxxbridge02$unique_ptr$std$vector$u8$raw",
+    "cxxbridge02$unique_ptr$std$vector$u8$get",
+    "cxxbridge02$unique_ptr$std$vector$u8$release",
+    "cxxbridge02$unique_ptr$std$vector$u8$drop",
+);
+vector_element_for_primitive!(
+    u16,
+    "cxxbridge02$std$vector$u16$size",
+    "cxxbridge02$std$vector$u16$data",
+    "cxxbridge02$unique_ptr$std$vector$u16$null",
+    "cxxbridge02$unique_ptr$std$vector$u16$raw",
+    "cxxbridge02$unique_ptr$std$vector$u16$get",
+    "cxxbridge02$unique_ptr$std$vector$u16$release",
+    "cxxbridge02$unique_ptr$std$vector$u16$drop",
+);
+vector_element_for_primitive!(
+    u32,
+    "cxxbridge02$std$vector$u32$size",
+    "cxxbridge02$std$vector$u32$data",
+    "cxxbridge02$unique_ptr$std$vector$u32$null",
+    "cxxbridge02$unique_ptr$std$vector$u32$raw",
+    "cxxbridge02$unique_ptr$std$vector$u32$get",
+    "cxxbridge02$unique_ptr$std$vector$u32$release",
+    "cxxbridge02$unique_ptr$std$vector$u32$drop",
+);
+vector_element_for_primitive!(
+    u64,
+    "cxxbridge02$std$vector$u64$size",
+    "cxxbridge02$std$vector$u64$data",
+    "cxxbridge02$unique_ptr$std$vector$u64$null",
+    "cxxbridge02$unique_ptr$std$vector$u64$raw",
+    "cxxbridge02$unique_ptr$std$vector$u64$get",
+    "cxxbridge02$unique_ptr$std$vector$u64$release",
+    "cxxbridge02$unique_ptr$std$vector$u64$drop",
+);
+vector_element_for_primitive!(
+    usize,
+    "cxxbridge02$std$vector$usize$size",
+    "cxxbridge02$std$vector$usize$data",
+    "cxxbridge02$unique_ptr$std$vector$usize$null",
+    "cxxbridge02$unique_ptr$std$vector$usize$raw",
+    "cxxbridge02$unique_ptr$std$vector$usize$get",
+    "cxxbridge02$unique_ptr$std$vector$usize$release",
+    "cxxbridge02$unique_ptr$std$vector$usize$drop",
+);
+vector_element_for_primitive!(
+    i8,
+    "cxxbridge02$std$vector$i8$size",
+    "cxxbridge02$std$vector$i8$data",
+    "cxxbridge02$unique_ptr$std$vector$i8$null",
+    "cxxbridge02$unique_ptr$std$vector$i8$raw",
+    "cxxbridge02$unique_ptr$std$vector$i8$get",
+    "cxxbridge02$unique_ptr$std$vector$i8$release",
+    "cxxbridge02$unique_ptr$std$vector$i8$drop",
+);
+vector_element_for_primitive!(
+    i16,
+    "cxxbridge02$std$vector$i16$size",
+    "cxxbridge02$std$vector$i16$data",
+    "cxxbridge02$unique_ptr$std$vector$i16$null",
+    "cxxbridge02$unique_ptr$std$vector$i16$raw",
+    "cxxbridge02$unique_ptr$std$vector$i16$get",
+    "cxxbridge02$unique_ptr$std$vector$i16$release",
+    "cxxbridge02$unique_ptr$std$vector$i16$drop",
+);
+vector_element_for_primitive!(
+    i32,
+    "cxxbridge02$std$vector$i32$size",
+    "cxxbridge02$std$vector$i32$data",
+    "cxxbridge02$unique_ptr$std$vector$i32$null",
+    "cxxbridge02$unique_ptr$std$vector$i32$raw",
+    "cxxbridge02$unique_ptr$std$vector$i32$get",
+    "cxxbridge02$unique_ptr$std$vector$i32$release",
+    "cxxbridge02$unique_ptr$std$vector$i32$drop",
+);
+vector_element_for_primitive!(
+    i64,
+    "cxxbridge02$std$vector$i64$size",
+    "cxxbridge02$std$vector$i64$data",
+    "cxxbridge02$unique_ptr$std$vector$i64$null",
+    "cxxbridge02$unique_ptr$std$vector$i64$raw",
+    "cxxbridge02$unique_ptr$std$vector$i64$get",
+    "cxxbridge02$unique_ptr$std$vector$i64$release",
+    "cxxbridge02$unique_ptr$std$vector$i64$drop",
+);
+vector_element_for_primitive!(
+    isize,
+    "cxxbridge02$std$vector$isize$size",
+    "cxxbridge02$std$vector$isize$data",
+    "cxxbridge02$unique_ptr$std$vector$isize$null",
+    "cxxbridge02$unique_ptr$std$vector$isize$raw",
+    "cxxbridge02$unique_ptr$std$vector$isize$get",
+    "cxxbridge02$unique_ptr$std$vector$isize$release",
+    "cxxbridge02$unique_ptr$std$vector$isize$drop",
+);
+vector_element_for_primitive!(
+    f32,
+    "cxxbridge02$std$vector$f32$size",
+    "cxxbridge02$std$vector$f32$data",
+    "cxxbridge02$unique_ptr$std$vector$f32$null",
+    "cxxbridge02$unique_ptr$std$vector$f32$raw",
+    "cxxbridge02$unique_ptr$std$vector$f32$get",
+    "cxxbridge02$unique_ptr$std$vector$f32$release",
+    "cxxbridge02$unique_ptr$std$vector$f32$drop",
+);
+vector_element_for_primitive!(
+    f64,
+    "cxxbridge02$std$vector$f64$size",
+    "cxxbridge02$std$vector$f64$data",
+    "cxxbridge02$unique_ptr$std$vector$f64$null",
+    "cxxbridge02$unique_ptr$std$vector$f64$raw",
+    "cxxbridge02$unique_ptr$std$vector$f64$get",
+    "cxxbridge02$unique_ptr$std$vector$f64$release",
+    "cxxbridge02$unique_ptr$std$vector$f64$drop",
+);
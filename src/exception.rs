@@ -1,15 +1,34 @@
+use crate::rust_str::RustStr;
+use std::cell::UnsafeCell;
 use std::fmt::{self, Debug, Display};
 use std::slice;
+use std::str;
 
 /// Exception thrown from an `extern "C"` function.
-#[derive(Debug)]
 pub struct Exception {
-    pub(crate) what: Box<str>,
+    what: What,
 }
 
+// Short messages are stored inline so that catching a C++ exception does not
+// allocate.
+enum What {
+    Inline { buf: [u8; INLINE_CAPACITY], len: u8 },
+    Heap(Box<str>),
+}
+
+const INLINE_CAPACITY: usize = 46;
+
 impl Display for Exception {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
-        f.write_str(&self.what)
+        f.write_str(self.what())
+    }
+}
+
+impl Debug for Exception {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Exception")
+            .field("what", &self.what())
+            .finish()
     }
 }
 
@@ -17,13 +36,48 @@ impl std::error::Error for Exception {}
 
 impl Exception {
     pub fn what(&self) -> &str {
-        &self.what
+        match &self.what {
+            What::Inline { buf, len } => unsafe { str::from_utf8_unchecked(&buf[..*len as usize]) },
+            What::Heap(what) => what,
+        }
+    }
+
+    #[cold]
+    pub(crate) unsafe fn from_repr(repr: RustStr) -> Self {
+        let ptr = repr.ptr.as_ptr();
+        let what = if ptr == STAGING.with(|staging| staging.get() as *mut u8) {
+            let mut buf = [0; INLINE_CAPACITY];
+            buf[..repr.len].copy_from_slice(slice::from_raw_parts(ptr, repr.len));
+            What::Inline {
+                buf,
+                len: repr.len as u8,
+            }
+        } else {
+            let slice = slice::from_raw_parts_mut(ptr, repr.len);
+            let s = str::from_utf8_unchecked_mut(slice);
+            What::Heap(Box::from_raw(s))
+        };
+        Exception { what }
     }
 }
 
+thread_local! {
+    // Holds a short exception message between the C++ catch block and the
+    // Exception constructed from it, which happens on the same thread before
+    // the generated shim returns.
+    static STAGING: UnsafeCell<[u8; INLINE_CAPACITY]> = UnsafeCell::new([0; INLINE_CAPACITY]);
+}
+
 #[export_name = "cxxbridge02$exception"]
 unsafe extern "C" fn exception(ptr: *const u8, len: usize) -> *const u8 {
     let slice = slice::from_raw_parts(ptr, len);
+    if len <= INLINE_CAPACITY && str::from_utf8(slice).is_ok() {
+        return STAGING.with(|staging| {
+            let staging = staging.get() as *mut u8;
+            staging.copy_from_nonoverlapping(ptr, len);
+            staging as *const u8
+        });
+    }
     let boxed = String::from_utf8_lossy(slice).into_owned().into_boxed_str();
     Box::leak(boxed).as_ptr()
 }
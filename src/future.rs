@@ -0,0 +1,239 @@
+use crate::unwind::catch_unwind;
+use std::ffi::c_void;
+use std::future::Future;
+use std::mem::{self, ManuallyDrop};
+use std::pin::Pin;
+use std::ptr;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+use std::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+
+/// Future returned by an `async fn` declared in an `extern "C"` block.
+///
+/// The C++ implementation receives a `rust::Promise<T>` and may complete it
+/// from any thread, at which point the task awaiting this future is woken. No
+/// thread is blocked in the meantime.
+///
+/// # Panics
+///
+/// Awaiting the future panics if C++ destroys the promise without setting a
+/// value.
+pub struct CxxFuture<T> {
+    shared: Arc<Mutex<State<T>>>,
+}
+
+enum State<T> {
+    Pending(Option<Waker>),
+    Ready(T),
+    Broken,
+    Done,
+}
+
+impl<T> Future for CxxFuture<T> {
+    type Output = T;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context) -> Poll<T> {
+        let mut state = self.shared.lock().unwrap();
+        match mem::replace(&mut *state, State::Done) {
+            State::Pending(Some(waker)) if waker.will_wake(cx.waker()) => {
+                *state = State::Pending(Some(waker));
+                Poll::Pending
+            }
+            State::Pending(_) => {
+                *state = State::Pending(Some(cx.waker().clone()));
+                Poll::Pending
+            }
+            State::Ready(value) => Poll::Ready(value),
+            // Panic only after unlocking, so that the C++ side never sees a
+            // poisoned mutex.
+            State::Broken => {
+                drop(state);
+                panic!("C++ destroyed the rust::Promise without setting a value");
+            }
+            State::Done => {
+                drop(state);
+                panic!("CxxFuture polled after completion");
+            }
+        }
+    }
+}
+
+// Layout of rust::Promise<T>::Repr. The state pointer is an owned reference
+// count of the future's shared state, released by exactly one of the two
+// callbacks. In the other direction, for an async function in extern "Rust",
+// it is the C++ callable that receives the result; see spawn below.
+#[repr(C)]
+pub struct PromiseRepr {
+    state: *const c_void,
+    complete: unsafe extern "C" fn(state: *const c_void, value: *mut c_void),
+    drop: unsafe extern "C" fn(state: *const c_void),
+}
+
+pub fn future_promise<T>() -> (CxxFuture<T>, PromiseRepr) {
+    let shared = Arc::new(Mutex::new(State::Pending(None)));
+    let promise = PromiseRepr {
+        state: Arc::into_raw(shared.clone()) as *const c_void,
+        complete: complete::<T>,
+        drop: abandon::<T>,
+    };
+    (CxxFuture { shared }, promise)
+}
+
+// The value is moved out of C++ storage that is never destroyed on the C++
+// side; for Promise<void> it points at the promise itself and T is ().
+unsafe extern "C" fn complete<T>(state: *const c_void, value: *mut c_void) {
+    let value = ptr::read(value as *mut T);
+    resolve(state, State::Ready(value));
+}
+
+unsafe extern "C" fn abandon<T>(state: *const c_void) {
+    resolve::<T>(state, State::Broken);
+}
+
+unsafe fn resolve<T>(state: *const c_void, new: State<T>) {
+    let shared = Arc::from_raw(state as *const Mutex<State<T>>);
+    let old = mem::replace(&mut *shared.lock().unwrap(), new);
+    if let State::Pending(Some(waker)) = old {
+        waker.wake();
+    }
+}
+
+// An async function in extern "Rust" hands its future to C++ as a callback
+// completion rather than an awaitable, so the generated code works without
+// C++20 coroutines. There is no executor either: the future is polled once on
+// the calling thread, and after that on whichever thread wakes it, until it is
+// ready and its output goes to the C++ callable. A future that needs to run on
+// a particular runtime should spawn itself there and await the result.
+//
+// T is spelled out by the generated code, so that a future whose output is not
+// the declared return type fails to compile rather than reaching C++.
+pub fn spawn<T, F>(label: &'static str, future: F, promise: PromiseRepr)
+where
+    F: Future<Output = T> + Send + 'static,
+{
+    let task = Arc::new(Task {
+        label,
+        state: AtomicUsize::new(POLLING),
+        slot: Mutex::new(Some((Box::pin(future), Completion(promise)))),
+    });
+    task.run();
+}
+
+// States of a Task. Only the thread that moves the task to POLLING polls it;
+// a wake during that poll turns POLLING into NOTIFIED, and the poller polls
+// once more rather than two threads polling at the same time.
+const IDLE: usize = 0;
+const POLLING: usize = 1;
+const NOTIFIED: usize = 2;
+const DONE: usize = 3;
+
+struct Task<F: Future> {
+    label: &'static str,
+    state: AtomicUsize,
+    slot: Mutex<Option<(Pin<Box<F>>, Completion)>>,
+}
+
+// Owns the C++ callable until it is called. If the future is dropped before it
+// is ready, which only happens once every waker for it is gone, the callable
+// is destroyed without being called.
+struct Completion(PromiseRepr);
+
+// The C++ callable was moved into the completion by the generated code, which
+// documents that it may be called and destroyed on any thread.
+unsafe impl Send for Completion {}
+
+impl Completion {
+    fn complete<T>(self, value: T) {
+        let this = ManuallyDrop::new(self);
+        let mut value = ManuallyDrop::new(value);
+        // C++ moves the value out and destroys what is left.
+        let value = &mut *value as *mut T as *mut c_void;
+        unsafe { (this.0.complete)(this.0.state, value) }
+    }
+}
+
+impl Drop for Completion {
+    fn drop(&mut self) {
+        unsafe { (self.0.drop)(self.0.state) }
+    }
+}
+
+impl<F> Task<F>
+where
+    F: Future + Send + 'static,
+{
+    fn wake(self: Arc<Self>) {
+        let mut state = self.state.load(Ordering::Acquire);
+        loop {
+            let next = match state {
+                IDLE => POLLING,
+                POLLING => NOTIFIED,
+                _ => return,
+            };
+            match self.state.compare_exchange(state, next, Ordering::AcqRel, Ordering::Acquire) {
+                Ok(_) if next == POLLING => return self.run(),
+                Ok(_) => return,
+                Err(actual) => state = actual,
+            }
+        }
+    }
+
+    // Called in the POLLING state.
+    fn run(self: Arc<Self>) {
+        let waker = unsafe { Waker::from_raw(Self::raw_waker(&self)) };
+        let mut cx = Context::from_waker(&waker);
+        let mut slot = self.slot.lock().unwrap();
+        loop {
+            let (future, _) = slot.as_mut().unwrap();
+            let poll = catch_unwind(self.label, || future.as_mut().poll(&mut cx));
+            if let Poll::Ready(value) = poll {
+                self.state.store(DONE, Ordering::Release);
+                let (future, completion) = slot.take().unwrap();
+                drop(slot);
+                return catch_unwind(self.label, move || {
+                    drop(future);
+                    completion.complete(value);
+                });
+            }
+            match self.state.compare_exchange(
+                POLLING,
+                IDLE,
+                Ordering::AcqRel,
+                Ordering::Acquire,
+            ) {
+                Ok(_) => return,
+                Err(_) => self.state.store(POLLING, Ordering::Release),
+            }
+        }
+    }
+
+    const VTABLE: RawWakerVTable = RawWakerVTable::new(
+        Self::waker_clone,
+        Self::waker_wake,
+        Self::waker_wake_by_ref,
+        Self::waker_drop,
+    );
+
+    fn raw_waker(this: &Arc<Self>) -> RawWaker {
+        let ptr = Arc::into_raw(this.clone()) as *const ();
+        RawWaker::new(ptr, &Self::VTABLE)
+    }
+
+    unsafe fn waker_clone(ptr: *const ()) -> RawWaker {
+        let this = ManuallyDrop::new(Arc::from_raw(ptr as *const Self));
+        Self::raw_waker(&this)
+    }
+
+    unsafe fn waker_wake(ptr: *const ()) {
+        Arc::from_raw(ptr as *const Self).wake();
+    }
+
+    unsafe fn waker_wake_by_ref(ptr: *const ()) {
+        let this = ManuallyDrop::new(Arc::from_raw(ptr as *const Self));
+        Arc::clone(&this).wake();
+    }
+
+    unsafe fn waker_drop(ptr: *const ()) {
+        drop(Arc::from_raw(ptr as *const Self));
+    }
+}
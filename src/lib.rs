@@ -164,6 +164,68 @@
 //! need to be defined as `extern "C"` ABI or no\_mangle. CXX will put in the
 //! right shims where necessary to make it all work.
 //!
+//! A shared struct whose fields are all primitives, directly or through other
+//! such structs, has its layout asserted at compile time on both sides:
+//! offsets and size in C++, along with being trivially copyable, and size in
+//! Rust. Arrays of such a struct can therefore be copied as bytes, or kept in
+//! memory-mapped files that either language reads.
+//!
+//! Opaque C++ types are neither Send nor Sync in Rust, since CXX cannot see
+//! what they guard against. A C++ type whose const member functions may be
+//! called from several threads at once, and which may be destroyed on a thread
+//! other than the one that made it, can be declared as `#[thread_safe] type
+//! ThingC;`. CXX then implements Send and Sync for it, so that for example a
+//! `SharedPtr<ThingC>` can be cloned into worker threads. It is up to the C++
+//! type to live up to that.
+//!
+//! Opaque Rust types normally reach C++ only behind a Box or a reference. One
+//! that implements Default can instead be declared with the room it needs, as
+//! `#[layout(size = 48, align = 8)] type ThingR;`, and C++ then holds it by
+//! value, on the stack or inside another object, with no allocation. The Rust
+//! side fails to compile if the type does not fit. The C++ default constructor
+//! makes `ThingR::default()` in place, and a C++ move leaves a default value
+//! behind in the moved-from object. The value is passed to Rust functions by
+//! reference.
+//!
+//! A function called once per item of a large collection can be marked
+//! `#[batch]` in either part of the bridge. CXX then also generates `f_batch`,
+//! which takes each argument of `f` as a slice and writes the results of `f`
+//! into `out: &mut [T]`. The loop runs on the side that implements `f`, so a
+//! whole batch crosses the boundary once. Arguments must be primitives by
+//! value or shared structs by reference, and the return type must be a
+//! primitive or shared struct.
+//!
+//! A C++ function declared as `async fn f(...) -> T` returns a
+//! `cxx::CxxFuture<T>` to Rust. The C++ implementation takes one more argument,
+//! a `rust::Promise<T>`, and returns void. It may move the promise to another
+//! thread and call `set_value` once it has the result, which wakes the
+//! awaiting Rust task. Arguments of an async function must be passed by value.
+//! The return type can be a primitive, `String`, or shared struct.
+//!
+//! The same goes for an async function implemented in Rust. C++ calls it with
+//! one more argument, a callable taking the result, such as a lambda; the call
+//! returns once the future first yields, and the callable is called when the
+//! future is ready, on whichever thread woke it last. The future must be
+//! `Send + 'static`. There is no executor, so a future that needs a runtime
+//! should spawn itself on one and await the result.
+//!
+//! A Rust function with an argument of type `fn(T) -> U` can be called from C++
+//! with any callable, such as a capturing lambda, which converts to
+//! `rust::Fn<U(T)>`. Captures of up to three pointers are stored inside the
+//! `rust::Fn` without allocating. The Rust implementation receives the callable
+//! as `&dyn Fn(T) -> U`, or as any `impl Fn(T) -> U`. Its arguments must be
+//! primitives, references, or shared structs made only of primitives, and its
+//! return type a primitive or such a struct.
+//!
+//! Large data can be streamed instead of materialized as a string. A
+//! `&mut CxxIstream` or `&mut CxxOstream` in a signature is a `std::istream &`
+//! or `std::ostream &` in C++, which Rust reads through `io::Read` or writes
+//! through `io::Write`. Going the other way, [`CxxIstream::with_reader`] and
+//! [`CxxOstream::with_writer`] construct a C++ stream on the stack that pulls
+//! from a Rust reader or pushes to a Rust writer, and pass it to a closure.
+//! Data moves through a buffer provided by the caller, so memory use stays flat
+//! however much is transferred.
+//!
 //! <br>
 //!
 //! # Comparison vs bindgen and cbindgen
@@ -293,6 +355,14 @@
 //!   Rust trait to connect the behavior back to the template instantiations
 //!   performed by the other language.
 //!
+//! - A panic must not unwind out of a Rust function into C++. Every call from
+//!   C++ into Rust therefore goes through `catch_unwind` and aborts the process
+//!   on panic. For a hot function that is not expected to panic, writing
+//!   `#[nopanic]` on its declaration in the `extern "Rust"` block drops that
+//!   wrapper and makes the shim a direct call. Such a function still aborts
+//!   the process if it does panic, through a guard that only runs while
+//!   unwinding and so costs nothing when the call returns normally.
+//!
 //! [rust-lang/rust-bindgen#778]: https://github.com/rust-lang/rust-bindgen/issues/778
 //!
 //! <br>
@@ -307,16 +377,28 @@
 //! <tr><th>name in Rust</th><th>name in C++</th><th>restrictions</th></tr>
 //! <tr><td>String</td><td>rust::String</td><td></td></tr>
 //! <tr><td>&amp;str</td><td>rust::Str</td><td></td></tr>
+//! <tr><td>&amp;[T]</td><td>rust::Slice&lt;const T&gt;</td><td><sup><i>T must be a primitive or shared struct</i></sup></td></tr>
+//! <tr><td>&amp;mut [T]</td><td>rust::Slice&lt;T&gt;</td><td><sup><i>T must be a primitive or shared struct</i></sup></td></tr>
 //! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.CxxString.html">CxxString</a></td><td>std::string</td><td><sup><i>cannot be passed by value</i></sup></td></tr>
+//! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.CxxIstream.html">CxxIstream</a></td><td>std::istream</td><td><sup><i>cannot be passed by value</i></sup></td></tr>
+//! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.CxxOstream.html">CxxOstream</a></td><td>std::ostream</td><td><sup><i>cannot be passed by value</i></sup></td></tr>
 //! <tr><td>Box&lt;T&gt;</td><td>rust::Box&lt;T&gt;</td><td><sup><i>cannot hold opaque C++ type</i></sup></td></tr>
+//! <tr><td>Vec&lt;T&gt;</td><td>rust::Vec&lt;T&gt;</td><td><sup><i>T must be a primitive or shared struct</i></sup></td></tr>
 //! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.UniquePtr.html">UniquePtr&lt;T&gt;</a></td><td>std::unique_ptr&lt;T&gt;</td><td><sup><i>cannot hold opaque Rust type</i></sup></td></tr>
-//! <tr><td>fn(T, U) -&gt; V</td><td>rust::Fn&lt;V(T, U)&gt;</td><td><sup><i>only passing from Rust to C++ is implemented so far</i></sup></td></tr>
+//! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.SharedPtr.html">SharedPtr&lt;T&gt;</a></td><td>std::shared_ptr&lt;T&gt;</td><td><sup><i>cannot hold opaque Rust type</i></sup></td></tr>
+//! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.WeakPtr.html">WeakPtr&lt;T&gt;</a></td><td>std::weak_ptr&lt;T&gt;</td><td><sup><i>cannot hold opaque Rust type</i></sup></td></tr>
+//! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.CxxVector.html">CxxVector&lt;T&gt;</a></td><td>std::vector&lt;T&gt;</td><td><sup><i>cannot be passed by value, T must be a non-bool primitive or shared struct</i></sup></td></tr>
+//! <tr><td><a href="https://docs.rs/cxx/0.2/cxx/struct.Arena.html">Arena</a></td><td>rust::Arena</td><td><sup><i>cannot be passed by value, only trivially destructible C++ types can be made in it</i></sup></td></tr>
+//! <tr><td>fn(T, U) -&gt; V</td><td>rust::Fn&lt;V(T, U)&gt;</td><td></td></tr>
 //! <tr><td>Result&lt;T&gt;</td><td>error &lt;=&gt; exception</td><td><sup><i>allowed as return type only</i></sup></td></tr>
 //! </table>
 //!
 //! The C++ API of the `rust` namespace is defined by the *include/cxx.h* file
 //! in [https://github.com/dtolnay/cxx]. You will need to include this header in
-//! your C++ code when working with those types.
+//! your C++ code when working with those types. Each type also has a header of
+//! its own, such as `rust/cxx/str.h` for `rust::Str`, that includes only the
+//! standard library headers which that type needs; C++ headers that mention
+//! just a few of the types parse faster including those instead.
 //!
 //! The following types are intended to be supported "soon" but are just not
 //! implemented yet. I don't expect any of these to be hard to make work but
@@ -324,15 +406,11 @@
 //!
 //! <table>
 //! <tr><th>name in Rust</th><th>name in C++</th></tr>
-//! <tr><td>&amp;[T]</td><td><sup><i>tbd</i></sup></td></tr>
-//! <tr><td>Vec&lt;T&gt;</td><td><sup><i>tbd</i></sup></td></tr>
 //! <tr><td>BTreeMap&lt;K, V&gt;</td><td><sup><i>tbd</i></sup></td></tr>
 //! <tr><td>HashMap&lt;K, V&gt;</td><td><sup><i>tbd</i></sup></td></tr>
 //! <tr><td>Arc&lt;T&gt;</td><td><sup><i>tbd</i></sup></td></tr>
-//! <tr><td><sup><i>tbd</i></sup></td><td>std::vector&lt;T&gt;</td></tr>
 //! <tr><td><sup><i>tbd</i></sup></td><td>std::map&lt;K, V&gt;</td></tr>
 //! <tr><td><sup><i>tbd</i></sup></td><td>std::unordered_map&lt;K, V&gt;</td></tr>
-//! <tr><td><sup><i>tbd</i></sup></td><td>std::shared_ptr&lt;T&gt;</td></tr>
 //! </table>
 //!
 //! [https://github.com/dtolnay/cxx]: https://github.com/dtolnay/cxx
@@ -345,6 +423,7 @@
     clippy::large_enum_variant,
     clippy::missing_safety_doc,
     clippy::module_inception,
+    clippy::mut_from_ref,
     clippy::needless_doctest_main,
     clippy::new_without_default,
     clippy::or_fun_call,
@@ -358,43 +437,69 @@ extern crate link_cplusplus;
 #[macro_use]
 mod assert;
 
+mod arena;
+mod cxx_stream;
 mod cxx_string;
+mod cxx_vector;
 mod error;
 mod exception;
 mod function;
+mod future;
 mod gen;
 mod opaque;
 mod paths;
 mod result;
+mod rust_slice;
 mod rust_str;
 mod rust_string;
+mod rust_vec;
+mod shared_ptr;
+mod stats;
 mod syntax;
 mod unique_ptr;
 mod unwind;
+mod weak_ptr;
 
-pub use crate::cxx_string::CxxString;
+pub use crate::arena::Arena;
+pub use crate::cxx_stream::{CxxIstream, CxxOstream};
+pub use crate::cxx_string::{CxxStr, CxxString};
+pub use crate::cxx_vector::CxxVector;
 pub use crate::exception::Exception;
+pub use crate::future::CxxFuture;
+pub use crate::result::ErrorCode;
+pub use crate::shared_ptr::SharedPtr;
+pub use crate::stats::{stats, CallStats};
 pub use crate::unique_ptr::UniquePtr;
+pub use crate::weak_ptr::WeakPtr;
 pub use cxxbridge_macro::bridge;
 
 // Not public API.
 #[doc(hidden)]
 pub mod private {
+    pub use crate::assert::{align_up, ToBool, True};
+    pub use crate::cxx_vector::VectorElement;
     pub use crate::function::FatFunction;
+    pub use crate::future::{future_promise, spawn, PromiseRepr};
     pub use crate::opaque::Opaque;
-    pub use crate::result::{r#try, Result};
+    pub use crate::result::{r#try, CError, Result, ToCError, ToCErrorCode};
+    pub use crate::rust_slice::RustSlice;
     pub use crate::rust_str::RustStr;
     pub use crate::rust_string::RustString;
+    pub use crate::rust_vec::RustVec;
+    pub use crate::shared_ptr::SharedPtrTarget;
+    pub use crate::stats::CallSite;
     pub use crate::unique_ptr::UniquePtrTarget;
-    pub use crate::unwind::catch_unwind;
+    pub use crate::unwind::{catch_unwind, AbortOnUnwind};
+    pub use crate::weak_ptr::WeakPtrTarget;
 }
 
 use crate::error::Result;
 use crate::gen::Opt;
 use anyhow::anyhow;
+use std::env;
 use std::fs;
 use std::io::{self, Write};
-use std::path::Path;
+use std::path::{Path, PathBuf};
 use std::process;
 
 /// The CXX code generator for constructing and compiling C++ code.
@@ -446,13 +551,49 @@ use std::process;
 /// ```
 #[must_use]
 pub struct Build {
-    _private: (),
+    direct_calls: bool,
+    unity: bool,
 }
 
 impl Build {
     /// Begin with a [`cc::Build`] in its default configuration.
     pub fn new() -> Self {
-        Build { _private: () }
+        Build {
+            direct_calls: false,
+            unity: false,
+        }
+    }
+
+    /// Generate shims that call the C++ functions directly, and C++ wrappers
+    /// of Rust functions that are defined inline in the generated header.
+    ///
+    /// The calls are then only one function call deep in either direction,
+    /// which in turn lets cross-language LTO inline a small function all the
+    /// way into its caller on the other side. That needs the Rust and C++
+    /// code to be compiled by the same LLVM version, for example with clang as
+    /// the C++ compiler and
+    ///
+    /// ```bash
+    /// RUSTFLAGS="-Clinker-plugin-lto -Clinker=clang -Clink-arg=-fuse-ld=lld"
+    /// ```
+    ///
+    /// together with `.flag("-flto=thin")` on the returned [`cc::Build`].
+    pub fn direct_calls(&mut self, enable: bool) -> &mut Self {
+        self.direct_calls = enable;
+        self
+    }
+
+    /// Compile all bridges passed to one [`bridges`](Build::bridges) call as
+    /// a single C++ translation unit, instead of one per bridge.
+    ///
+    /// The standard library headers, `rust/cxx.h`, and the headers of the
+    /// project are then parsed once rather than once per bridge, which is
+    /// most of the time spent compiling generated code. The unity file
+    /// includes `rust/cxx.h` before anything else so that a precompiled
+    /// header for it can be used.
+    pub fn unity(&mut self, enable: bool) -> &mut Self {
+        self.unity = enable;
+        self
     }
 
     /// This returns a [`cc::Build`] on which you should continue to set up
@@ -460,9 +601,35 @@ impl Build {
     /// [`compile`] method to execute the C++ build.
     ///
     /// [`compile`]: https://docs.rs/cc/1.0.49/cc/struct.Build.html#method.compile
+    ///
+    /// Code generation is skipped when the `#[cxx::bridge]` module is
+    /// unchanged since the last build, and generated files are never
+    /// rewritten with identical contents, so that C++ sources including the
+    /// generated header are not rebuilt for nothing.
     #[must_use]
     pub fn bridge(&self, rust_source_file: impl AsRef<Path>) -> cc::Build {
-        match try_generate_bridge(rust_source_file.as_ref()) {
+        self.bridges(Some(rust_source_file))
+    }
+
+    /// Like [`bridge`](Build::bridge) for any number of source files at once.
+    ///
+    /// The files are parsed and generated in parallel, using as many threads
+    /// as Cargo allows the build script, and the returned [`cc::Build`]
+    /// compiles all of the generated code. Its [`compile`] then builds the
+    /// files in parallel too if the `parallel` feature of `cc` is enabled.
+    ///
+    /// [`compile`]: https://docs.rs/cc/1.0.49/cc/struct.Build.html#method.compile
+    #[must_use]
+    pub fn bridges<I>(&self, rust_source_files: I) -> cc::Build
+    where
+        I: IntoIterator,
+        I::Item: AsRef<Path>,
+    {
+        let rust_source_files = rust_source_files
+            .into_iter()
+            .map(|path| path.as_ref().to_owned())
+            .collect();
+        match try_generate_bridges(self, rust_source_files) {
             Ok(build) => build,
             Err(err) => {
                 let _ = writeln!(io::stderr(), "\n\ncxxbridge error: {:?}\n\n", anyhow!(err));
@@ -472,23 +639,77 @@ impl Build {
     }
 }
 
-fn try_generate_bridge(rust_source_file: &Path) -> Result<cc::Build> {
-    let header = gen::do_generate_header(rust_source_file, Opt::default());
-    let header_path = paths::out_with_extension(rust_source_file, ".h")?;
-    fs::create_dir_all(header_path.parent().unwrap())?;
-    fs::write(&header_path, header)?;
-    paths::symlink_header(&header_path, rust_source_file);
+fn try_generate_bridges(build: &Build, rust_source_files: Vec<PathBuf>) -> Result<cc::Build> {
+    let opt = Opt {
+        direct_calls: build.direct_calls,
+        ..Opt::default()
+    };
+    // Set by Cargo for build scripts, to the number of jobs of the build.
+    let jobs = env::var("NUM_JOBS")
+        .ok()
+        .and_then(|jobs| jobs.parse().ok())
+        .unwrap_or(1);
+    let unity_path = match rust_source_files.first() {
+        Some(first) if build.unity => Some(paths::out_with_extension(first, ".unity.cc")?),
+        _ => None,
+    };
+    let generated = gen::parallel::map(rust_source_files, jobs, move |rust_source_file| {
+        generate_bridge_files(&opt, &rust_source_file)
+    });
+    let bridge_paths = generated.into_iter().collect::<Result<Vec<_>>>()?;
 
-    let bridge = gen::do_generate_bridge(rust_source_file, Opt::default());
-    let bridge_path = paths::out_with_extension(rust_source_file, ".cc")?;
-    fs::write(&bridge_path, bridge)?;
     let mut build = paths::cc_build();
-    build.file(&bridge_path);
+    match unity_path {
+        Some(unity_path) => {
+            paths::write_if_changed(&unity_path, &gen::unity(&bridge_paths))?;
+            build.file(unity_path);
+        }
+        None => {
+            build.files(bridge_paths);
+        }
+    }
 
-    let ref cxx_h = paths::include_dir()?.join("rust").join("cxx.h");
-    let _ = fs::create_dir_all(cxx_h.parent().unwrap());
-    let _ = fs::remove_file(cxx_h);
-    let _ = fs::write(cxx_h, gen::include::HEADER);
+    let ref rust_dir = paths::include_dir()?.join("rust");
+    let _ = fs::create_dir_all(rust_dir.join("cxx"));
+    let _ = paths::write_if_changed(&rust_dir.join("cxx.h"), gen::include::HEADER.as_bytes());
+    for (path, fragment) in gen::include::FRAGMENTS {
+        let _ = paths::write_if_changed(&rust_dir.join(path), fragment.as_bytes());
+    }
 
     Ok(build)
 }
+
+// Writes the header and implementation generated from one source file, and
+// returns the path of the implementation.
+fn generate_bridge_files(opt: &Opt, rust_source_file: &Path) -> Result<PathBuf> {
+    let header_path = paths::out_with_extension(rust_source_file, ".h")?;
+    let bridge_path = paths::out_with_extension(rust_source_file, ".cc")?;
+    let cache_path = paths::out_with_extension(rust_source_file, ".fingerprint")?;
+    fs::create_dir_all(header_path.parent().unwrap())?;
+
+    // The cache holds a fingerprint of the whole source file, which is cheap
+    // to check, and one of just the bridge module, which still matches after
+    // edits to the rest of the file. Either one matching means the generated
+    // files from last time are still correct.
+    let ref source = gen::read_source(rust_source_file);
+    let source_fingerprint = gen::fingerprint(source, opt);
+    let cache = fs::read_to_string(&cache_path).unwrap_or_default();
+    let mut cache = cache.lines();
+    let cached_source = cache.next();
+    let cached_bridge = cache.next();
+    let outputs_exist = header_path.exists() && bridge_path.exists();
+    if !outputs_exist || cached_source != Some(source_fingerprint.as_str()) {
+        let bridge = gen::find_bridge(rust_source_file, source);
+        let bridge_fingerprint = bridge.fingerprint(opt);
+        if !outputs_exist || cached_bridge != Some(bridge_fingerprint.as_str()) {
+            let code = bridge.generate(opt.clone());
+            paths::write_if_changed(&header_path, &code.header)?;
+            paths::write_if_changed(&bridge_path, &code.implementation)?;
+        }
+        let cache = format!("{}\n{}\n", source_fingerprint, bridge_fingerprint);
+        fs::write(&cache_path, cache)?;
+    }
+    paths::symlink_header(&header_path, rust_source_file);
+
+    Ok(bridge_path)
+}
@@ -36,18 +36,42 @@ fn try_symlink_header(path: &Path, original: &Path) -> Result<()> {
     let suffix = relative_to_parent_of_target_dir(original)?;
     let ref dst = include_dir()?.join(suffix);
 
+    let mut file_name = dst.file_name().unwrap().to_os_string();
+    file_name.push(".h");
+    let ref dst2 = dst.with_file_name(file_name);
+
+    // Links that are already in place are left alone, so that the build
+    // systems of C++ code including the header do not see it change.
+    if links_to(dst, path) && links_to(dst2, path) {
+        return Ok(());
+    }
+
     fs::create_dir_all(dst.parent().unwrap())?;
     let _ = fs::remove_file(dst);
     symlink(path, dst)?;
-
-    let mut file_name = dst.file_name().unwrap().to_os_string();
-    file_name.push(".h");
-    let dst2 = dst.with_file_name(file_name);
+    let _ = fs::remove_file(dst2);
     symlink(path, dst2)?;
 
     Ok(())
 }
 
+fn links_to(link: &Path, path: &Path) -> bool {
+    fs::read_link(link).map_or(false, |target| target == path)
+}
+
+// Leaves the file and its modification time untouched if it already has
+// exactly these contents.
+pub(crate) fn write_if_changed(path: &Path, contents: &[u8]) -> Result<()> {
+    if let Ok(existing) = fs::read(path) {
+        if existing == contents {
+            return Ok(());
+        }
+    }
+    let _ = fs::remove_file(path);
+    fs::write(path, contents)?;
+    Ok(())
+}
+
 fn relative_to_parent_of_target_dir(original: &Path) -> Result<PathBuf> {
     let target_dir = target_dir()?;
     let mut outer = target_dir.parent().unwrap();
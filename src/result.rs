@@ -1,6 +1,6 @@
 use crate::exception::Exception;
 use crate::rust_str::RustStr;
-use std::fmt::Display;
+use std::fmt::{self, Display, Write};
 use std::ptr;
 use std::result::Result as StdResult;
 use std::slice;
@@ -12,31 +12,111 @@ pub union Result {
     ok: *const u8, // null
 }
 
-pub unsafe fn r#try<T, E>(ret: *mut T, result: StdResult<T, E>) -> Result
+/// Error type for carrying a plain numeric code across the bridge.
+///
+/// Returning `Err(ErrorCode(n))` from a Rust function declared with
+/// `Result<T>` throws a `rust::Error` on the C++ side whose `code()` is `n`,
+/// without allocating or formatting anything in Rust. Any other error type
+/// implementing `Display` is thrown with its message and a code of 0.
+#[derive(Copy, Clone, Debug, PartialEq, Eq, Hash)]
+pub struct ErrorCode(pub i64);
+
+impl Display for ErrorCode {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "error code {}", self.0)
+    }
+}
+
+impl std::error::Error for ErrorCode {}
+
+// Error of a Rust function, already converted to the form passed to C++ but
+// not yet handed over, so that the original error value can be dropped first.
+pub enum CError {
+    Code(i64),
+    Inline(InlineMessage),
+    Heap(String),
+}
+
+// Most messages are formatted into this stack buffer rather than a String.
+pub struct InlineMessage {
+    buf: [u8; 256],
+    len: usize,
+}
+
+impl Write for InlineMessage {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        let end = self.len + s.len();
+        if end > self.buf.len() {
+            return Err(fmt::Error);
+        }
+        self.buf[self.len..end].copy_from_slice(s.as_bytes());
+        self.len = end;
+        Ok(())
+    }
+}
+
+// The cxxbridge macro calls `(&err).__to_c_error()` on the concrete error
+// type, which resolves to ToCErrorCode for ErrorCode and to ToCError for
+// everything else.
+pub trait ToCErrorCode {
+    fn __to_c_error(&self) -> CError;
+}
+
+impl ToCErrorCode for ErrorCode {
+    fn __to_c_error(&self) -> CError {
+        CError::Code(self.0)
+    }
+}
+
+pub trait ToCError {
+    fn __to_c_error(&self) -> CError;
+}
+
+impl<E> ToCError for &E
 where
     E: Display,
 {
+    #[cold]
+    fn __to_c_error(&self) -> CError {
+        let mut msg = InlineMessage {
+            buf: [0; 256],
+            len: 0,
+        };
+        if write!(msg, "{}", self).is_ok() {
+            CError::Inline(msg)
+        } else {
+            CError::Heap(self.to_string())
+        }
+    }
+}
+
+pub unsafe fn r#try<T>(ret: *mut T, result: StdResult<T, CError>) -> Result {
     match result {
         Ok(ok) => {
             ptr::write(ret, ok);
             Result { ok: ptr::null() }
         }
-        Err(err) => to_c_error(err.to_string()),
+        Err(err) => to_c_error(err),
     }
 }
 
-unsafe fn to_c_error(msg: String) -> Result {
-    let mut msg = msg;
-    msg.as_mut_vec().push(b'\0');
-    let ptr = msg.as_ptr();
-    let len = msg.len();
-
+#[cold]
+unsafe fn to_c_error(err: CError) -> Result {
     extern "C" {
         #[link_name = "cxxbridge02$error"]
         fn error(ptr: *const u8, len: usize) -> *const u8;
+        #[link_name = "cxxbridge02$error$code"]
+        fn error_code(code: i64, len: &mut usize) -> *const u8;
     }
 
-    let copy = error(ptr, len);
+    let (copy, len) = match &err {
+        CError::Code(code) => {
+            let mut len = 0;
+            (error_code(*code, &mut len), len)
+        }
+        CError::Inline(msg) => (error(msg.buf.as_ptr(), msg.len), msg.len),
+        CError::Heap(msg) => (error(msg.as_ptr(), msg.len()), msg.len()),
+    };
     let slice = slice::from_raw_parts(copy, len);
     let string = str::from_utf8_unchecked(slice);
     let err = RustStr::from(string);
@@ -44,16 +124,12 @@ unsafe fn to_c_error(msg: String) -> Result {
 }
 
 impl Result {
+    #[inline]
     pub unsafe fn exception(self) -> StdResult<(), Exception> {
         if self.ok.is_null() {
             Ok(())
         } else {
-            let err = self.err;
-            let slice = slice::from_raw_parts_mut(err.ptr.as_ptr(), err.len);
-            let s = str::from_utf8_unchecked_mut(slice);
-            Err(Exception {
-                what: Box::from_raw(s),
-            })
+            Err(Exception::from_repr(self.err))
         }
     }
 }
@@ -40,20 +40,16 @@ unsafe extern "C" fn string_clone(this: &mut MaybeUninit<String>, other: &String
     ptr::write(this.as_mut_ptr(), other.clone());
 }
 
-#[export_name = "cxxbridge02$string$from"]
-unsafe extern "C" fn string_from(
+// Caller has already validated the data as UTF-8 (see utf8.cc).
+#[export_name = "cxxbridge02$string$from_unchecked"]
+unsafe extern "C" fn string_from_unchecked(
     this: &mut MaybeUninit<String>,
     ptr: *const u8,
     len: usize,
-) -> bool {
+) {
     let slice = slice::from_raw_parts(ptr, len);
-    match str::from_utf8(slice) {
-        Ok(s) => {
-            ptr::write(this.as_mut_ptr(), s.to_owned());
-            true
-        }
-        Err(_) => false,
-    }
+    let s = str::from_utf8_unchecked(slice);
+    ptr::write(this.as_mut_ptr(), s.to_owned());
 }
 
 #[export_name = "cxxbridge02$string$drop"]
@@ -71,7 +67,54 @@ unsafe extern "C" fn string_len(this: &String) -> usize {
     this.len()
 }
 
-fn _assert() {
-    let _: [(); mem::size_of::<[usize; 3]>()] = [(); mem::size_of::<String>()];
-    let _: [(); mem::align_of::<usize>()] = [(); mem::align_of::<String>()];
+// Rust does not promise an order for the fields of String, so rather than
+// hardcoding one, the inline accessors in cxx.h use whatever word positions
+// this reports. Returns false if the words of a freshly built string cannot be
+// told apart, in which case C++ keeps calling string_ptr and string_len above.
+//
+// Also reports the bits of String::new(), which C++ stamps into moved-from
+// strings without calling string_new. That is only sound if an empty string
+// owns no allocation, so that any number of copies of it may be dropped.
+#[export_name = "cxxbridge02$string$layout"]
+unsafe extern "C" fn string_layout(
+    ptr: &mut usize,
+    len: &mut usize,
+    empty: &mut [usize; 3],
+) -> bool {
+    let new = String::new();
+    if new.capacity() != 0 {
+        return false;
+    }
+    *empty = *(&new as *const String as *const [usize; 3]);
+
+    let mut probe = String::with_capacity(8);
+    probe.push('0');
+    let repr = &*(&probe as *const String as *const [usize; 3]);
+    let position = |value: usize| {
+        let mut found = None;
+        for (i, word) in repr.iter().enumerate() {
+            if *word == value {
+                if found.is_some() {
+                    return None;
+                }
+                found = Some(i);
+            }
+        }
+        found
+    };
+    match (
+        position(probe.as_ptr() as usize),
+        position(probe.len()),
+        position(probe.capacity()),
+    ) {
+        (Some(p), Some(l), Some(_)) if p != l => {
+            *ptr = p;
+            *len = l;
+            true
+        }
+        _ => false,
+    }
 }
+
+const_assert!(mem::size_of::<String>() == mem::size_of::<[usize; 3]>());
+const_assert!(mem::align_of::<String>() == mem::align_of::<usize>());
@@ -0,0 +1,283 @@
+use std::mem;
+use std::ptr;
+
+#[repr(C)]
+pub struct RustVec<T> {
+    repr: Vec<T>,
+}
+
+impl<T> RustVec<T> {
+    pub fn new() -> Self {
+        RustVec { repr: Vec::new() }
+    }
+
+    pub fn from(v: Vec<T>) -> Self {
+        RustVec { repr: v }
+    }
+
+    pub fn from_ref(v: &Vec<T>) -> &Self {
+        unsafe { &*(v as *const Vec<T> as *const RustVec<T>) }
+    }
+
+    pub fn from_mut(v: &mut Vec<T>) -> &mut Self {
+        unsafe { &mut *(v as *mut Vec<T> as *mut RustVec<T>) }
+    }
+
+    pub fn into_vec(self) -> Vec<T> {
+        self.repr
+    }
+
+    pub fn as_vec(&self) -> &Vec<T> {
+        &self.repr
+    }
+
+    pub fn as_mut_vec(&mut self) -> &mut Vec<T> {
+        &mut self.repr
+    }
+
+    pub fn len(&self) -> usize {
+        self.repr.len()
+    }
+
+    pub fn as_ptr(&self) -> *const T {
+        self.repr.as_ptr()
+    }
+
+    // Returns false instead of panicking like Vec::reserve if the capacity in
+    // bytes would exceed isize::MAX, since the panic would unwind into C++.
+    pub fn reserve_total(&mut self, cap: usize) -> bool {
+        let size = mem::size_of::<T>();
+        if size != 0 && cap > isize::MAX as usize / size {
+            return false;
+        }
+        let len = self.repr.len();
+        if cap > len {
+            self.repr.reserve(cap - len);
+        }
+        true
+    }
+
+    pub unsafe fn set_len(&mut self, len: usize) {
+        self.repr.set_len(len);
+    }
+
+    // Which of the three words of a Vec<T> hold the pointer, the length and
+    // the capacity, for rust::Vec<T> to read them inline. Rust does not promise
+    // a field order, not even the same one for every T, so this is asked for
+    // each T separately. Returns false if the words of a freshly allocated
+    // vector cannot be told apart, in which case C++ keeps calling the len and
+    // data shims.
+    pub fn layout(ptr: &mut usize, len: &mut usize, cap: &mut usize) -> bool {
+        if mem::size_of::<Vec<T>>() != mem::size_of::<[usize; 3]>() {
+            return false;
+        }
+        let probe = Vec::<T>::with_capacity(4);
+        let repr = unsafe { &*(&probe as *const Vec<T> as *const [usize; 3]) };
+        let position = |value: usize| {
+            let mut found = None;
+            for (i, word) in repr.iter().enumerate() {
+                if *word == value {
+                    if found.is_some() {
+                        return None;
+                    }
+                    found = Some(i);
+                }
+            }
+            found
+        };
+        match (
+            position(probe.as_ptr() as usize),
+            position(probe.len()),
+            position(probe.capacity()),
+        ) {
+            (Some(p), Some(l), Some(c)) if p != l && l != c && p != c => {
+                *ptr = p;
+                *len = l;
+                *cap = c;
+                true
+            }
+            _ => false,
+        }
+    }
+}
+
+// Vec<T> for shared structs gets the same shims from the cxxbridge macro, in
+// expand_rust_vec. Primitives are instantiated once here instead, so that two
+// bridges using Vec<u8> do not both define them.
+macro_rules! rust_vec_shims_for_primitive {
+    (
+        $ty:ty,
+        $new:literal,
+        $drop:literal,
+        $len:literal,
+        $data:literal,
+        $reserve_total:literal,
+        $set_len:literal,
+        $layout:literal $(,)?
+    ) => {
+        const _: () = {
+            #[export_name = $new]
+            unsafe extern "C" fn __new(this: *mut RustVec<$ty>) {
+                ptr::write(this, RustVec::new());
+            }
+            #[export_name = $drop]
+            unsafe extern "C" fn __drop(this: *mut RustVec<$ty>) {
+                ptr::drop_in_place(this);
+            }
+            #[export_name = $len]
+            unsafe extern "C" fn __len(this: *const RustVec<$ty>) -> usize {
+                (*this).len()
+            }
+            #[export_name = $data]
+            unsafe extern "C" fn __data(this: *const RustVec<$ty>) -> *const $ty {
+                (*this).as_ptr()
+            }
+            #[export_name = $reserve_total]
+            unsafe extern "C" fn __reserve_total(this: *mut RustVec<$ty>, cap: usize) -> bool {
+                (*this).reserve_total(cap)
+            }
+            #[export_name = $set_len]
+            unsafe extern "C" fn __set_len(this: *mut RustVec<$ty>, len: usize) {
+                (*this).set_len(len);
+            }
+            #[export_name = $layout]
+            extern "C" fn __layout(ptr: &mut usize, len: &mut usize, cap: &mut usize) -> bool {
+                RustVec::<$ty>::layout(ptr, len, cap)
+            }
+        };
+    };
+}
+
+rust_vec_shims_for_primitive!(
+    bool,
+    "cxxbridge02$rust_vec$bool$new",
+    "cxxbridge02$rust_vec$bool$drop",
+    "cxxbridge02$rust_vec$bool$len",
+    "cxxbridge02$rust_vec$bool$data",
+    "cxxbridge02$rust_vec$bool$reserve_total",
+    "cxxbridge02$rust_vec$bool$set_len",
+    "cxxbridge02$rust_vec$bool$layout",
+);
+rust_vec_shims_for_primitive!(
+    u8,
+    "cxxbridge02$rust_vec$u8$new",
+    "cxxbridge02$rust_vec$u8$drop",
+    "cxxbridge02$rust_vec$u8$len",
+    "cxxbridge02$rust_vec$u8$data",
+    "cxxbridge02$rust_vec$u8$reserve_total",
+    "cxxbridge02$rust_vec$u8$set_len",
+    "cxxbridge02$rust_vec$u8$layout",
+);
+rust_vec_shims_for_primitive!(
+    u16,
+    "cxxbridge02$rust_vec$u16$new",
+    "cxxbridge02$rust_vec$u16$drop",
+    "cxxbridge02$rust_vec$u16$len",
+    "cxxbridge02$rust_vec$u16$data",
+    "cxxbridge02$rust_vec$u16$reserve_total",
+    "cxxbridge02$rust_vec$u16$set_len",
+    "cxxbridge02$rust_vec$u16$layout",
+);
+rust_vec_shims_for_primitive!(
+    u32,
+    "cxxbridge02$rust_vec$u32$new",
+    "cxxbridge02$rust_vec$u32$drop",
+    "cxxbridge02$rust_vec$u32$len",
+    "cxxbridge02$rust_vec$u32$data",
+    "cxxbridge02$rust_vec$u32$reserve_total",
+    "cxxbridge02$rust_vec$u32$set_len",
+    "cxxbridge02$rust_vec$u32$layout",
+);
+rust_vec_shims_for_primitive!(
+    u64,
+    "cxxbridge02$rust_vec$u64$new",
+    "cxxbridge02$rust_vec$u64$drop",
+    "cxxbridge02$rust_vec$u64$len",
+    "cxxbridge02$rust_vec$u64$data",
+    "cxxbridge02$rust_vec$u64$reserve_total",
+    "cxxbridge02$rust_vec$u64$set_len",
+    "cxxbridge02$rust_vec$u64$layout",
+);
+rust_vec_shims_for_primitive!(
+    usize,
+    "cxxbridge02$rust_vec$usize$new",
+    "cxxbridge02$rust_vec$usize$drop",
+    "cxxbridge02$rust_vec$usize$len",
+    "cxxbridge02$rust_vec$usize$data",
+    "cxxbridge02$rust_vec$usize$reserve_total",
+    "cxxbridge02$rust_vec$usize$set_len",
+    "cxxbridge02$rust_vec$usize$layout",
+);
+rust_vec_shims_for_primitive!(
+    i8,
+    "cxxbridge02$rust_vec$i8$new",
+    "cxxbridge02$rust_vec$i8$drop",
+    "cxxbridge02$rust_vec$i8$len",
+    "cxxbridge02$rust_vec$i8$data",
+    "cxxbridge02$rust_vec$i8$reserve_total",
+    "cxxbridge02$rust_vec$i8$set_len",
+    "cxxbridge02$rust_vec$i8$layout",
+);
+rust_vec_shims_for_primitive!(
+    i16,
+    "cxxbridge02$rust_vec$i16$new",
+    "cxxbridge02$rust_vec$i16$drop",
+    "cxxbridge02$rust_vec$i16$len",
+    "cxxbridge02$rust_vec$i16$data",
+    "cxxbridge02$rust_vec$i16$reserve_total",
+    "cxxbridge02$rust_vec$i16$set_len",
+    "cxxbridge02$rust_vec$i16$layout",
+);
+rust_vec_shims_for_primitive!(
+    i32,
+    "cxxbridge02$rust_vec$i32$new",
+    "cxxbridge02$rust_vec$i32$drop",
+    "cxxbridge02$rust_vec$i32$len",
+    "cxxbridge02$rust_vec$i32$data",
+    "cxxbridge02$rust_vec$i32$reserve_total",
+    "cxxbridge02$rust_vec$i32$set_len",
+    "cxxbridge02$rust_vec$i32$layout",
+);
+rust_vec_shims_for_primitive!(
+    i64,
+    "cxxbridge02$rust_vec$i64$new",
+    "cxxbridge02$rust_vec$i64$drop",
+    "cxxbridge02$rust_vec$i64$len",
+    "cxxbridge02$rust_vec$i64$data",
+    "cxxbridge02$rust_vec$i64$reserve_total",
+    "cxxbridge02$rust_vec$i64$set_len",
+    "cxxbridge02$rust_vec$i64$layout",
+);
+rust_vec_shims_for_primitive!(
+    isize,
+    "cxxbridge02$rust_vec$isize$new",
+    "cxxbridge02$rust_vec$isize$drop",
+    "cxxbridge02$rust_vec$isize$len",
+    "cxxbridge02$rust_vec$isize$data",
+    "cxxbridge02$rust_vec$isize$reserve_total",
+    "cxxbridge02$rust_vec$isize$set_len",
+    "cxxbridge02$rust_vec$isize$layout",
+);
+rust_vec_shims_for_primitive!(
+    f32,
+    "cxxbridge02$rust_vec$f32$new",
+    "cxxbridge02$rust_vec$f32$drop",
+    "cxxbridge02$rust_vec$f32$len",
+    "cxxbridge02$rust_vec$f32$data",
+    "cxxbridge02$rust_vec$f32$reserve_total",
+    "cxxbridge02$rust_vec$f32$set_len",
+    "cxxbridge02$rust_vec$f32$layout",
+);
+rust_vec_shims_for_primitive!(
+    f64,
+    "cxxbridge02$rust_vec$f64$new",
+    "cxxbridge02$rust_vec$f64$drop",
+    "cxxbridge02$rust_vec$f64$len",
+    "cxxbridge02$rust_vec$f64$data",
+    "cxxbridge02$rust_vec$f64$reserve_total",
+    "cxxbridge02$rust_vec$f64$set_len",
+    "cxxbridge02$rust_vec$f64$layout",
+);
+
+const_assert!(mem::size_of::<Vec<u8>>() == mem::size_of::<[usize; 3]>());
+const_assert!(mem::align_of::<Vec<u8>>() == mem::align_of::<usize>());
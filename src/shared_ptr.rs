@@ -0,0 +1,162 @@
+use crate::cxx_string::CxxString;
+use crate::weak_ptr::{WeakPtr, WeakPtrTarget};
+use std::ffi::c_void;
+use std::fmt::{self, Debug, Display};
+use std::marker::PhantomData;
+use std::mem::MaybeUninit;
+
+/// Binding to C++ `std::shared_ptr<T>`.
+///
+/// Cloning a SharedPtr increments the atomic reference count shared with C++,
+/// like copying the shared\_ptr in C++ would; the object itself is never
+/// copied. Provided that `T` is Send and Sync, clones may be moved to other
+/// threads, so that many Rust threads can read one object owned by C++.
+#[repr(C)]
+pub struct SharedPtr<T>
+where
+    T: SharedPtrTarget,
+{
+    repr: [*mut c_void; 2],
+    ty: PhantomData<T>,
+}
+
+impl<T> SharedPtr<T>
+where
+    T: SharedPtrTarget,
+{
+    /// Makes a new SharedPtr wrapping a null pointer.
+    ///
+    /// Matches the behavior of default-constructing a std::shared\_ptr.
+    pub fn null() -> Self {
+        let mut shared = MaybeUninit::<Self>::uninit();
+        unsafe {
+            T::__null(shared.as_mut_ptr() as *mut c_void);
+            shared.assume_init()
+        }
+    }
+
+    /// Checks whether the SharedPtr does not own an object.
+    ///
+    /// This is the opposite of [std::shared\_ptr\<T\>::operator bool](https://en.cppreference.com/w/cpp/memory/shared_ptr/operator_bool).
+    pub fn is_null(&self) -> bool {
+        self.as_ref().is_none()
+    }
+
+    /// Returns a reference to the object owned by this SharedPtr if any,
+    /// otherwise None.
+    pub fn as_ref(&self) -> Option<&T> {
+        unsafe { T::__get(self as *const Self as *const c_void).as_ref() }
+    }
+
+    /// Makes a WeakPtr to the object owned by this SharedPtr, which does not
+    /// keep the object alive.
+    ///
+    /// Matches the behavior of constructing a std::weak\_ptr from a
+    /// std::shared\_ptr.
+    pub fn downgrade(this: &Self) -> WeakPtr<T>
+    where
+        T: WeakPtrTarget,
+    {
+        let mut weak = MaybeUninit::<WeakPtr<T>>::uninit();
+        unsafe {
+            T::__downgrade(
+                this as *const Self as *const c_void,
+                weak.as_mut_ptr() as *mut c_void,
+            );
+            weak.assume_init()
+        }
+    }
+}
+
+// Like Arc<T>, a SharedPtr hands out &T on any thread holding a clone, and
+// the last clone may drop the object on any thread.
+unsafe impl<T> Send for SharedPtr<T> where T: Send + Sync + SharedPtrTarget {}
+unsafe impl<T> Sync for SharedPtr<T> where T: Send + Sync + SharedPtrTarget {}
+
+impl<T> Clone for SharedPtr<T>
+where
+    T: SharedPtrTarget,
+{
+    fn clone(&self) -> Self {
+        let mut shared = MaybeUninit::<Self>::uninit();
+        unsafe {
+            T::__clone(
+                self as *const Self as *const c_void,
+                shared.as_mut_ptr() as *mut c_void,
+            );
+            shared.assume_init()
+        }
+    }
+}
+
+impl<T> Drop for SharedPtr<T>
+where
+    T: SharedPtrTarget,
+{
+    fn drop(&mut self) {
+        unsafe { T::__drop(self as *mut Self as *mut c_void) }
+    }
+}
+
+impl<T> Debug for SharedPtr<T>
+where
+    T: Debug + SharedPtrTarget,
+{
+    fn fmt(&self, formatter: &mut fmt::Formatter) -> fmt::Result {
+        match self.as_ref() {
+            None => formatter.write_str("nullptr"),
+            Some(value) => Debug::fmt(value, formatter),
+        }
+    }
+}
+
+impl<T> Display for SharedPtr<T>
+where
+    T: Display + SharedPtrTarget,
+{
+    fn fmt(&self, formatter: &mut fmt::Formatter) -> fmt::Result {
+        match self.as_ref() {
+            None => formatter.write_str("nullptr"),
+            Some(value) => Display::fmt(value, formatter),
+        }
+    }
+}
+
+// Methods are private; not intended to be implemented outside of cxxbridge
+// codebase.
+pub unsafe trait SharedPtrTarget {
+    #[doc(hidden)]
+    unsafe fn __null(new: *mut c_void);
+    #[doc(hidden)]
+    unsafe fn __clone(this: *const c_void, new: *mut c_void);
+    #[doc(hidden)]
+    unsafe fn __get(this: *const c_void) -> *const Self;
+    #[doc(hidden)]
+    unsafe fn __drop(this: *mut c_void);
+}
+
+extern "C" {
+    #[link_name = "cxxbridge02$shared_ptr$std$string$null"]
+    fn shared_ptr_std_string_null(new: *mut c_void);
+    #[link_name = "cxxbridge02$shared_ptr$std$string$clone"]
+    fn shared_ptr_std_string_clone(this: *const c_void, new: *mut c_void);
+    #[link_name = "cxxbridge02$shared_ptr$std$string$get"]
+    fn shared_ptr_std_string_get(this: *const c_void) -> *const CxxString;
+    #[link_name = "cxxbridge02$shared_ptr$std$string$drop"]
+    fn shared_ptr_std_string_drop(this: *mut c_void);
+}
+
+unsafe impl SharedPtrTarget for CxxString {
+    unsafe fn __null(new: *mut c_void) {
+        shared_ptr_std_string_null(new);
+    }
+    unsafe fn __clone(this: *const c_void, new: *mut c_void) {
+        shared_ptr_std_string_clone(this, new);
+    }
+    unsafe fn __get(this: *const c_void) -> *const Self {
+        shared_ptr_std_string_get(this)
+    }
+    unsafe fn __drop(this: *mut c_void) {
+        shared_ptr_std_string_drop(this);
+    }
+}
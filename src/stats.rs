@@ -0,0 +1,294 @@
+use crate::rust_str::RustStr;
+use std::ptr;
+use std::time::Duration;
+
+/// Number of calls of one bridge function and the time spent in them.
+///
+/// Returned by [`stats`]. The time of a call is measured on the Rust side of
+/// the bridge around the whole crossing, so for a function implemented in C++
+/// it includes the work done by the C++ function, and for a function
+/// implemented in Rust the work done by the Rust function.
+#[derive(Clone, Debug)]
+pub struct CallStats {
+    /// Path of the function, such as `my_crate::ffi::do_thing`.
+    pub name: &'static str,
+    /// Number of completed calls.
+    pub calls: u64,
+    /// Sum of the durations of those calls.
+    pub total: Duration,
+}
+
+/// Totals of every bridge function called so far, from all threads.
+///
+/// Counting is off unless the `stats` feature of the cxx crate is enabled,
+/// in which case every generated shim in either direction updates counters
+/// of the calling thread without locking or contending with other threads.
+/// Without the feature the shims contain no extra code and this returns an
+/// empty list. The same data is available to C++ from `rust::bridge_stats()`.
+pub fn stats() -> Vec<CallStats> {
+    imp::stats()
+}
+
+pub use self::imp::CallSite;
+
+#[cfg(not(feature = "stats"))]
+mod imp {
+    use super::CallStats;
+
+    // Both are zero-sized with no Drop impl, so the static and the timer that
+    // every shim declares compile to nothing.
+    pub struct CallSite;
+
+    pub struct CallTimer;
+
+    impl CallSite {
+        pub const fn new(_name: &'static str) -> Self {
+            CallSite
+        }
+
+        #[inline(always)]
+        pub fn start(&'static self) -> CallTimer {
+            CallTimer
+        }
+    }
+
+    pub fn stats() -> Vec<CallStats> {
+        Vec::new()
+    }
+}
+
+#[cfg(feature = "stats")]
+mod imp {
+    use super::CallStats;
+    use std::ptr;
+    use std::sync::atomic::{AtomicBool, AtomicPtr, AtomicU64, AtomicUsize, Ordering};
+    use std::time::{Duration, Instant};
+
+    // Every thread that made a call owns a table of counters indexed by the id
+    // of the call site. Only the owner writes to its table, so counting is a
+    // plain load and store; stats() adds up the tables of all threads. Tables
+    // are never freed: a thread that exits hands its table over to the next
+    // new thread, so the totals survive and memory stays bounded by the
+    // largest number of threads alive at once.
+    const CHUNK_LEN: usize = 64;
+    const CHUNKS: usize = 64;
+
+    // Registered call sites and thread tables, as lock-free push-only lists.
+    static SITES: AtomicPtr<CallSite> = AtomicPtr::new(ptr::null_mut());
+    static TABLES: AtomicPtr<Table> = AtomicPtr::new(ptr::null_mut());
+    static NEXT_ID: AtomicUsize = AtomicUsize::new(0);
+
+    const UNREGISTERED: usize = 0;
+    const REGISTERING: usize = usize::max_value();
+
+    pub struct CallSite {
+        name: &'static str,
+        // Index into the tables plus one, or one of the two states above.
+        id: AtomicUsize,
+        next: AtomicPtr<CallSite>,
+    }
+
+    pub struct CallTimer {
+        site: &'static CallSite,
+        start: Instant,
+    }
+
+    struct Table {
+        chunks: Box<[AtomicPtr<Counter>]>,
+        in_use: AtomicBool,
+        next: AtomicPtr<Table>,
+    }
+
+    #[derive(Default)]
+    struct Counter {
+        calls: AtomicU64,
+        nanos: AtomicU64,
+    }
+
+    // Releases the table of the thread when it exits.
+    struct Local(&'static Table);
+
+    thread_local! {
+        static LOCAL: Local = Local(Table::acquire());
+    }
+
+    impl CallSite {
+        pub const fn new(name: &'static str) -> Self {
+            CallSite {
+                name,
+                id: AtomicUsize::new(UNREGISTERED),
+                next: AtomicPtr::new(ptr::null_mut()),
+            }
+        }
+
+        #[inline]
+        pub fn start(&'static self) -> CallTimer {
+            CallTimer {
+                site: self,
+                start: Instant::now(),
+            }
+        }
+
+        fn index(&'static self) -> Option<usize> {
+            match self.id.load(Ordering::Acquire) {
+                UNREGISTERED => self.register(),
+                // Another thread is registering it right now. Dropping one
+                // call beats waiting for it.
+                REGISTERING => None,
+                id => Some(id - 1),
+            }
+        }
+
+        #[cold]
+        fn register(&'static self) -> Option<usize> {
+            let claimed = self.id.compare_exchange(
+                UNREGISTERED,
+                REGISTERING,
+                Ordering::Acquire,
+                Ordering::Acquire,
+            );
+            if claimed.is_err() {
+                return None;
+            }
+            let index = NEXT_ID.fetch_add(1, Ordering::Relaxed);
+            self.id.store(index + 1, Ordering::Release);
+            push(&SITES, self, &self.next);
+            Some(index)
+        }
+    }
+
+    impl Drop for CallTimer {
+        fn drop(&mut self) {
+            let nanos = self.start.elapsed().as_nanos() as u64;
+            let index = match self.site.index() {
+                Some(index) => index,
+                None => return,
+            };
+            // Fails only during thread teardown, when the call is not counted.
+            let _ = LOCAL.try_with(|local| {
+                if let Some(counter) = local.0.counter(index) {
+                    let calls = counter.calls.load(Ordering::Relaxed);
+                    counter.calls.store(calls + 1, Ordering::Relaxed);
+                    let total = counter.nanos.load(Ordering::Relaxed);
+                    counter
+                        .nanos
+                        .store(total.wrapping_add(nanos), Ordering::Relaxed);
+                }
+            });
+        }
+    }
+
+    impl Table {
+        fn acquire() -> &'static Table {
+            let mut table = TABLES.load(Ordering::Acquire);
+            while let Some(existing) = unsafe { table.as_ref() } {
+                let claimed = existing.in_use.compare_exchange(
+                    false,
+                    true,
+                    Ordering::Acquire,
+                    Ordering::Relaxed,
+                );
+                if claimed.is_ok() {
+                    return existing;
+                }
+                table = existing.next.load(Ordering::Acquire);
+            }
+            let table: &'static Table = Box::leak(Box::new(Table {
+                chunks: (0..CHUNKS).map(|_| AtomicPtr::default()).collect(),
+                in_use: AtomicBool::new(true),
+                next: AtomicPtr::new(ptr::null_mut()),
+            }));
+            push(&TABLES, table, &table.next);
+            table
+        }
+
+        // Called by the owning thread only, which is the one allocating chunks.
+        fn counter(&self, index: usize) -> Option<&Counter> {
+            let chunk = self.chunks.get(index / CHUNK_LEN)?;
+            let mut counters = chunk.load(Ordering::Acquire);
+            if counters.is_null() {
+                let new: Box<[Counter]> = (0..CHUNK_LEN).map(|_| Counter::default()).collect();
+                counters = Box::leak(new).as_mut_ptr();
+                chunk.store(counters, Ordering::Release);
+            }
+            Some(unsafe { &*counters.add(index % CHUNK_LEN) })
+        }
+
+        // Called from any thread.
+        fn get(&self, index: usize) -> Option<&Counter> {
+            let chunk = self.chunks.get(index / CHUNK_LEN)?;
+            let counters = chunk.load(Ordering::Acquire);
+            unsafe { counters.as_ref().map(|_| &*counters.add(index % CHUNK_LEN)) }
+        }
+    }
+
+    impl Drop for Local {
+        fn drop(&mut self) {
+            self.0.in_use.store(false, Ordering::Release);
+        }
+    }
+
+    fn push<T>(head: &AtomicPtr<T>, node: &'static T, next: &AtomicPtr<T>) {
+        let node = node as *const T as *mut T;
+        let mut current = head.load(Ordering::Relaxed);
+        loop {
+            next.store(current, Ordering::Relaxed);
+            match head.compare_exchange_weak(current, node, Ordering::Release, Ordering::Relaxed) {
+                Ok(_) => return,
+                Err(actual) => current = actual,
+            }
+        }
+    }
+
+    pub fn stats() -> Vec<CallStats> {
+        let mut stats = Vec::new();
+        let mut site = SITES.load(Ordering::Acquire);
+        while let Some(current) = unsafe { site.as_ref() } {
+            let index = current.id.load(Ordering::Acquire) - 1;
+            let mut calls = 0;
+            let mut nanos = 0u64;
+            let mut table = TABLES.load(Ordering::Acquire);
+            while let Some(existing) = unsafe { table.as_ref() } {
+                if let Some(counter) = existing.get(index) {
+                    calls += counter.calls.load(Ordering::Relaxed);
+                    nanos = nanos.wrapping_add(counter.nanos.load(Ordering::Relaxed));
+                }
+                table = existing.next.load(Ordering::Acquire);
+            }
+            stats.push(CallStats {
+                name: current.name,
+                calls,
+                total: Duration::from_nanos(nanos),
+            });
+            site = current.next.load(Ordering::Acquire);
+        }
+        stats.sort_by_key(|stats| stats.name);
+        stats
+    }
+}
+
+#[repr(C)]
+struct CallStatsRepr {
+    name: RustStr,
+    calls: u64,
+    nanos: u64,
+}
+
+// Fills up to cap entries and returns how many there are in total. C++ grows
+// its buffer and calls again if that is more than cap, so that the allocation,
+// which may throw, happens outside of the call into Rust.
+#[export_name = "cxxbridge02$stats$collect"]
+unsafe extern "C" fn stats_collect(out: *mut CallStatsRepr, cap: usize) -> usize {
+    let stats = stats();
+    if stats.len() <= cap {
+        for (i, entry) in stats.iter().enumerate() {
+            let repr = CallStatsRepr {
+                name: RustStr::from(entry.name),
+                calls: entry.calls,
+                nanos: entry.total.as_nanos() as u64,
+            };
+            ptr::write(out.add(i), repr);
+        }
+    }
+    stats.len()
+}
@@ -0,0 +1,193 @@
+// std::istream and std::ostream across the bridge: Rust reads and writes C++
+// streams through io::Read and io::Write, and C++ gets streams that pull from
+// a Rust reader or push to a Rust writer. Either way the data moves in chunks
+// of the size of the buffer that the caller provides, never a byte at a time.
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+extern "C" {
+// cxx_stream.rs
+bool cxxbridge02$rust_read$read(void *source, char *buf, size_t len,
+                                size_t *n) noexcept;
+bool cxxbridge02$rust_write$write(void *sink, const char *buf,
+                                  size_t len) noexcept;
+bool cxxbridge02$rust_write$flush(void *sink) noexcept;
+} // extern "C"
+
+namespace {
+// Thrown out of rust_read_buf so that the istream sets badbit; returning eof
+// would look like the end of the input. The io::Error itself stays in Rust
+// and is returned from CxxIstream::with_reader.
+struct rust_read_error {};
+
+class rust_read_buf final : public std::streambuf {
+public:
+  rust_read_buf(void *source, char *buf, size_t len) noexcept
+      : source(source), buf(buf), len(len) {}
+
+protected:
+  int_type underflow() override {
+    size_t n = this->fill(this->buf, this->len);
+    if (n == 0) {
+      return traits_type::eof();
+    }
+    this->setg(this->buf, this->buf, this->buf + n);
+    return traits_type::to_int_type(*this->buf);
+  }
+
+  // Whatever is left in the buffer is copied out first. A remainder of at
+  // least a whole buffer is then read from Rust directly into the caller's
+  // memory.
+  std::streamsize xsgetn(char *s, std::streamsize count) override {
+    std::streamsize done = 0;
+    while (done < count) {
+      std::streamsize avail = this->egptr() - this->gptr();
+      if (avail > 0) {
+        std::streamsize chunk = std::min(avail, count - done);
+        std::memcpy(s + done, this->gptr(), static_cast<size_t>(chunk));
+        this->setg(this->eback(), this->gptr() + chunk, this->egptr());
+        done += chunk;
+      } else if (static_cast<size_t>(count - done) >= this->len) {
+        size_t n = this->fill(s + done, static_cast<size_t>(count - done));
+        if (n == 0) {
+          break;
+        }
+        done += static_cast<std::streamsize>(n);
+      } else if (traits_type::eq_int_type(this->underflow(),
+                                          traits_type::eof())) {
+        break;
+      }
+    }
+    return done;
+  }
+
+private:
+  size_t fill(char *dst, size_t cap) {
+    size_t n = 0;
+    if (!cxxbridge02$rust_read$read(this->source, dst, cap, &n)) {
+      throw rust_read_error();
+    }
+    return n;
+  }
+
+  void *source;
+  char *buf;
+  size_t len;
+};
+
+class rust_write_buf final : public std::streambuf {
+public:
+  // pbump takes an int, so at most INT_MAX bytes of the buffer are used.
+  rust_write_buf(void *sink, char *buf, size_t len) noexcept : sink(sink) {
+    this->setp(buf, buf + std::min(len, static_cast<size_t>(INT_MAX)));
+  }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (!this->drain()) {
+      return traits_type::eof();
+    }
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+      return traits_type::not_eof(ch);
+    }
+    char c = traits_type::to_char_type(ch);
+    if (this->pptr() == this->epptr()) {
+      return this->emit(&c, 1) ? ch : traits_type::eof();
+    }
+    *this->pptr() = c;
+    this->pbump(1);
+    return ch;
+  }
+
+  // Writes that do not fit in the rest of the buffer flush it, and those that
+  // would not fit in an empty buffer either go to Rust in one piece.
+  std::streamsize xsputn(const char *s, std::streamsize count) override {
+    if (count > this->epptr() - this->pptr()) {
+      if (!this->drain()) {
+        return 0;
+      }
+      if (count > this->epptr() - this->pptr()) {
+        return this->emit(s, static_cast<size_t>(count)) ? count : 0;
+      }
+    }
+    std::memcpy(this->pptr(), s, static_cast<size_t>(count));
+    this->pbump(static_cast<int>(count));
+    return count;
+  }
+
+  int sync() override {
+    if (!this->drain() || !cxxbridge02$rust_write$flush(this->sink)) {
+      return -1;
+    }
+    return 0;
+  }
+
+private:
+  bool drain() {
+    size_t n = static_cast<size_t>(this->pptr() - this->pbase());
+    if (n == 0) {
+      return true;
+    }
+    this->setp(this->pbase(), this->epptr());
+    return this->emit(this->pbase(), n);
+  }
+
+  bool emit(const char *s, size_t n) {
+    return cxxbridge02$rust_write$write(this->sink, s, n);
+  }
+
+  void *sink;
+};
+} // namespace
+
+extern "C" {
+bool cxxbridge02$istream$read(std::istream &is, char *buf, size_t len,
+                              size_t *n) noexcept {
+  try {
+    is.read(buf, static_cast<std::streamsize>(len));
+  } catch (...) {
+  }
+  *n = static_cast<size_t>(is.gcount());
+  return !is.bad();
+}
+
+bool cxxbridge02$ostream$write(std::ostream &os, const char *buf,
+                               size_t len) noexcept {
+  try {
+    os.write(buf, static_cast<std::streamsize>(len));
+  } catch (...) {
+  }
+  return !os.fail();
+}
+
+bool cxxbridge02$ostream$flush(std::ostream &os) noexcept {
+  try {
+    os.flush();
+  } catch (...) {
+  }
+  return !os.fail();
+}
+
+void cxxbridge02$istream$scope(void *source, char *buf, size_t len,
+                               void (*f)(void *, std::istream &),
+                               void *ctx) noexcept {
+  rust_read_buf sb(source, buf, len);
+  std::istream stream(&sb);
+  f(ctx, stream);
+}
+
+void cxxbridge02$ostream$scope(void *sink, char *buf, size_t len,
+                               void (*f)(void *, std::ostream &),
+                               void *ctx) noexcept {
+  rust_write_buf sb(sink, buf, len);
+  std::ostream stream(&sb);
+  f(ctx, stream);
+  stream.flush();
+}
+} // extern "C"
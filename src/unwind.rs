@@ -1,17 +1,33 @@
 use std::io::{self, Write};
-use std::panic::{self, UnwindSafe};
+use std::panic::{self, AssertUnwindSafe};
 use std::process;
 
+// The process aborts on panic, so nothing can observe state that the panic
+// left broken, and arguments such as `&mut CxxIstream` need not be UnwindSafe.
 pub fn catch_unwind<F, R>(label: &'static str, foreign_call: F) -> R
 where
-    F: FnOnce() -> R + UnwindSafe,
+    F: FnOnce() -> R,
 {
-    match panic::catch_unwind(foreign_call) {
+    match panic::catch_unwind(AssertUnwindSafe(foreign_call)) {
         Ok(ret) => ret,
         Err(_) => abort(label),
     }
 }
 
+// Stands in for catch_unwind in the shims of #[nopanic] functions. Its drop
+// only runs if the call unwinds, so the normal path costs nothing, but a panic
+// still aborts rather than unwinding into C++. The shim forgets the guard once
+// the call has returned.
+pub struct AbortOnUnwind {
+    pub label: &'static str,
+}
+
+impl Drop for AbortOnUnwind {
+    fn drop(&mut self) {
+        abort(self.label);
+    }
+}
+
 #[cold]
 fn abort(label: &'static str) -> ! {
     let mut stdout = io::stdout();
@@ -0,0 +1,367 @@
+// UTF-8 validation for the C++ side of rust::Str and rust::String.
+//
+// The vectorized kernels follow the lookup algorithm of Keiser & Lemire,
+// "Validating UTF-8 In Less Than One Instruction Per Byte" (2021): every
+// byte is classified by table lookups on the high nibble of the previous
+// byte, the low nibble of the previous byte, and the high nibble of the
+// current byte, and the three results are ANDed together so that any bit
+// left set identifies an invalid sequence. Chunks consisting entirely of
+// ASCII skip the lookups. Which kernel to use is decided at runtime based on
+// what the CPU supports.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CXXBRIDGE02_UTF8_X86
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define CXXBRIDGE02_UTF8_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Same acceptance as Rust's core::str::from_utf8: no overlong encodings, no
+// surrogates, nothing above U+10FFFF.
+bool utf8_valid_scalar(const uint8_t *ptr, size_t len) noexcept {
+  size_t i = 0;
+  while (i < len) {
+    if (ptr[i] < 0x80) {
+      // Skip over ASCII a word at a time.
+      while (i + 8 <= len) {
+        uint64_t word;
+        std::memcpy(&word, ptr + i, 8);
+        if (word & UINT64_C(0x8080808080808080)) {
+          break;
+        }
+        i += 8;
+      }
+      while (i < len && ptr[i] < 0x80) {
+        i++;
+      }
+      continue;
+    }
+    uint8_t lead = ptr[i];
+    size_t width;
+    uint8_t lo = 0x80, hi = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      width = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      width = 3;
+      if (lead == 0xE0) {
+        lo = 0xA0;
+      } else if (lead == 0xED) {
+        hi = 0x9F;
+      }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      width = 4;
+      if (lead == 0xF0) {
+        lo = 0x90;
+      } else if (lead == 0xF4) {
+        hi = 0x8F;
+      }
+    } else {
+      return false;
+    }
+    if (len - i < width) {
+      return false;
+    }
+    if (ptr[i + 1] < lo || ptr[i + 1] > hi) {
+      return false;
+    }
+    for (size_t k = 2; k < width; k++) {
+      if ((ptr[i + k] & 0xC0) != 0x80) {
+        return false;
+      }
+    }
+    i += width;
+  }
+  return true;
+}
+
+// Error classes produced by the lookups. A pair of bytes (previous, current)
+// is invalid iff some bit is set in all three of the looked up values.
+const uint8_t TOO_SHORT = 1 << 0;  // 11______ 0_______ or 11______ 11______
+const uint8_t TOO_LONG = 1 << 1;   // 0_______ 10______
+const uint8_t OVERLONG_3 = 1 << 2; // 11100000 100_____
+const uint8_t TOO_LARGE = 1 << 3;  // 11110100 1001____ and above
+const uint8_t SURROGATE = 1 << 4;  // 11101101 101_____
+const uint8_t OVERLONG_2 = 1 << 5; // 1100000_ 10______
+const uint8_t TOO_LARGE_1000 = 1 << 6; // 11110101 1000____ and above
+const uint8_t OVERLONG_4 = 1 << 6;     // 11110000 1000____
+const uint8_t TWO_CONTS = 1 << 7;      // 10______ 10______
+const uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// Indexed by the high nibble of the previous byte.
+const uint8_t BYTE_1_HIGH[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+// Indexed by the low nibble of the previous byte.
+const uint8_t BYTE_1_LOW[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+// Indexed by the high nibble of the current byte.
+const uint8_t BYTE_2_HIGH[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+        OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+// A chunk ending in one of these positions with a lead byte at least this
+// large still needs continuation bytes from the next chunk.
+const uint8_t INCOMPLETE_3 = 0xF0 - 1;
+const uint8_t INCOMPLETE_2 = 0xE0 - 1;
+const uint8_t INCOMPLETE_1 = 0xC0 - 1;
+
+#ifdef CXXBRIDGE02_UTF8_X86
+
+struct Sse {
+  __m128i error;
+  __m128i prev_input;
+  __m128i prev_incomplete;
+};
+
+__attribute__((target("sse4.2"))) inline void sse_check(Sse &st,
+                                                        __m128i input) {
+  if (_mm_movemask_epi8(input) == 0) {
+    st.error = _mm_or_si128(st.error, st.prev_incomplete);
+    st.prev_input = input;
+    return;
+  }
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  __m128i prev1 = _mm_alignr_epi8(input, st.prev_input, 16 - 1);
+  __m128i prev2 = _mm_alignr_epi8(input, st.prev_input, 16 - 2);
+  __m128i prev3 = _mm_alignr_epi8(input, st.prev_input, 16 - 3);
+  __m128i b1h = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(BYTE_1_HIGH)),
+      _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+  __m128i b1l = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(BYTE_1_LOW)),
+      _mm_and_si128(prev1, nibble));
+  __m128i b2h = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(BYTE_2_HIGH)),
+      _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+  __m128i special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+  __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+  __m128i fourth =
+      _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+  __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth),
+                                 _mm_set1_epi8(static_cast<char>(0x80)));
+  st.error = _mm_or_si128(st.error, _mm_xor_si128(must23, special));
+  st.prev_incomplete = _mm_subs_epu8(
+      input, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                           static_cast<char>(INCOMPLETE_3),
+                           static_cast<char>(INCOMPLETE_2),
+                           static_cast<char>(INCOMPLETE_1)));
+  st.prev_input = input;
+}
+
+__attribute__((target("sse4.2"))) bool
+utf8_valid_sse(const uint8_t *ptr, size_t len) noexcept {
+  Sse st;
+  st.error = _mm_setzero_si128();
+  st.prev_input = _mm_setzero_si128();
+  st.prev_incomplete = _mm_setzero_si128();
+
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    sse_check(st, _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + i)));
+  }
+  if (i < len) {
+    uint8_t tail[16] = {0};
+    std::memcpy(tail, ptr + i, len - i);
+    sse_check(st, _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail)));
+  }
+  __m128i error = _mm_or_si128(st.error, st.prev_incomplete);
+  return _mm_testz_si128(error, error);
+}
+
+struct Avx2 {
+  __m256i error;
+  __m256i prev_input;
+  __m256i prev_incomplete;
+};
+
+__attribute__((target("avx2"))) inline void avx2_check(Avx2 &st,
+                                                       __m256i input) {
+  if (_mm256_movemask_epi8(input) == 0) {
+    st.error = _mm256_or_si256(st.error, st.prev_incomplete);
+    st.prev_input = input;
+    return;
+  }
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  // Upper half of prev_input followed by lower half of input, so that alignr
+  // can reach back across the split between the two 128-bit lanes.
+  __m256i carried = _mm256_permute2x128_si256(st.prev_input, input, 0x21);
+  __m256i prev1 = _mm256_alignr_epi8(input, carried, 16 - 1);
+  __m256i prev2 = _mm256_alignr_epi8(input, carried, 16 - 2);
+  __m256i prev3 = _mm256_alignr_epi8(input, carried, 16 - 3);
+  __m256i b1h = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(BYTE_1_HIGH))),
+      _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+  __m256i b1l = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(BYTE_1_LOW))),
+      _mm256_and_si256(prev1, nibble));
+  __m256i b2h = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(BYTE_2_HIGH))),
+      _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+  __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+  __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i fourth = _mm256_subs_epu8(
+      prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+  __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                    _mm256_set1_epi8(static_cast<char>(0x80)));
+  st.error = _mm256_or_si256(st.error, _mm256_xor_si256(must23, special));
+  st.prev_incomplete = _mm256_subs_epu8(
+      input,
+      _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                       -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                       -1, static_cast<char>(INCOMPLETE_3),
+                       static_cast<char>(INCOMPLETE_2),
+                       static_cast<char>(INCOMPLETE_1)));
+  st.prev_input = input;
+}
+
+__attribute__((target("avx2"))) bool
+utf8_valid_avx2(const uint8_t *ptr, size_t len) noexcept {
+  Avx2 st;
+  st.error = _mm256_setzero_si256();
+  st.prev_input = _mm256_setzero_si256();
+  st.prev_incomplete = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    avx2_check(st,
+               _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + i)));
+  }
+  if (i < len) {
+    uint8_t tail[32] = {0};
+    std::memcpy(tail, ptr + i, len - i);
+    avx2_check(st,
+               _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail)));
+  }
+  __m256i error = _mm256_or_si256(st.error, st.prev_incomplete);
+  return _mm256_testz_si256(error, error);
+}
+
+#endif // CXXBRIDGE02_UTF8_X86
+
+#ifdef CXXBRIDGE02_UTF8_NEON
+
+struct Neon {
+  uint8x16_t error;
+  uint8x16_t prev_input;
+  uint8x16_t prev_incomplete;
+};
+
+inline void neon_check(Neon &st, uint8x16_t input) {
+  if (vmaxvq_u8(input) < 0x80) {
+    st.error = vorrq_u8(st.error, st.prev_incomplete);
+    st.prev_input = input;
+    return;
+  }
+  const uint8_t incomplete[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                  0xFF, INCOMPLETE_3, INCOMPLETE_2,
+                                  INCOMPLETE_1};
+  uint8x16_t prev1 = vextq_u8(st.prev_input, input, 16 - 1);
+  uint8x16_t prev2 = vextq_u8(st.prev_input, input, 16 - 2);
+  uint8x16_t prev3 = vextq_u8(st.prev_input, input, 16 - 3);
+  uint8x16_t b1h = vqtbl1q_u8(vld1q_u8(BYTE_1_HIGH), vshrq_n_u8(prev1, 4));
+  uint8x16_t b1l =
+      vqtbl1q_u8(vld1q_u8(BYTE_1_LOW), vandq_u8(prev1, vdupq_n_u8(0x0F)));
+  uint8x16_t b2h = vqtbl1q_u8(vld1q_u8(BYTE_2_HIGH), vshrq_n_u8(input, 4));
+  uint8x16_t special = vandq_u8(vandq_u8(b1h, b1l), b2h);
+  uint8x16_t third = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+  uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+  uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+  st.error = vorrq_u8(st.error, veorq_u8(must23, special));
+  st.prev_incomplete = vqsubq_u8(input, vld1q_u8(incomplete));
+  st.prev_input = input;
+}
+
+bool utf8_valid_neon(const uint8_t *ptr, size_t len) noexcept {
+  Neon st;
+  st.error = vdupq_n_u8(0);
+  st.prev_input = vdupq_n_u8(0);
+  st.prev_incomplete = vdupq_n_u8(0);
+
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    neon_check(st, vld1q_u8(ptr + i));
+  }
+  if (i < len) {
+    uint8_t tail[16] = {0};
+    std::memcpy(tail, ptr + i, len - i);
+    neon_check(st, vld1q_u8(tail));
+  }
+  uint8x16_t error = vorrq_u8(st.error, st.prev_incomplete);
+  return vmaxvq_u8(error) == 0;
+}
+
+#endif // CXXBRIDGE02_UTF8_NEON
+
+using Validator = bool (*)(const uint8_t *, size_t) noexcept;
+
+Validator select_validator() noexcept {
+#if defined(CXXBRIDGE02_UTF8_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return utf8_valid_avx2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return utf8_valid_sse;
+  }
+#elif defined(CXXBRIDGE02_UTF8_NEON)
+  return utf8_valid_neon;
+#endif
+  return utf8_valid_scalar;
+}
+
+} // namespace
+
+extern "C" {
+bool cxxbridge02$utf8$valid(const char *ptr, size_t len) noexcept {
+  auto bytes = reinterpret_cast<const uint8_t *>(ptr);
+  // Strings this short are cheaper to check directly than to set up vectors
+  // for.
+  if (len < 32) {
+    return utf8_valid_scalar(bytes, len);
+  }
+  static const Validator validator = select_validator();
+  return validator(bytes, len);
+}
+} // extern "C"
@@ -0,0 +1,137 @@
+use crate::cxx_string::CxxString;
+use crate::shared_ptr::{SharedPtr, SharedPtrTarget};
+use std::ffi::c_void;
+use std::fmt::{self, Debug};
+use std::marker::PhantomData;
+use std::mem::MaybeUninit;
+
+/// Binding to C++ `std::weak_ptr<T>`.
+///
+/// Made by [`SharedPtr::downgrade`] or received from C++. It does not keep the
+/// object alive; [`upgrade`](WeakPtr::upgrade) returns a null SharedPtr once
+/// the last SharedPtr or C++ shared\_ptr to the object is gone.
+#[repr(C)]
+pub struct WeakPtr<T>
+where
+    T: WeakPtrTarget,
+{
+    repr: [*mut c_void; 2],
+    ty: PhantomData<T>,
+}
+
+impl<T> WeakPtr<T>
+where
+    T: WeakPtrTarget,
+{
+    /// Makes a new WeakPtr wrapping a null pointer.
+    ///
+    /// Matches the behavior of default-constructing a std::weak\_ptr.
+    pub fn null() -> Self {
+        let mut weak = MaybeUninit::<Self>::uninit();
+        unsafe {
+            T::__null(weak.as_mut_ptr() as *mut c_void);
+            weak.assume_init()
+        }
+    }
+
+    /// Makes a SharedPtr to the object if it still exists, otherwise a null
+    /// SharedPtr.
+    ///
+    /// Matches the behavior of [std::weak\_ptr\<T\>::lock](https://en.cppreference.com/w/cpp/memory/weak_ptr/lock).
+    pub fn upgrade(&self) -> SharedPtr<T>
+    where
+        T: SharedPtrTarget,
+    {
+        let mut shared = MaybeUninit::<SharedPtr<T>>::uninit();
+        unsafe {
+            T::__upgrade(
+                self as *const Self as *const c_void,
+                shared.as_mut_ptr() as *mut c_void,
+            );
+            shared.assume_init()
+        }
+    }
+}
+
+unsafe impl<T> Send for WeakPtr<T> where T: Send + Sync + WeakPtrTarget {}
+unsafe impl<T> Sync for WeakPtr<T> where T: Send + Sync + WeakPtrTarget {}
+
+impl<T> Clone for WeakPtr<T>
+where
+    T: WeakPtrTarget,
+{
+    fn clone(&self) -> Self {
+        let mut weak = MaybeUninit::<Self>::uninit();
+        unsafe {
+            T::__clone(
+                self as *const Self as *const c_void,
+                weak.as_mut_ptr() as *mut c_void,
+            );
+            weak.assume_init()
+        }
+    }
+}
+
+impl<T> Drop for WeakPtr<T>
+where
+    T: WeakPtrTarget,
+{
+    fn drop(&mut self) {
+        unsafe { T::__drop(self as *mut Self as *mut c_void) }
+    }
+}
+
+impl<T> Debug for WeakPtr<T>
+where
+    T: WeakPtrTarget,
+{
+    fn fmt(&self, formatter: &mut fmt::Formatter) -> fmt::Result {
+        formatter.write_str("(WeakPtr)")
+    }
+}
+
+// Methods are private; not intended to be implemented outside of cxxbridge
+// codebase.
+pub unsafe trait WeakPtrTarget {
+    #[doc(hidden)]
+    unsafe fn __null(new: *mut c_void);
+    #[doc(hidden)]
+    unsafe fn __clone(this: *const c_void, new: *mut c_void);
+    #[doc(hidden)]
+    unsafe fn __downgrade(shared: *const c_void, new: *mut c_void);
+    #[doc(hidden)]
+    unsafe fn __upgrade(weak: *const c_void, shared: *mut c_void);
+    #[doc(hidden)]
+    unsafe fn __drop(this: *mut c_void);
+}
+
+extern "C" {
+    #[link_name = "cxxbridge02$weak_ptr$std$string$null"]
+    fn weak_ptr_std_string_null(new: *mut c_void);
+    #[link_name = "cxxbridge02$weak_ptr$std$string$clone"]
+    fn weak_ptr_std_string_clone(this: *const c_void, new: *mut c_void);
+    #[link_name = "cxxbridge02$weak_ptr$std$string$downgrade"]
+    fn weak_ptr_std_string_downgrade(shared: *const c_void, new: *mut c_void);
+    #[link_name = "cxxbridge02$weak_ptr$std$string$upgrade"]
+    fn weak_ptr_std_string_upgrade(weak: *const c_void, shared: *mut c_void);
+    #[link_name = "cxxbridge02$weak_ptr$std$string$drop"]
+    fn weak_ptr_std_string_drop(this: *mut c_void);
+}
+
+unsafe impl WeakPtrTarget for CxxString {
+    unsafe fn __null(new: *mut c_void) {
+        weak_ptr_std_string_null(new);
+    }
+    unsafe fn __clone(this: *const c_void, new: *mut c_void) {
+        weak_ptr_std_string_clone(this, new);
+    }
+    unsafe fn __downgrade(shared: *const c_void, new: *mut c_void) {
+        weak_ptr_std_string_downgrade(shared, new);
+    }
+    unsafe fn __upgrade(weak: *const c_void, shared: *mut c_void) {
+        weak_ptr_std_string_upgrade(weak, shared);
+    }
+    unsafe fn __drop(this: *mut c_void) {
+        weak_ptr_std_string_drop(this);
+    }
+}
@@ -17,7 +17,10 @@ pub enum Atom {
     F32,
     F64,
     CxxString,
+    CxxIstream,
+    CxxOstream,
     RustString,
+    Arena,
 }
 
 impl Atom {
@@ -38,7 +41,10 @@ impl Atom {
             "f32" => Some(F32),
             "f64" => Some(F64),
             "CxxString" => Some(CxxString),
+            "CxxIstream" => Some(CxxIstream),
+            "CxxOstream" => Some(CxxOstream),
             "String" => Some(RustString),
+            "Arena" => Some(Arena),
             _ => None,
         }
     }
@@ -1,30 +1,61 @@
-use crate::syntax::{Derive, Doc};
+use crate::syntax::{Derive, Doc, Layout};
 use proc_macro2::Ident;
-use syn::parse::{ParseStream, Parser};
-use syn::{Attribute, Error, LitStr, Path, Result, Token};
+use syn::parse::{ParseStream, Parser as _};
+use syn::{Attribute, Error, LitInt, LitStr, Path, Result, Token};
 
-pub(super) fn parse_doc(attrs: &[Attribute]) -> Result<Doc> {
-    let mut doc = Doc::new();
-    let derives = None;
-    parse(attrs, &mut doc, derives)?;
-    Ok(doc)
+// Attributes that are accepted in a given position. Any attribute whose field
+// is None is rejected as unsupported.
+#[derive(Default)]
+pub(super) struct Parser<'a> {
+    pub doc: Option<&'a mut Doc>,
+    pub derives: Option<&'a mut Vec<Ident>>,
+    pub nopanic: Option<&'a mut bool>,
+    pub batch: Option<&'a mut bool>,
+    pub thread_safe: Option<&'a mut Option<Ident>>,
+    pub layout: Option<&'a mut Option<Layout>>,
 }
 
-pub(super) fn parse(
-    attrs: &[Attribute],
-    doc: &mut Doc,
-    mut derives: Option<&mut Vec<Ident>>,
-) -> Result<()> {
+pub(super) fn parse(attrs: &[Attribute], mut parser: Parser) -> Result<()> {
     for attr in attrs {
         if attr.path.is_ident("doc") {
-            let lit = parse_doc_attribute.parse2(attr.tokens.clone())?;
-            doc.push(lit);
-            continue;
+            if let Some(doc) = &mut parser.doc {
+                let lit = parse_doc_attribute.parse2(attr.tokens.clone())?;
+                doc.push(lit);
+                continue;
+            }
         } else if attr.path.is_ident("derive") {
-            if let Some(derives) = &mut derives {
+            if let Some(derives) = &mut parser.derives {
                 derives.extend(attr.parse_args_with(parse_derive_attribute)?);
                 continue;
             }
+        } else if attr.path.is_ident("nopanic") {
+            if let Some(nopanic) = &mut parser.nopanic {
+                parse_flag_attribute.parse2(attr.tokens.clone())?;
+                **nopanic = true;
+                continue;
+            }
+        } else if attr.path.is_ident("batch") {
+            if let Some(batch) = &mut parser.batch {
+                parse_flag_attribute.parse2(attr.tokens.clone())?;
+                **batch = true;
+                continue;
+            }
+        } else if attr.path.is_ident("thread_safe") {
+            if let Some(thread_safe) = &mut parser.thread_safe {
+                parse_flag_attribute.parse2(attr.tokens.clone())?;
+                **thread_safe = attr.path.get_ident().cloned();
+                continue;
+            }
+        } else if attr.path.is_ident("layout") {
+            if let Some(layout) = &mut parser.layout {
+                let (size, align) = attr.parse_args_with(parse_layout_attribute)?;
+                **layout = Some(Layout {
+                    attr: attr.path.get_ident().unwrap().clone(),
+                    size,
+                    align,
+                });
+                continue;
+            }
         }
         return Err(Error::new_spanned(attr, "unsupported attribute"));
     }
@@ -37,6 +68,43 @@ fn parse_doc_attribute(input: ParseStream) -> Result<LitStr> {
     Ok(lit)
 }
 
+fn parse_flag_attribute(input: ParseStream) -> Result<()> {
+    if input.is_empty() {
+        Ok(())
+    } else {
+        Err(input.error("unexpected tokens in attribute"))
+    }
+}
+
+// size = N, align = N
+fn parse_layout_attribute(input: ParseStream) -> Result<(usize, usize)> {
+    let mut size = None;
+    let mut align = None;
+    while !input.is_empty() {
+        let key: Ident = input.parse()?;
+        input.parse::<Token![=]>()?;
+        let lit: LitInt = input.parse()?;
+        let slot = if key == "size" {
+            &mut size
+        } else if key == "align" {
+            &mut align
+        } else {
+            return Err(Error::new_spanned(key, "expected `size` or `align`"));
+        };
+        if slot.is_some() {
+            return Err(Error::new_spanned(key, "duplicate layout argument"));
+        }
+        *slot = Some(lit.base10_parse()?);
+        if !input.is_empty() {
+            input.parse::<Token![,]>()?;
+        }
+    }
+    match (size, align) {
+        (Some(size), Some(align)) => Ok((size, align)),
+        _ => Err(input.error("expected `size = N, align = N`")),
+    }
+}
+
 fn parse_derive_attribute(input: ParseStream) -> Result<Vec<Ident>> {
     input
         .parse_terminated::<Path, Token![,]>(Path::parse_mod_style)?
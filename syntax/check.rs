@@ -1,5 +1,7 @@
 use crate::syntax::atom::Atom::{self, *};
-use crate::syntax::{error, ident, Api, ExternFn, Lang, Ref, Struct, Ty1, Type, Types};
+use crate::syntax::{
+    error, ident, Api, ExternFn, ExternType, Lang, Ref, Signature, Struct, Ty1, Type, Types,
+};
 use proc_macro2::{Delimiter, Group, Ident, TokenStream};
 use quote::{quote, ToTokens};
 use std::fmt::Display;
@@ -27,8 +29,13 @@ fn do_typecheck(cx: &mut Check) {
         match ty {
             Type::Ident(ident) => check_type_ident(cx, ident),
             Type::RustBox(ptr) => check_type_box(cx, ptr),
+            Type::RustVec(ty) => check_type_rust_vec(cx, ty),
             Type::UniquePtr(ptr) => check_type_unique_ptr(cx, ptr),
+            Type::SharedPtr(ptr) => check_type_shared_ptr(cx, ptr),
+            Type::WeakPtr(ptr) => check_type_weak_ptr(cx, ptr),
+            Type::CxxVector(ty) => check_type_cxx_vector(cx, ty),
             Type::Ref(ty) => check_type_ref(cx, ty),
+            Type::SliceRef(ty) => check_type_slice_ref(cx, ty),
             _ => {}
         }
     }
@@ -36,11 +43,21 @@ fn do_typecheck(cx: &mut Check) {
     for api in cx.apis {
         match api {
             Api::Struct(strct) => check_api_struct(cx, strct),
+            Api::CxxType(ety) => check_api_cxx_type(cx, ety),
+            Api::RustType(ety) => check_api_rust_type(cx, ety),
             Api::CxxFunction(efn) | Api::RustFunction(efn) => check_api_fn(cx, efn),
             _ => {}
         }
     }
 
+    for api in cx.apis {
+        if let Api::CxxFunction(efn) | Api::RustFunction(efn) = api {
+            if efn.asyncness.is_some() {
+                check_api_async_fn(cx, efn);
+            }
+        }
+    }
+
     for api in cx.apis {
         if let Api::CxxFunction(efn) = api {
             check_mut_return_restriction(cx, efn);
@@ -83,6 +100,23 @@ fn check_type_box(cx: &mut Check, ptr: &Ty1) {
     cx.error(ptr, "unsupported target type of Box");
 }
 
+fn check_type_rust_vec(cx: &mut Check, ty: &Ty1) {
+    if let Type::Ident(ident) = &ty.inner {
+        match Atom::from(ident) {
+            None => {
+                if cx.types.structs.contains_key(ident) {
+                    return;
+                }
+            }
+            Some(CxxString) | Some(CxxIstream) | Some(CxxOstream) | Some(RustString)
+            | Some(Arena) => {}
+            Some(_) => return,
+        }
+    }
+
+    cx.error(ty, "unsupported element type of Vec");
+}
+
 fn check_type_unique_ptr(cx: &mut Check, ptr: &Ty1) {
     if let Type::Ident(ident) = &ptr.inner {
         if cx.types.rust.contains(ident) {
@@ -93,11 +127,61 @@ fn check_type_unique_ptr(cx: &mut Check, ptr: &Ty1) {
             None | Some(CxxString) => return,
             _ => {}
         }
+    } else if let Type::CxxVector(_) = &ptr.inner {
+        return;
     }
 
     cx.error(ptr, "unsupported unique_ptr target type");
 }
 
+fn check_type_shared_ptr(cx: &mut Check, ptr: &Ty1) {
+    if let Type::Ident(ident) = &ptr.inner {
+        if cx.types.rust.contains(ident) {
+            cx.error(ptr, "shared_ptr of a Rust type is not supported yet");
+        }
+
+        match Atom::from(ident) {
+            None | Some(CxxString) => return,
+            _ => {}
+        }
+    }
+
+    cx.error(ptr, "unsupported shared_ptr target type");
+}
+
+fn check_type_weak_ptr(cx: &mut Check, ptr: &Ty1) {
+    if let Type::Ident(ident) = &ptr.inner {
+        if cx.types.rust.contains(ident) {
+            cx.error(ptr, "weak_ptr of a Rust type is not supported yet");
+        }
+
+        match Atom::from(ident) {
+            None | Some(CxxString) => return,
+            _ => {}
+        }
+    }
+
+    cx.error(ptr, "unsupported weak_ptr target type");
+}
+
+fn check_type_cxx_vector(cx: &mut Check, ty: &Ty1) {
+    if let Type::Ident(ident) = &ty.inner {
+        match Atom::from(ident) {
+            None => {
+                if cx.types.structs.contains_key(ident) {
+                    return;
+                }
+            }
+            // std::vector<bool> is bit-packed, so there is no slice to expose.
+            Some(Bool) | Some(CxxString) | Some(CxxIstream) | Some(CxxOstream)
+            | Some(RustString) | Some(Arena) => {}
+            Some(_) => return,
+        }
+    }
+
+    cx.error(ty, "unsupported element type of CxxVector");
+}
+
 fn check_type_ref(cx: &mut Check, ty: &Ref) {
     match ty.inner {
         Type::Fn(_) | Type::Void(_) => {}
@@ -107,6 +191,25 @@ fn check_type_ref(cx: &mut Check, ty: &Ref) {
     cx.error(ty, "unsupported reference type");
 }
 
+fn check_type_slice_ref(cx: &mut Check, ty: &Ref) {
+    if let Type::Slice(slice) = &ty.inner {
+        if let Type::Ident(ident) = &slice.inner {
+            match Atom::from(ident) {
+                None => {
+                    if cx.types.structs.contains_key(ident) {
+                        return;
+                    }
+                }
+                Some(CxxString) | Some(CxxIstream) | Some(CxxOstream) | Some(RustString)
+                | Some(Arena) => {}
+                Some(_) => return,
+            }
+        }
+    }
+
+    cx.error(ty, "unsupported element type of slice");
+}
+
 fn check_api_struct(cx: &mut Check, strct: &Struct) {
     if strct.fields.is_empty() {
         let span = span_for_struct_error(strct);
@@ -128,6 +231,28 @@ fn check_api_struct(cx: &mut Check, strct: &Struct) {
     }
 }
 
+fn check_api_cxx_type(cx: &mut Check, ety: &ExternType) {
+    if let Some(layout) = &ety.layout {
+        let msg = "#[layout] is only supported on Rust types";
+        cx.error(&layout.attr, msg);
+    }
+}
+
+fn check_api_rust_type(cx: &mut Check, ety: &ExternType) {
+    if let Some(thread_safe) = &ety.thread_safe {
+        let msg = "#[thread_safe] is only supported on C++ types";
+        cx.error(thread_safe, msg);
+    }
+    if let Some(layout) = &ety.layout {
+        if !layout.align.is_power_of_two() {
+            cx.error(&layout.attr, "layout alignment must be a power of two");
+        } else if layout.size == 0 || layout.size % layout.align != 0 {
+            let msg = "layout size must be a nonzero multiple of the alignment";
+            cx.error(&layout.attr, msg);
+        }
+    }
+}
+
 fn check_api_fn(cx: &mut Check, efn: &ExternFn) {
     for arg in &efn.args {
         if is_unsized(cx, &arg.ty) {
@@ -135,12 +260,9 @@ fn check_api_fn(cx: &mut Check, efn: &ExternFn) {
             let msg = format!("passing {} by value is not supported", desc);
             cx.error(arg, msg);
         }
-        if let Type::Fn(_) = arg.ty {
+        if let Type::Fn(f) = &arg.ty {
             if efn.lang == Lang::Rust {
-                cx.error(
-                    arg,
-                    "passing a function pointer from C++ to Rust is not implemented yet",
-                );
+                check_callable_to_rust(cx, f);
             }
         }
     }
@@ -157,14 +279,98 @@ fn check_api_fn(cx: &mut Check, efn: &ExternFn) {
     }
 }
 
+// A C++ callable passed to Rust is called through a thunk that forwards its
+// arguments and return value as they are, so only types whose C++ and Rust
+// representations agree can cross it.
+fn check_callable_to_rust(cx: &mut Check, f: &Signature) {
+    if f.throws {
+        cx.error(
+            f,
+            "passing a fallible function from C++ to Rust is not supported yet",
+        );
+    }
+    for arg in &f.args {
+        let plain = match &arg.ty {
+            Type::Ref(ty) => match &ty.inner {
+                Type::Ident(ident) => ident != RustString,
+                Type::RustVec(_) | Type::Fn(_) => false,
+                _ => true,
+            },
+            ty => is_plain_value(cx, ty),
+        };
+        if !plain {
+            let desc = describe(cx, &arg.ty);
+            let msg = format!("function passed to Rust cannot take {} argument", desc);
+            cx.error(arg, msg);
+        }
+    }
+    if let Some(ty) = &f.ret {
+        if !is_plain_value(cx, ty) {
+            let desc = describe(cx, ty);
+            let msg = format!("function passed to Rust cannot return {}", desc);
+            cx.error(ty, msg);
+        }
+    }
+}
+
+fn is_plain_value(cx: &mut Check, ty: &Type) -> bool {
+    match ty {
+        Type::Ident(ident) => match cx.types.structs.get(ident) {
+            Some(strct) => cx.types.is_pod(strct),
+            None => match Atom::from(ident) {
+                Some(CxxString) | Some(CxxIstream) | Some(CxxOstream) | Some(RustString)
+                | Some(Arena) => false,
+                Some(_) => true,
+                None => false,
+            },
+        },
+        _ => false,
+    }
+}
+
+// Either side of an async function keeps running after the call returns, so
+// its arguments must be owned and its result has to fit in a rust::Promise.
+fn check_api_async_fn(cx: &mut Check, efn: &ExternFn) {
+    if efn.receiver.is_some() {
+        cx.error(efn, "async method is not supported yet");
+    }
+    if efn.throws {
+        cx.error(efn, "async function returning Result is not supported yet");
+    }
+
+    for arg in &efn.args {
+        match &arg.ty {
+            Type::Ref(_) | Type::Str(_) | Type::SliceRef(_) | Type::Fn(_) => {
+                let desc = describe(cx, &arg.ty);
+                let msg = format!("async function cannot take {} argument", desc);
+                cx.error(arg, msg);
+            }
+            _ => {}
+        }
+    }
+
+    if let Some(ty) = &efn.ret {
+        if let Type::Ident(ident) = ty {
+            if cx.types.structs.contains_key(ident) {
+                return;
+            }
+            match Atom::from(ident) {
+                None | Some(CxxString) | Some(CxxIstream) | Some(CxxOstream) | Some(Arena) => {}
+                Some(_) => return,
+            }
+        }
+        cx.error(ty, "unsupported return type of async function");
+    }
+}
+
 fn check_mut_return_restriction(cx: &mut Check, efn: &ExternFn) {
     match &efn.ret {
-        Some(Type::Ref(ty)) if ty.mutability.is_some() => {}
+        Some(Type::Ref(ty)) | Some(Type::SliceRef(ty)) if ty.mutability.is_some() => {}
         _ => return,
     }
 
     for arg in &efn.args {
-        if let Type::Ref(ty) = &arg.ty {
+        if let Type::Ref(ty) | Type::SliceRef(ty) = &arg.ty {
             if ty.mutability.is_some() {
                 return;
             }
@@ -179,13 +385,13 @@ fn check_mut_return_restriction(cx: &mut Check, efn: &ExternFn) {
 
 fn check_multiple_arg_lifetimes(cx: &mut Check, efn: &ExternFn) {
     match &efn.ret {
-        Some(Type::Ref(_)) => {}
+        Some(Type::Ref(_)) | Some(Type::SliceRef(_)) => {}
         _ => return,
     }
 
     let mut reference_args = 0;
     for arg in &efn.args {
-        if let Type::Ref(_) = &arg.ty {
+        if let Type::Ref(_) | Type::SliceRef(_) = &arg.ty {
             reference_args += 1;
         }
     }
@@ -201,10 +407,15 @@ fn check_multiple_arg_lifetimes(cx: &mut Check, efn: &ExternFn) {
 fn is_unsized(cx: &mut Check, ty: &Type) -> bool {
     let ident = match ty {
         Type::Ident(ident) => ident,
-        Type::Void(_) => return true,
+        Type::CxxVector(_) | Type::Void(_) | Type::Slice(_) => return true,
         _ => return false,
     };
-    ident == CxxString || cx.types.cxx.contains(ident) || cx.types.rust.contains(ident)
+    ident == CxxString
+        || ident == CxxIstream
+        || ident == CxxOstream
+        || ident == Arena
+        || cx.types.cxx.contains(ident)
+        || cx.types.rust.contains(ident)
 }
 
 fn span_for_struct_error(strct: &Struct) -> TokenStream {
@@ -237,14 +448,24 @@ fn describe(cx: &mut Check, ty: &Type) -> String {
                 "opaque Rust type".to_owned()
             } else if Atom::from(ident) == Some(CxxString) {
                 "C++ string".to_owned()
+            } else if ident == CxxIstream || ident == CxxOstream {
+                "C++ stream".to_owned()
+            } else if Atom::from(ident) == Some(Arena) {
+                "arena".to_owned()
             } else {
                 ident.to_string()
             }
         }
         Type::RustBox(_) => "Box".to_owned(),
+        Type::RustVec(_) => "Vec".to_owned(),
         Type::UniquePtr(_) => "unique_ptr".to_owned(),
+        Type::SharedPtr(_) => "shared_ptr".to_owned(),
+        Type::WeakPtr(_) => "weak_ptr".to_owned(),
+        Type::CxxVector(_) => "C++ vector".to_owned(),
         Type::Ref(_) => "reference".to_owned(),
         Type::Str(_) => "&str".to_owned(),
+        Type::Slice(_) => "slice".to_owned(),
+        Type::SliceRef(_) => "&[T]".to_owned(),
         Type::Fn(_) => "function pointer".to_owned(),
         Type::Void(_) => "()".to_owned(),
     }
@@ -1,4 +1,4 @@
-use crate::syntax::{ExternFn, Receiver, Ref, Signature, Ty1, Type};
+use crate::syntax::{ExternFn, Receiver, Ref, Signature, Slice, Ty1, Type};
 use std::hash::{Hash, Hasher};
 use std::mem;
 use std::ops::Deref;
@@ -17,9 +17,15 @@ impl Hash for Type {
         match self {
             Type::Ident(t) => t.hash(state),
             Type::RustBox(t) => t.hash(state),
+            Type::RustVec(t) => t.hash(state),
             Type::UniquePtr(t) => t.hash(state),
+            Type::SharedPtr(t) => t.hash(state),
+            Type::WeakPtr(t) => t.hash(state),
+            Type::CxxVector(t) => t.hash(state),
             Type::Ref(t) => t.hash(state),
             Type::Str(t) => t.hash(state),
+            Type::Slice(t) => t.hash(state),
+            Type::SliceRef(t) => t.hash(state),
             Type::Fn(t) => t.hash(state),
             Type::Void(_) => {}
         }
@@ -33,9 +39,15 @@ impl PartialEq for Type {
         match (self, other) {
             (Type::Ident(lhs), Type::Ident(rhs)) => lhs == rhs,
             (Type::RustBox(lhs), Type::RustBox(rhs)) => lhs == rhs,
+            (Type::RustVec(lhs), Type::RustVec(rhs)) => lhs == rhs,
             (Type::UniquePtr(lhs), Type::UniquePtr(rhs)) => lhs == rhs,
+            (Type::SharedPtr(lhs), Type::SharedPtr(rhs)) => lhs == rhs,
+            (Type::WeakPtr(lhs), Type::WeakPtr(rhs)) => lhs == rhs,
+            (Type::CxxVector(lhs), Type::CxxVector(rhs)) => lhs == rhs,
             (Type::Ref(lhs), Type::Ref(rhs)) => lhs == rhs,
             (Type::Str(lhs), Type::Str(rhs)) => lhs == rhs,
+            (Type::Slice(lhs), Type::Slice(rhs)) => lhs == rhs,
+            (Type::SliceRef(lhs), Type::SliceRef(rhs)) => lhs == rhs,
             (Type::Fn(lhs), Type::Fn(rhs)) => lhs == rhs,
             (Type::Void(_), Type::Void(_)) => true,
             (_, _) => false,
@@ -106,11 +118,32 @@ impl Hash for Ref {
     }
 }
 
+impl Eq for Slice {}
+
+impl PartialEq for Slice {
+    fn eq(&self, other: &Slice) -> bool {
+        let Slice { bracket: _, inner } = self;
+        let Slice {
+            bracket: _,
+            inner: inner2,
+        } = other;
+        inner == inner2
+    }
+}
+
+impl Hash for Slice {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        let Slice { bracket: _, inner } = self;
+        inner.hash(state);
+    }
+}
+
 impl Eq for Signature {}
 
 impl PartialEq for Signature {
     fn eq(&self, other: &Signature) -> bool {
         let Signature {
+            asyncness,
             fn_token: _,
             receiver,
             args,
@@ -119,6 +152,7 @@ impl PartialEq for Signature {
             tokens: _,
         } = self;
         let Signature {
+            asyncness: asyncness2,
             fn_token: _,
             receiver: receiver2,
             args: args2,
@@ -126,13 +160,18 @@ impl PartialEq for Signature {
             throws: throws2,
             tokens: _,
         } = other;
-        receiver == receiver2 && args == args2 && ret == ret2 && throws == throws2
+        asyncness.is_some() == asyncness2.is_some()
+            && receiver == receiver2
+            && args == args2
+            && ret == ret2
+            && throws == throws2
     }
 }
 
 impl Hash for Signature {
     fn hash<H: Hasher>(&self, state: &mut H) {
         let Signature {
+            asyncness,
             fn_token: _,
             receiver,
             args,
@@ -140,6 +179,7 @@ impl Hash for Signature {
             throws,
             tokens: _,
         } = self;
+        asyncness.is_some().hash(state);
         receiver.hash(state);
         args.hash(state);
         ret.hash(state);
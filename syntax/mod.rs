@@ -13,7 +13,10 @@ mod tokens;
 pub mod types;
 
 use proc_macro2::{Ident, Span, TokenStream};
-use syn::{token::Brace, LitStr, Token};
+use syn::{
+    token::{Brace, Bracket},
+    LitStr, Token,
+};
 
 pub use self::atom::Atom;
 pub use self::doc::Doc;
@@ -31,10 +34,22 @@ pub enum Api {
 
 pub struct ExternType {
     pub doc: Doc,
+    // Set by #[thread_safe], to the ident of the attribute for error spans.
+    pub thread_safe: Option<Ident>,
+    // Set by #[layout(size = N, align = N)] on a Rust type that C++ may hold
+    // by value.
+    pub layout: Option<Layout>,
     pub type_token: Token![type],
     pub ident: Ident,
 }
 
+pub struct Layout {
+    // The ident of the attribute, for error spans.
+    pub attr: Ident,
+    pub size: usize,
+    pub align: usize,
+}
+
 pub struct Struct {
     pub doc: Doc,
     pub derives: Vec<Ident>,
@@ -47,12 +62,17 @@ pub struct Struct {
 pub struct ExternFn {
     pub lang: Lang,
     pub doc: Doc,
+    pub nopanic: bool,
+    // Set on the generated `_batch` counterpart of a #[batch] function, to the
+    // function that it calls for each item.
+    pub batch: Option<Ident>,
     pub ident: Ident,
     pub sig: Signature,
     pub semi_token: Token![;],
 }
 
 pub struct Signature {
+    pub asyncness: Option<Token![async]>,
     pub fn_token: Token![fn],
     pub receiver: Option<Receiver>,
     pub args: Vec<Var>,
@@ -75,9 +95,15 @@ pub struct Receiver {
 pub enum Type {
     Ident(Ident),
     RustBox(Box<Ty1>),
+    RustVec(Box<Ty1>),
     UniquePtr(Box<Ty1>),
+    SharedPtr(Box<Ty1>),
+    WeakPtr(Box<Ty1>),
+    CxxVector(Box<Ty1>),
     Ref(Box<Ref>),
     Str(Box<Ref>),
+    Slice(Box<Slice>),
+    SliceRef(Box<Ref>),
     Fn(Box<Signature>),
     Void(Span),
 }
@@ -95,6 +121,11 @@ pub struct Ref {
     pub inner: Type,
 }
 
+pub struct Slice {
+    pub bracket: Bracket,
+    pub inner: Type,
+}
+
 #[derive(Copy, Clone, PartialEq)]
 pub enum Lang {
     Cxx,
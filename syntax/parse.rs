@@ -1,13 +1,13 @@
 use crate::syntax::{
-    attrs, error, Api, Atom, Doc, ExternFn, ExternType, Lang, Receiver, Ref, Signature, Struct,
-    Ty1, Type, Var,
+    attrs, error, Api, Atom, Doc, ExternFn, ExternType, Lang, Receiver, Ref, Signature, Slice,
+    Struct, Ty1, Type, Var,
 };
 use proc_macro2::Ident;
-use quote::{format_ident, quote};
+use quote::{format_ident, quote, quote_spanned};
 use syn::{
     Abi, Error, Fields, FnArg, ForeignItem, ForeignItemFn, ForeignItemType, GenericArgument, Item,
     ItemForeignMod, ItemStruct, Pat, PathArguments, Result, ReturnType, Type as RustType,
-    TypeBareFn, TypePath, TypeReference,
+    TypeBareFn, TypePath, TypeReference, TypeSlice,
 };
 
 pub fn parse_items(items: Vec<Item>) -> Result<Vec<Api>> {
@@ -44,7 +44,14 @@ fn parse_struct(item: ItemStruct) -> Result<Api> {
 
     let mut doc = Doc::new();
     let mut derives = Vec::new();
-    attrs::parse(&item.attrs, &mut doc, Some(&mut derives))?;
+    attrs::parse(
+        &item.attrs,
+        attrs::Parser {
+            doc: Some(&mut doc),
+            derives: Some(&mut derives),
+            ..Default::default()
+        },
+    )?;
     check_reserved_name(&item.ident)?;
 
     let fields = match item.fields {
@@ -94,8 +101,17 @@ fn parse_foreign_mod(foreign_mod: ItemForeignMod) -> Result<Vec<Api>> {
                 items.push(api_type(ety));
             }
             ForeignItem::Fn(foreign) => {
-                let efn = parse_extern_fn(foreign, lang)?;
+                let mut batch = false;
+                let efn = parse_extern_fn(foreign, lang, Some(&mut batch))?;
+                let batch_fn = if batch {
+                    Some(parse_batch_fn(&efn)?)
+                } else {
+                    None
+                };
                 items.push(api_function(efn));
+                if let Some(batch_fn) = batch_fn {
+                    items.push(api_function(batch_fn));
+                }
             }
             ForeignItem::Macro(foreign) if foreign.mac.path.is_ident("include") => {
                 let include = foreign.mac.parse_body()?;
@@ -125,17 +141,34 @@ fn parse_lang(abi: Abi) -> Result<Lang> {
 }
 
 fn parse_extern_type(foreign_type: &ForeignItemType) -> Result<ExternType> {
-    let doc = attrs::parse_doc(&foreign_type.attrs)?;
+    let mut doc = Doc::new();
+    let mut thread_safe = None;
+    let mut layout = None;
+    attrs::parse(
+        &foreign_type.attrs,
+        attrs::Parser {
+            doc: Some(&mut doc),
+            thread_safe: Some(&mut thread_safe),
+            layout: Some(&mut layout),
+            ..Default::default()
+        },
+    )?;
     let type_token = foreign_type.type_token;
     let ident = foreign_type.ident.clone();
     Ok(ExternType {
         doc,
+        thread_safe,
+        layout,
         type_token,
         ident,
     })
 }
 
-fn parse_extern_fn(foreign_fn: &ForeignItemFn, lang: Lang) -> Result<ExternFn> {
+fn parse_extern_fn(
+    foreign_fn: &ForeignItemFn,
+    lang: Lang,
+    batch: Option<&mut bool>,
+) -> Result<ExternFn> {
     let generics = &foreign_fn.sig.generics;
     if !generics.params.is_empty() || generics.where_clause.is_some() {
         return Err(Error::new_spanned(
@@ -183,7 +216,23 @@ fn parse_extern_fn(foreign_fn: &ForeignItemFn, lang: Lang) -> Result<ExternFn> {
 
     let mut throws = false;
     let ret = parse_return_type(&foreign_fn.sig.output, &mut throws)?;
-    let doc = attrs::parse_doc(&foreign_fn.attrs)?;
+    let mut doc = Doc::new();
+    let mut nopanic = false;
+    attrs::parse(
+        &foreign_fn.attrs,
+        attrs::Parser {
+            doc: Some(&mut doc),
+            // Only the shims of Rust functions have a catch_unwind to opt
+            // out of.
+            nopanic: match lang {
+                Lang::Rust => Some(&mut nopanic),
+                Lang::Cxx => None,
+            },
+            batch,
+            ..Default::default()
+        },
+    )?;
+    let asyncness = foreign_fn.sig.asyncness;
     let fn_token = foreign_fn.sig.fn_token;
     let ident = foreign_fn.sig.ident.clone();
     let mut foreign_fn2 = foreign_fn.clone();
@@ -194,8 +243,11 @@ fn parse_extern_fn(foreign_fn: &ForeignItemFn, lang: Lang) -> Result<ExternFn> {
     Ok(ExternFn {
         lang,
         doc,
+        nopanic,
+        batch: None,
         ident,
         sig: Signature {
+            asyncness,
             fn_token,
             receiver,
             args,
@@ -207,10 +259,90 @@ fn parse_extern_fn(foreign_fn: &ForeignItemFn, lang: Lang) -> Result<ExternFn> {
     })
 }
 
+// For a function marked #[batch], the declaration of the generated function
+// that takes every argument as a slice, writes the results to `out`, and runs
+// the loop over them on the callee's side of the bridge.
+fn parse_batch_fn(efn: &ExternFn) -> Result<ExternFn> {
+    if let Some(asyncness) = &efn.asyncness {
+        return Err(Error::new_spanned(
+            asyncness,
+            "#[batch] async function is not supported yet",
+        ));
+    }
+    let mut inputs = Vec::new();
+    for arg in &efn.args {
+        let elem = match &arg.ty {
+            Type::Ident(ident) if is_batch_primitive(ident) => ident,
+            Type::Ref(ty) if ty.mutability.is_none() => match &ty.inner {
+                Type::Ident(ident) if Atom::from(ident).is_none() => ident,
+                _ => return Err(Error::new_spanned(arg, BATCH_ARG_ERROR)),
+            },
+            _ => return Err(Error::new_spanned(arg, BATCH_ARG_ERROR)),
+        };
+        if arg.ident == "out" {
+            return Err(Error::new_spanned(
+                &arg.ident,
+                "`out` is the name of the results of the batched function",
+            ));
+        }
+        let ident = &arg.ident;
+        inputs.push(quote!(#ident: &[#elem]));
+    }
+    if let Some(ret) = &efn.ret {
+        let elem = match ret {
+            Type::Ident(ident) if is_batch_primitive(ident) || Atom::from(ident).is_none() => ident,
+            _ => {
+                return Err(Error::new_spanned(
+                    ret,
+                    "#[batch] requires a primitive or shared struct return type",
+                ));
+            }
+        };
+        inputs.push(quote!(out: &mut [#elem]));
+    }
+    if inputs.is_empty() {
+        return Err(Error::new_spanned(
+            efn,
+            "#[batch] requires an argument or a return value",
+        ));
+    }
+
+    let ident = format_ident!("{}_batch", efn.ident);
+    let output = if efn.throws {
+        Some(quote!(-> Result<()>))
+    } else {
+        None
+    };
+    let span = efn.ident.span();
+    let foreign_fn: ForeignItemFn = syn::parse2(quote_spanned! {span=>
+        fn #ident(#(#inputs),*) #output;
+    })?;
+    let batch = None;
+    let mut batch_fn = parse_extern_fn(&foreign_fn, efn.lang, batch)?;
+    batch_fn.batch = Some(efn.ident.clone());
+    Ok(batch_fn)
+}
+
+const BATCH_ARG_ERROR: &str =
+    "#[batch] requires primitive arguments by value and shared structs by reference";
+
+fn is_batch_primitive(ident: &Ident) -> bool {
+    match Atom::from(ident) {
+        Some(Atom::CxxString)
+        | Some(Atom::CxxIstream)
+        | Some(Atom::CxxOstream)
+        | Some(Atom::RustString)
+        | Some(Atom::Arena)
+        | None => false,
+        Some(_) => true,
+    }
+}
+
 fn parse_type(ty: &RustType) -> Result<Type> {
     match ty {
         RustType::Reference(ty) => parse_type_reference(ty),
         RustType::Path(ty) => parse_type_path(ty),
+        RustType::Slice(ty) => parse_type_slice(ty),
         RustType::BareFn(ty) => parse_type_fn(ty),
         RustType::Tuple(ty) if ty.elems.is_empty() => Ok(Type::Void(ty.paren_token.span)),
         _ => Err(Error::new_spanned(ty, "unsupported type")),
@@ -227,6 +359,7 @@ fn parse_type_reference(ty: &TypeReference) -> Result<Type> {
                 Type::Str
             }
         }
+        Type::Slice(_) => Type::SliceRef,
         _ => Type::Ref,
     };
     Ok(which(Box::new(Ref {
@@ -254,6 +387,26 @@ fn parse_type_path(ty: &TypePath) -> Result<Type> {
                             rangle: generic.gt_token,
                         })));
                     }
+                } else if ident == "SharedPtr" && generic.args.len() == 1 {
+                    if let GenericArgument::Type(arg) = &generic.args[0] {
+                        let inner = parse_type(arg)?;
+                        return Ok(Type::SharedPtr(Box::new(Ty1 {
+                            name: ident,
+                            langle: generic.lt_token,
+                            inner,
+                            rangle: generic.gt_token,
+                        })));
+                    }
+                } else if ident == "WeakPtr" && generic.args.len() == 1 {
+                    if let GenericArgument::Type(arg) = &generic.args[0] {
+                        let inner = parse_type(arg)?;
+                        return Ok(Type::WeakPtr(Box::new(Ty1 {
+                            name: ident,
+                            langle: generic.lt_token,
+                            inner,
+                            rangle: generic.gt_token,
+                        })));
+                    }
                 } else if ident == "Box" && generic.args.len() == 1 {
                     if let GenericArgument::Type(arg) = &generic.args[0] {
                         let inner = parse_type(arg)?;
@@ -264,6 +417,26 @@ fn parse_type_path(ty: &TypePath) -> Result<Type> {
                             rangle: generic.gt_token,
                         })));
                     }
+                } else if ident == "Vec" && generic.args.len() == 1 {
+                    if let GenericArgument::Type(arg) = &generic.args[0] {
+                        let inner = parse_type(arg)?;
+                        return Ok(Type::RustVec(Box::new(Ty1 {
+                            name: ident,
+                            langle: generic.lt_token,
+                            inner,
+                            rangle: generic.gt_token,
+                        })));
+                    }
+                } else if ident == "CxxVector" && generic.args.len() == 1 {
+                    if let GenericArgument::Type(arg) = &generic.args[0] {
+                        let inner = parse_type(arg)?;
+                        return Ok(Type::CxxVector(Box::new(Ty1 {
+                            name: ident,
+                            langle: generic.lt_token,
+                            inner,
+                            rangle: generic.gt_token,
+                        })));
+                    }
                 }
             }
             PathArguments::Parenthesized(_) => {}
@@ -272,6 +445,14 @@ fn parse_type_path(ty: &TypePath) -> Result<Type> {
     Err(Error::new_spanned(ty, "unsupported type"))
 }
 
+fn parse_type_slice(ty: &TypeSlice) -> Result<Type> {
+    let inner = parse_type(&ty.elem)?;
+    Ok(Type::Slice(Box::new(Slice {
+        bracket: ty.bracket_token,
+        inner,
+    })))
+}
+
 fn parse_type_fn(ty: &TypeBareFn) -> Result<Type> {
     if ty.lifetimes.is_some() {
         return Err(Error::new_spanned(
@@ -302,6 +483,7 @@ fn parse_type_fn(ty: &TypeBareFn) -> Result<Type> {
     let ret = parse_return_type(&ty.output, &mut throws)?;
     let tokens = quote!(#ty);
     Ok(Type::Fn(Box::new(Signature {
+        asyncness: None,
         fn_token: ty.fn_token,
         receiver: None,
         args,
@@ -338,7 +520,14 @@ fn parse_return_type(ty: &ReturnType, throws: &mut bool) -> Result<Option<Type>>
 }
 
 fn check_reserved_name(ident: &Ident) -> Result<()> {
-    if ident == "Box" || ident == "UniquePtr" || Atom::from(ident).is_some() {
+    if ident == "Box"
+        || ident == "Vec"
+        || ident == "UniquePtr"
+        || ident == "SharedPtr"
+        || ident == "WeakPtr"
+        || ident == "CxxVector"
+        || Atom::from(ident).is_some()
+    {
         Err(Error::new(ident.span(), "reserved name"))
     } else {
         Ok(())
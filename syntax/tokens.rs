@@ -1,5 +1,5 @@
 use crate::syntax::atom::Atom::*;
-use crate::syntax::{Derive, ExternFn, Ref, Signature, Ty1, Type, Var};
+use crate::syntax::{Derive, ExternFn, Ref, Signature, Slice, Ty1, Type, Var};
 use proc_macro2::{Ident, Span, TokenStream};
 use quote::{quote_spanned, ToTokens};
 use syn::Token;
@@ -8,14 +8,24 @@ impl ToTokens for Type {
     fn to_tokens(&self, tokens: &mut TokenStream) {
         match self {
             Type::Ident(ident) => {
-                if ident == CxxString {
+                if ident == CxxString
+                    || ident == CxxIstream
+                    || ident == CxxOstream
+                    || ident == Arena
+                {
                     let span = ident.span();
                     tokens.extend(quote_spanned!(span=> ::cxx::));
                 }
                 ident.to_tokens(tokens);
             }
-            Type::RustBox(ty) | Type::UniquePtr(ty) => ty.to_tokens(tokens),
-            Type::Ref(r) | Type::Str(r) => r.to_tokens(tokens),
+            Type::RustBox(ty)
+            | Type::RustVec(ty)
+            | Type::UniquePtr(ty)
+            | Type::SharedPtr(ty)
+            | Type::WeakPtr(ty)
+            | Type::CxxVector(ty) => ty.to_tokens(tokens),
+            Type::Ref(r) | Type::Str(r) | Type::SliceRef(r) => r.to_tokens(tokens),
+            Type::Slice(s) => s.to_tokens(tokens),
             Type::Fn(f) => f.to_tokens(tokens),
             Type::Void(span) => tokens.extend(quote_spanned!(*span=> ())),
         }
@@ -32,7 +42,11 @@ impl ToTokens for Var {
 
 impl ToTokens for Ty1 {
     fn to_tokens(&self, tokens: &mut TokenStream) {
-        if self.name == "UniquePtr" {
+        if self.name == "UniquePtr"
+            || self.name == "SharedPtr"
+            || self.name == "WeakPtr"
+            || self.name == "CxxVector"
+        {
             let span = self.name.span();
             tokens.extend(quote_spanned!(span=> ::cxx::));
         }
@@ -51,6 +65,14 @@ impl ToTokens for Ref {
     }
 }
 
+impl ToTokens for Slice {
+    fn to_tokens(&self, tokens: &mut TokenStream) {
+        self.bracket.surround(tokens, |tokens| {
+            self.inner.to_tokens(tokens);
+        });
+    }
+}
+
 impl ToTokens for Derive {
     fn to_tokens(&self, tokens: &mut TokenStream) {
         let name = match self {
@@ -11,6 +11,11 @@ pub struct Types<'a> {
     pub structs: Map<Ident, &'a Struct>,
     pub cxx: Set<'a, Ident>,
     pub rust: Set<'a, Ident>,
+    // Shared structs that are trivially copyable in C++.
+    pub pod: Set<'a, Ident>,
+    // Shared structs made of primitives only, directly or through other such
+    // structs, whose layout is asserted on both sides.
+    pub flat: Set<'a, Ident>,
 }
 
 impl<'a> Types<'a> {
@@ -24,8 +29,14 @@ impl<'a> Types<'a> {
             all.insert(ty);
             match ty {
                 Type::Ident(_) | Type::Str(_) | Type::Void(_) => {}
-                Type::RustBox(ty) | Type::UniquePtr(ty) => visit(all, &ty.inner),
-                Type::Ref(r) => visit(all, &r.inner),
+                Type::RustBox(ty)
+                | Type::RustVec(ty)
+                | Type::UniquePtr(ty)
+                | Type::SharedPtr(ty)
+                | Type::WeakPtr(ty)
+                | Type::CxxVector(ty) => visit(all, &ty.inner),
+                Type::Ref(r) | Type::SliceRef(r) => visit(all, &r.inner),
+                Type::Slice(s) => visit(all, &s.inner),
                 Type::Fn(f) => {
                     if let Some(ret) = &f.ret {
                         visit(all, ret);
@@ -75,11 +86,16 @@ impl<'a> Types<'a> {
             }
         }
 
+        let pod = collect_pod(&structs, true);
+        let flat = collect_pod(&structs, false);
+
         Ok(Types {
             all,
             structs,
             cxx,
             rust,
+            pod,
+            flat,
         })
     }
 
@@ -92,17 +108,56 @@ impl<'a> Types<'a> {
                     Atom::from(ident) == Some(RustString)
                 }
             }
+            Type::RustVec(_) | Type::SharedPtr(_) | Type::WeakPtr(_) => true,
             _ => false,
         }
     }
 
+    // Passed and returned by value following the platform C ABI, rather than
+    // moved through a pointer.
     pub fn is_pod(&self, strct: &Struct) -> bool {
-        for derive in &strct.derives {
-            if *derive == Derive::Copy {
-                return true;
+        self.pod.contains(&strct.ident)
+    }
+
+    // Laid out by the platform C ABI from primitives alone, so the same bytes
+    // mean the same value in either language and arrays of it can be copied
+    // or mapped wholesale.
+    pub fn is_flat(&self, strct: &Struct) -> bool {
+        self.flat.contains(&strct.ident)
+    }
+}
+
+// A struct is plain old data if it derives Copy (when copy_counts) or if every
+// field is a primitive or another such struct. Repeats until nothing changes
+// so that the order of declaration does not matter and a cycle of structs,
+// which rustc rejects anyway, terminates here.
+fn collect_pod<'a>(structs: &Map<Ident, &'a Struct>, copy_counts: bool) -> Set<'a, Ident> {
+    let mut pod = Set::new();
+    loop {
+        let mut changed = false;
+        for strct in structs.values() {
+            if pod.contains(&strct.ident) {
+                continue;
             }
+            let derives_copy =
+                copy_counts && strct.derives.iter().any(|derive| *derive == Derive::Copy);
+            let fields_pod = strct.fields.iter().all(|field| match &field.ty {
+                Type::Ident(ident) => match Atom::from(ident) {
+                    Some(CxxString) | Some(CxxIstream) | Some(CxxOstream) | Some(RustString)
+                    | Some(Arena) => false,
+                    Some(_) => true,
+                    None => pod.contains(ident),
+                },
+                _ => false,
+            });
+            if derives_copy || fields_pod {
+                pod.insert(&strct.ident);
+                changed = true;
+            }
+        }
+        if !changed {
+            return pod;
         }
-        false
     }
 }
 
@@ -0,0 +1,65 @@
+// Counts every allocation made through the global operator new, so that
+// benches/bridge.rs can report C++ allocations per call next to its own count
+// of Rust allocations. This replaces the allocator of the whole program, so it
+// is built apart from the test suite and linked only into that bench.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<size_t> allocations{0};
+
+void *allocate(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+} // namespace
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+#if defined(__cpp_aligned_new)
+namespace {
+void *allocate(size_t size, std::align_val_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  auto alignment = static_cast<size_t>(align);
+  // aligned_alloc wants a multiple of the alignment.
+  auto rounded = (size + alignment - 1) / alignment * alignment;
+  if (void *ptr = std::aligned_alloc(alignment, rounded == 0 ? alignment
+                                                             : rounded)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+} // namespace
+
+void *operator new(size_t size, std::align_val_t align) {
+  return allocate(size, align);
+}
+void *operator new[](size_t size, std::align_val_t align) {
+  return allocate(size, align);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+#endif
+
+extern "C" size_t cxx_test_suite_bench_cxx_allocations() noexcept {
+  return allocations.load(std::memory_order_relaxed);
+}
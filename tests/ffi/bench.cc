@@ -0,0 +1,134 @@
+// Workloads for the benches in benches/, which do the timing. Sorting and
+// growing a vector of rust::String is dominated by moves of its elements. The
+// cxx_to_rust loops call each extern "Rust" function of the test suite bridge
+// from C++.
+
+#include "tests/ffi/tests.h"
+#include "tests/ffi/lib.rs.h"
+#include "rust/cxx.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+extern "C" tests::R *cxx_test_suite_get_box() noexcept;
+
+namespace {
+using Strings = std::vector<rust::String>;
+
+bool less(const rust::String &a, const rust::String &b) noexcept {
+  auto n = std::min(a.size(), b.size());
+  auto cmp = std::memcmp(a.data(), b.data(), n);
+  return cmp < 0 || (cmp == 0 && a.size() < b.size());
+}
+} // namespace
+
+extern "C" {
+void *cxx_test_suite_bench_strings_new(size_t n) noexcept {
+  auto strings = new Strings;
+  strings->reserve(n);
+  std::minstd_rand rng(2020);
+  for (size_t i = 0; i < n; i++) {
+    strings->emplace_back(std::to_string(rng()));
+  }
+  return strings;
+}
+
+void cxx_test_suite_bench_strings_drop(void *strings) noexcept {
+  delete static_cast<Strings *>(strings);
+}
+
+void cxx_test_suite_bench_strings_sort(void *strings) noexcept {
+  auto &v = *static_cast<Strings *>(strings);
+  std::minstd_rand rng(2020);
+  std::shuffle(v.begin(), v.end(), rng);
+  std::sort(v.begin(), v.end(), less);
+}
+
+void cxx_test_suite_bench_strings_grow(void *strings) noexcept {
+  auto &v = *static_cast<Strings *>(strings);
+  Strings grown;
+  for (auto &s : v) {
+    grown.push_back(std::move(s));
+  }
+  v.swap(grown);
+}
+} // extern "C"
+
+// L1 instruction cache misses of the process in user space since the first
+// call, or -1 where the kernel does not allow counting them.
+extern "C" int64_t cxx_test_suite_bench_icache_misses() noexcept {
+#if defined(__linux__)
+  static int fd = [] {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof attr;
+    attr.config = PERF_COUNT_HW_CACHE_L1I |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }();
+  uint64_t count;
+  if (fd >= 0 && read(fd, &count, sizeof count) == sizeof count) {
+    return static_cast<int64_t>(count);
+  }
+#endif
+  return -1;
+}
+
+#define CXX_TO_RUST(name, ...)                                                 \
+  extern "C" void cxx_test_suite_bench_##name(size_t iters) noexcept {         \
+    for (size_t i = 0; i < iters; i++) {                                       \
+      __VA_ARGS__;                                                             \
+    }                                                                          \
+  }
+
+CXX_TO_RUST(r_return_primitive, tests::r_return_primitive())
+CXX_TO_RUST(r_take_primitive, tests::r_take_primitive(2020))
+CXX_TO_RUST(r_return_shared, tests::r_return_shared())
+CXX_TO_RUST(r_take_shared, tests::r_take_shared(tests::Shared{2020}))
+CXX_TO_RUST(r_return_str, tests::r_return_str(tests::Shared{2020}))
+CXX_TO_RUST(r_take_str, tests::r_take_str("2020"))
+CXX_TO_RUST(r_return_rust_string, tests::r_return_rust_string())
+CXX_TO_RUST(r_take_rust_string, tests::r_take_rust_string("2020"))
+CXX_TO_RUST(r_return_rust_vec, tests::r_return_rust_vec())
+CXX_TO_RUST(r_take_rust_vec, tests::r_take_rust_vec(tests::c_return_rust_vec()))
+CXX_TO_RUST(r_return_box, tests::r_return_box())
+CXX_TO_RUST(r_take_box, tests::r_take_box(rust::Box<tests::R>::from_raw(
+                            cxx_test_suite_get_box())))
+CXX_TO_RUST(r_return_unique_ptr, tests::r_return_unique_ptr())
+CXX_TO_RUST(r_take_unique_ptr,
+            tests::r_take_unique_ptr(std::unique_ptr<tests::C>(
+                new tests::C{2020})))
+CXX_TO_RUST(r_return_unique_ptr_string, tests::r_return_unique_ptr_string())
+CXX_TO_RUST(r_take_unique_ptr_string,
+            tests::r_take_unique_ptr_string(std::unique_ptr<std::string>(
+                new std::string("2020"))))
+CXX_TO_RUST(r_try_return_primitive, tests::r_try_return_primitive())
+CXX_TO_RUST(r_fail_return_primitive, try {
+  tests::r_fail_return_primitive();
+} catch (const rust::Error &) {})
+CXX_TO_RUST(r_fail_return_long_message, try {
+  tests::r_fail_return_long_message();
+} catch (const rust::Error &) {})
+CXX_TO_RUST(r_fail_return_error_code, try {
+  tests::r_fail_return_error_code();
+} catch (const rust::Error &) {})
+CXX_TO_RUST(r_try_return, {
+  tests::r_try_return_void();
+  tests::r_try_return_primitive();
+})
+CXX_TO_RUST(clone_rust_string, {
+  static const rust::String source("2020");
+  rust::String copy(source);
+})
@@ -1,11 +1,41 @@
+use std::env;
+
 fn main() {
     if cfg!(trybuild) {
         return;
     }
 
+    // The test suite runs against the code generator's default mode, which is
+    // what most users get, unless CXX_TEST_DIRECT_CALLS is set. CI runs it
+    // both ways.
+    let direct_calls = env::var_os("CXX_TEST_DIRECT_CALLS").is_some();
     cxx::Build::new()
-        .bridge("lib.rs")
+        .direct_calls(direct_calls)
+        .unity(true)
+        .bridges(&["lib.rs", "module.rs"])
         .file("tests.cc")
+        .file("bench.cc")
         .flag("-std=c++11")
         .compile("cxx-test-suite");
+
+    // Replaces the global operator new, so it stays out of the library that
+    // the tests link. benches/bridge.rs links it by name from the same
+    // directory.
+    cc::Build::new()
+        .file("alloc.cc")
+        .flag("-std=c++11")
+        .cargo_metadata(false)
+        .compile("cxx-test-suite-alloc");
+
+    println!("cargo:rerun-if-env-changed=CXX_TEST_DIRECT_CALLS");
+    for file in &[
+        "lib.rs",
+        "module.rs",
+        "tests.cc",
+        "tests.h",
+        "bench.cc",
+        "alloc.cc",
+    ] {
+        println!("cargo:rerun-if-changed={}", file);
+    }
 }
@@ -1,7 +1,10 @@
 #![allow(clippy::boxed_local, clippy::trivially_copy_pass_by_ref)]
 
-use cxx::{CxxString, UniquePtr};
+use cxx::{Arena, CxxIstream, CxxOstream, CxxString, CxxVector, ErrorCode, UniquePtr};
 use std::fmt::{self, Display};
+use std::io;
+
+pub mod module;
 
 #[cxx::bridge(namespace = tests)]
 pub mod ffi {
@@ -9,9 +12,20 @@ pub mod ffi {
         z: usize,
     }
 
+    struct Nested {
+        shared: Shared,
+        flag: bool,
+    }
+
+    struct Named {
+        name: String,
+        z: usize,
+    }
+
     extern "C" {
         include!("tests/ffi/tests.h");
 
+        #[thread_safe]
         type C;
 
         fn c_return_primitive() -> usize;
@@ -20,8 +34,16 @@ pub mod ffi {
         fn c_return_unique_ptr() -> UniquePtr<C>;
         fn c_return_ref(shared: &Shared) -> &usize;
         fn c_return_str(shared: &Shared) -> &str;
+        fn c_return_slice(shared: &Shared) -> &[u8];
         fn c_return_rust_string() -> String;
+        fn c_return_rust_vec() -> Vec<u8>;
         fn c_return_unique_ptr_string() -> UniquePtr<CxxString>;
+        fn c_return_unique_ptr_vector_u8() -> UniquePtr<CxxVector<u8>>;
+        fn c_return_unique_ptr_vector_f64() -> UniquePtr<CxxVector<f64>>;
+        fn c_return_unique_ptr_vector_shared() -> UniquePtr<CxxVector<Shared>>;
+        fn c_return_ref_vector(c: &C) -> &CxxVector<u8>;
+        fn c_return_shared_ptr() -> SharedPtr<C>;
+        fn c_return_shared_ptr_string() -> SharedPtr<CxxString>;
 
         fn c_take_primitive(n: usize);
         fn c_take_shared(shared: Shared);
@@ -30,30 +52,66 @@ pub mod ffi {
         fn c_take_ref_r(r: &R);
         fn c_take_ref_c(c: &C);
         fn c_take_str(s: &str);
+        fn c_take_slice_u8(s: &[u8]);
+        fn c_take_slice_shared(s: &[Shared]);
+        fn c_take_mut_slice(s: &mut [u32]);
         fn c_take_rust_string(s: String);
+        fn c_take_rust_vec(v: Vec<u8>);
+        fn c_take_rust_vec_shared(v: Vec<Shared>);
+        fn c_take_ref_rust_vec(v: &Vec<u8>);
+        fn c_take_mut_rust_vec(v: &mut Vec<f32>);
+        fn c_extend_rust_vec_from_self(v: Vec<u8>) -> Vec<u8>;
         fn c_take_unique_ptr_string(s: UniquePtr<CxxString>);
+        fn c_take_unique_ptr_vector_u8(v: UniquePtr<CxxVector<u8>>);
+        fn c_take_ref_vector(v: &CxxVector<u8>);
+        fn c_take_shared_ptr(c: SharedPtr<C>) -> usize;
+        fn c_take_weak_ptr(c: WeakPtr<C>);
         fn c_take_callback(callback: fn(String) -> usize);
+        fn c_copy_stream(input: &mut CxxIstream, output: &mut CxxOstream) -> usize;
 
         fn c_try_return_void() -> Result<()>;
         fn c_try_return_primitive() -> Result<usize>;
         fn c_fail_return_primitive() -> Result<usize>;
+        fn c_fail_return_long_message() -> Result<usize>;
         fn c_try_return_box() -> Result<Box<R>>;
         fn c_try_return_ref(s: &String) -> Result<&String>;
         fn c_try_return_str(s: &str) -> Result<&str>;
+        fn c_try_return_slice(s: &[u8]) -> Result<&[u8]>;
         fn c_try_return_rust_string() -> Result<String>;
         fn c_try_return_unique_ptr_string() -> Result<UniquePtr<CxxString>>;
+
+        #[batch]
+        fn c_add(shared: &Shared, n: usize) -> usize;
+        #[batch]
+        fn c_try_increment(n: usize) -> Result<usize>;
+
+        async fn c_async_add(a: usize, b: usize) -> usize;
+        async fn c_async_greeting(name: String) -> String;
+        async fn c_async_abandon();
+
+        fn c_arena_make_shared(arena: &Arena, z: usize) -> &Shared;
+        fn c_arena_sum(arena: &Arena) -> usize;
+        fn c_arena_too_large(arena: &Arena) -> bool;
+
+        fn c_flip_nested(nested: Nested) -> Nested;
+        fn c_rename(named: Named) -> Named;
     }
 
     extern "Rust" {
         type R;
+        #[layout(size = 24, align = 8)]
+        type Tally;
 
+        #[nopanic]
         fn r_return_primitive() -> usize;
         fn r_return_shared() -> Shared;
         fn r_return_box() -> Box<R>;
         fn r_return_unique_ptr() -> UniquePtr<C>;
         fn r_return_ref(shared: &Shared) -> &usize;
         fn r_return_str(shared: &Shared) -> &str;
+        fn r_return_slice(shared: &Shared) -> &[u8];
         fn r_return_rust_string() -> String;
+        fn r_return_rust_vec() -> Vec<u8>;
         fn r_return_unique_ptr_string() -> UniquePtr<CxxString>;
 
         fn r_take_primitive(n: usize);
@@ -63,17 +121,45 @@ pub mod ffi {
         fn r_take_ref_r(r: &R);
         fn r_take_ref_c(c: &C);
         fn r_take_str(s: &str);
+        fn r_take_slice_u8(s: &[u8]);
+        fn r_take_mut_slice(s: &mut [u32]);
         fn r_take_rust_string(s: String);
+        fn r_take_utf8_str(s: &str);
+        fn r_take_utf8_rust_string(s: String);
+        fn r_take_rust_vec(v: Vec<u8>);
+        fn r_take_ref_rust_vec(v: &Vec<u8>);
         fn r_take_unique_ptr_string(s: UniquePtr<CxxString>);
+        fn r_take_ref_vector(v: &CxxVector<u8>);
+        fn r_take_callable(callable: fn(usize) -> usize, n: usize) -> usize;
+        fn r_copy_stream(input: &mut CxxIstream, output: &mut CxxOstream) -> usize;
 
         fn r_try_return_void() -> Result<()>;
+        #[nopanic]
         fn r_try_return_primitive() -> Result<usize>;
         fn r_fail_return_primitive() -> Result<usize>;
+        fn r_fail_return_long_message() -> Result<usize>;
+        fn r_fail_return_error_code() -> Result<usize>;
+
+        async fn r_async_add(a: usize, b: usize) -> usize;
+        async fn r_async_greeting(name: String) -> String;
+
+        #[batch]
+        fn r_add(shared: &Shared, n: usize) -> usize;
+
+        fn r_arena_make_shared(arena: &Arena, z: usize) -> &Shared;
+
+        fn r_tally_add(tally: &mut Tally, n: usize);
+        fn r_tally_sum(tally: &Tally) -> usize;
     }
 }
 
 pub type R = usize;
 
+#[derive(Default)]
+pub struct Tally {
+    items: Vec<usize>,
+}
+
 #[derive(Debug)]
 struct Error;
 
@@ -113,10 +199,19 @@ fn r_return_str(shared: &ffi::Shared) -> &str {
     "2020"
 }
 
+fn r_return_slice(shared: &ffi::Shared) -> &[u8] {
+    let _ = shared;
+    b"2020"
+}
+
 fn r_return_rust_string() -> String {
     "2020".to_owned()
 }
 
+fn r_return_rust_vec() -> Vec<u8> {
+    b"2020".to_vec()
+}
+
 fn r_return_unique_ptr_string() -> UniquePtr<CxxString> {
     extern "C" {
         fn cxx_test_suite_get_unique_ptr_string() -> *mut CxxString;
@@ -152,14 +247,52 @@ fn r_take_str(s: &str) {
     assert_eq!(s, "2020");
 }
 
+fn r_take_slice_u8(s: &[u8]) {
+    assert_eq!(s, b"2020");
+}
+
+fn r_take_mut_slice(s: &mut [u32]) {
+    for n in s {
+        *n = 2020;
+    }
+}
+
 fn r_take_rust_string(s: String) {
     assert_eq!(s, "2020");
 }
 
+fn r_take_utf8_str(s: &str) {
+    assert_eq!(s, "2020 caf\u{e9} \u{20ac}");
+}
+
+fn r_take_utf8_rust_string(s: String) {
+    assert_eq!(s, "2020 caf\u{e9} \u{20ac}");
+}
+
+fn r_take_rust_vec(v: Vec<u8>) {
+    assert_eq!(v, b"2020");
+}
+
+fn r_take_ref_rust_vec(v: &Vec<u8>) {
+    assert_eq!(v, b"2020");
+}
+
 fn r_take_unique_ptr_string(s: UniquePtr<CxxString>) {
     assert_eq!(s.as_ref().unwrap().to_str().unwrap(), "2020");
 }
 
+fn r_take_ref_vector(v: &CxxVector<u8>) {
+    assert_eq!(v.as_slice(), [20, 2, 0]);
+}
+
+fn r_take_callable(callable: &dyn Fn(usize) -> usize, n: usize) -> usize {
+    callable(n)
+}
+
+fn r_copy_stream(input: &mut CxxIstream, output: &mut CxxOstream) -> usize {
+    io::copy(input, output).unwrap() as usize
+}
+
 fn r_try_return_void() -> Result<(), Error> {
     Ok(())
 }
@@ -171,3 +304,36 @@ fn r_try_return_primitive() -> Result<usize, Error> {
 fn r_fail_return_primitive() -> Result<usize, Error> {
     Err(Error)
 }
+
+fn r_fail_return_long_message() -> Result<usize, String> {
+    Err("a message long enough that it no longer fits inline in the error".to_owned())
+}
+
+fn r_fail_return_error_code() -> Result<usize, ErrorCode> {
+    Err(ErrorCode(2020))
+}
+
+// Finishes on the thread that completes the C++ promise, not on the caller's.
+async fn r_async_add(a: usize, b: usize) -> usize {
+    ffi::c_async_add(a, b).await
+}
+
+async fn r_async_greeting(name: String) -> String {
+    format!("hello {}", name)
+}
+
+fn r_add(shared: &ffi::Shared, n: usize) -> usize {
+    shared.z + n
+}
+
+fn r_arena_make_shared(arena: &Arena, z: usize) -> &ffi::Shared {
+    arena.alloc(ffi::Shared { z })
+}
+
+fn r_tally_add(tally: &mut Tally, n: usize) {
+    tally.items.push(n);
+}
+
+fn r_tally_sum(tally: &Tally) -> usize {
+    tally.items.iter().sum()
+}
@@ -0,0 +1,34 @@
+// A second bridge in the same namespace as the one in lib.rs, which build.rs
+// compiles in the same unity translation unit. It declares the same shared
+// struct, and both bridges use Vec<u8> and Result in either direction, so the
+// generated code of each must tolerate the other's.
+#[cxx::bridge(namespace = tests)]
+pub mod ffi {
+    struct Shared {
+        z: usize,
+    }
+
+    extern "C" {
+        include!("tests/ffi/tests.h");
+
+        fn c_module_try_increment(n: i32) -> Result<i32>;
+        fn c_module_add(shared: &Shared, n: usize) -> usize;
+        fn c_module_sum_rust_vec(v: Vec<u8>) -> usize;
+    }
+
+    extern "Rust" {
+        fn r_module_return_rust_vec() -> Vec<u8>;
+        fn r_module_try_sum(v: &Vec<u8>) -> Result<usize>;
+    }
+}
+
+fn r_module_return_rust_vec() -> Vec<u8> {
+    vec![200, 200, 20]
+}
+
+fn r_module_try_sum(v: &Vec<u8>) -> Result<usize, String> {
+    if v.is_empty() {
+        return Err("empty".to_owned());
+    }
+    Ok(v.iter().map(|&b| b as usize).sum())
+}
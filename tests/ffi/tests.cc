@@ -1,7 +1,13 @@
 #include "tests/ffi/tests.h"
 #include "tests/ffi/lib.rs.h"
+#include "tests/ffi/module.rs.h"
+#include <array>
 #include <cstring>
+#include <future>
+#include <limits>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
 
 extern "C" void cxx_test_suite_set_correct() noexcept;
 extern "C" tests::R *cxx_test_suite_get_box() noexcept;
@@ -9,10 +15,12 @@ extern "C" bool cxx_test_suite_r_is_correct(const tests::R *) noexcept;
 
 namespace tests {
 
-C::C(size_t n) : n(n) {}
+C::C(size_t n) : n(n), v{20, 2, 0} {}
 
 size_t C::get() const { return this->n; }
 
+const std::vector<uint8_t> &C::get_v() const { return this->v; }
+
 size_t c_return_primitive() { return 2020; }
 
 Shared c_return_shared() { return Shared{2020}; }
@@ -32,12 +40,58 @@ rust::Str c_return_str(const Shared &shared) {
   return "2020";
 }
 
+rust::Slice<const uint8_t> c_return_slice(const Shared &shared) {
+  (void)shared;
+  return {reinterpret_cast<const uint8_t *>("2020"), 4};
+}
+
 rust::String c_return_rust_string() { return "2020"; }
 
+rust::Vec<uint8_t> c_return_rust_vec() {
+  rust::Vec<uint8_t> v;
+  v.extend(reinterpret_cast<const uint8_t *>("2020"), 4);
+  return v;
+}
+
 std::unique_ptr<std::string> c_return_unique_ptr_string() {
   return std::unique_ptr<std::string>(new std::string("2020"));
 }
 
+std::unique_ptr<std::vector<uint8_t>> c_return_unique_ptr_vector_u8() {
+  auto vec = std::unique_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>());
+  vec->push_back(86);
+  vec->push_back(75);
+  vec->push_back(30);
+  vec->push_back(9);
+  return vec;
+}
+
+std::unique_ptr<std::vector<double>> c_return_unique_ptr_vector_f64() {
+  auto vec = std::unique_ptr<std::vector<double>>(new std::vector<double>());
+  vec->push_back(86.0);
+  vec->push_back(75.0);
+  vec->push_back(30.0);
+  vec->push_back(9.5);
+  return vec;
+}
+
+std::unique_ptr<std::vector<Shared>> c_return_unique_ptr_vector_shared() {
+  auto vec = std::unique_ptr<std::vector<Shared>>(new std::vector<Shared>());
+  vec->push_back(Shared{1010});
+  vec->push_back(Shared{1011});
+  return vec;
+}
+
+const std::vector<uint8_t> &c_return_ref_vector(const C &c) {
+  return c.get_v();
+}
+
+std::shared_ptr<C> c_return_shared_ptr() { return std::make_shared<C>(2020); }
+
+std::shared_ptr<std::string> c_return_shared_ptr_string() {
+  return std::make_shared<std::string>("2020");
+}
+
 void c_take_primitive(size_t n) {
   if (n == 2020) {
     cxx_test_suite_set_correct();
@@ -80,40 +134,218 @@ void c_take_str(rust::Str s) {
   }
 }
 
+void c_take_slice_u8(rust::Slice<const uint8_t> s) {
+  if (std::string(reinterpret_cast<const char *>(s.data()), s.size()) ==
+      "2020") {
+    cxx_test_suite_set_correct();
+  }
+}
+
+void c_take_slice_shared(rust::Slice<const Shared> s) {
+  if (s.size() == 2 && s.data()[0].z == 2020 && s.data()[1].z == 2021) {
+    cxx_test_suite_set_correct();
+  }
+}
+
+void c_take_mut_slice(rust::Slice<uint32_t> s) {
+  for (size_t i = 0; i < s.size(); i++) {
+    s.data()[i] = 2020;
+  }
+}
+
 void c_take_rust_string(rust::String s) {
   if (std::string(s) == "2020") {
     cxx_test_suite_set_correct();
   }
 }
 
+void c_take_rust_vec(rust::Vec<uint8_t> v) { c_take_ref_rust_vec(v); }
+
+void c_take_rust_vec_shared(rust::Vec<Shared> v) {
+  size_t sum = 0;
+  for (const Shared &shared : v) {
+    sum += shared.z;
+  }
+  if (v.size() == 2 && sum == 4041) {
+    cxx_test_suite_set_correct();
+  }
+}
+
+void c_take_ref_rust_vec(const rust::Vec<uint8_t> &v) {
+  if (std::string(reinterpret_cast<const char *>(v.data()), v.size()) ==
+      "2020") {
+    cxx_test_suite_set_correct();
+  }
+}
+
+void c_take_mut_rust_vec(rust::Vec<float> &v) {
+  v.reserve(v.size() + 2);
+  v.push_back(20.f);
+  v.push_back(20.f);
+  for (float &f : v) {
+    f *= 101.f;
+  }
+}
+
+rust::Vec<uint8_t> c_extend_rust_vec_from_self(rust::Vec<uint8_t> v) {
+  // Each of these grows v while reading from its old buffer.
+  v.push_back(v[0]);
+  v.extend(v.data(), v.size());
+  return v;
+}
+
 void c_take_unique_ptr_string(std::unique_ptr<std::string> s) {
   if (*s == "2020") {
     cxx_test_suite_set_correct();
   }
 }
 
+void c_take_unique_ptr_vector_u8(std::unique_ptr<std::vector<uint8_t>> v) {
+  if (v->size() == 4) {
+    cxx_test_suite_set_correct();
+  }
+}
+
+void c_take_ref_vector(const std::vector<uint8_t> &v) {
+  if (v.size() == 4) {
+    cxx_test_suite_set_correct();
+  }
+}
+
+size_t c_take_shared_ptr(std::shared_ptr<C> c) {
+  if (c->get() == 2020) {
+    cxx_test_suite_set_correct();
+  }
+  return static_cast<size_t>(c.use_count());
+}
+
+void c_take_weak_ptr(std::weak_ptr<C> c) {
+  std::shared_ptr<C> shared = c.lock();
+  if (shared && shared->get() == 2020) {
+    cxx_test_suite_set_correct();
+  }
+}
+
 void c_take_callback(rust::Fn<size_t(rust::String)> callback) {
   callback("2020");
 }
 
+size_t c_copy_stream(std::istream &input, std::ostream &output) {
+  char chunk[100];
+  size_t total = 0;
+  while (input.read(chunk, sizeof chunk) || input.gcount() > 0) {
+    output.write(chunk, input.gcount());
+    total += static_cast<size_t>(input.gcount());
+  }
+  output << '.';
+  return total;
+}
+
 void c_try_return_void() {}
 
 size_t c_try_return_primitive() { return 2020; }
 
 size_t c_fail_return_primitive() { throw std::logic_error("logic error"); }
 
+size_t c_fail_return_long_message() {
+  throw std::logic_error("a message long enough that it no longer fits inline in the error");
+}
+
 rust::Box<R> c_try_return_box() { return c_return_box(); }
 
 const rust::String &c_try_return_ref(const rust::String &s) { return s; }
 
 rust::Str c_try_return_str(rust::Str s) { return s; }
 
+rust::Slice<const uint8_t> c_try_return_slice(rust::Slice<const uint8_t> s) {
+  return s;
+}
+
 rust::String c_try_return_rust_string() { return c_return_rust_string(); }
 
 std::unique_ptr<std::string> c_try_return_unique_ptr_string() {
   return c_return_unique_ptr_string();
 }
 
+size_t c_add(const Shared &shared, size_t n) { return shared.z + n; }
+
+size_t c_try_increment(size_t n) {
+  if (n == 0) {
+    throw std::logic_error("zero");
+  }
+  return n + 1;
+}
+
+static void complete_add(size_t a, size_t b, rust::Promise<size_t> promise) {
+  promise.set_value(a + b);
+}
+
+void c_async_add(size_t a, size_t b, rust::Promise<size_t> promise) {
+  std::thread(complete_add, a, b, std::move(promise)).detach();
+}
+
+void c_async_greeting(rust::String name, rust::Promise<rust::String> promise) {
+  promise.set_value("hello " + std::string(name));
+}
+
+void c_async_abandon(rust::Promise<void> promise) { (void)promise; }
+
+const Shared &c_arena_make_shared(const rust::Arena &arena, size_t z) {
+  return *arena.make<Shared>(Shared{z});
+}
+
+size_t c_arena_sum(const rust::Arena &arena) {
+  size_t sum = 0;
+  for (size_t z = 1; z <= 100; z++) {
+    sum += r_arena_make_shared(arena, z).z;
+  }
+  return sum;
+}
+
+bool c_arena_too_large(const rust::Arena &arena) {
+  // One size overflows once the alignment is added, the other only exceeds
+  // what Rust can lay out.
+  size_t sizes[] = {std::numeric_limits<size_t>::max() - 4,
+                    std::numeric_limits<size_t>::max() / 2};
+  for (size_t size : sizes) {
+    try {
+      arena.allocate(size, 8);
+      return false;
+    } catch (const std::bad_alloc &) {
+    }
+  }
+  return true;
+}
+
+Nested c_flip_nested(Nested nested) {
+  nested.shared.z++;
+  nested.flag = !nested.flag;
+  return nested;
+}
+
+Named c_rename(Named named) {
+  named.name = std::string(named.name) + " and c++";
+  named.z++;
+  return named;
+}
+
+int32_t c_module_try_increment(int32_t n) {
+  if (n == 0) {
+    throw std::logic_error("zero");
+  }
+  return n + 1;
+}
+
+size_t c_module_add(const Shared &shared, size_t n) { return shared.z + n; }
+
+size_t c_module_sum_rust_vec(rust::Vec<uint8_t> v) {
+  size_t sum = 0;
+  for (uint8_t b : v) {
+    sum += b;
+  }
+  return sum;
+}
+
 extern "C" C *cxx_test_suite_get_unique_ptr() noexcept {
   return std::unique_ptr<C>(new C{2020}).release();
 }
@@ -138,7 +370,13 @@ extern "C" const char *cxx_run_test() noexcept {
   ASSERT(r_return_unique_ptr()->get() == 2020);
   ASSERT(r_return_ref(Shared{2020}) == 2020);
   ASSERT(std::string(r_return_str(Shared{2020})) == "2020");
+  auto slice = r_return_slice(Shared{2020});
+  ASSERT(std::string(reinterpret_cast<const char *>(slice.data()),
+                     slice.size()) == "2020");
   ASSERT(std::string(r_return_rust_string()) == "2020");
+  auto vec = r_return_rust_vec();
+  ASSERT(std::string(reinterpret_cast<const char *>(vec.data()),
+                     vec.size()) == "2020");
   ASSERT(*r_return_unique_ptr_string() == "2020");
 
   r_take_primitive(2020);
@@ -146,9 +384,41 @@ extern "C" const char *cxx_run_test() noexcept {
   r_take_unique_ptr(std::unique_ptr<C>(new C{2020}));
   r_take_ref_c(C{2020});
   r_take_str(rust::Str("2020"));
+  r_take_slice_u8(rust::Slice<const uint8_t>(
+      reinterpret_cast<const uint8_t *>("2020"), 4));
+  uint32_t nums[3] = {0, 0, 0};
+  r_take_mut_slice(rust::Slice<uint32_t>(nums, 3));
+  ASSERT(nums[0] == 2020 && nums[1] == 2020 && nums[2] == 2020);
+  r_take_mut_slice(rust::Slice<uint32_t>());
   r_take_rust_string(rust::String("2020"));
+  const char utf8[] = "2020 caf\xc3\xa9 \xe2\x82\xac";
+  r_take_utf8_str(rust::Str::from_utf8_unchecked(utf8, sizeof(utf8) - 1));
+  r_take_utf8_rust_string(
+      rust::String::from_utf8_unchecked(utf8, sizeof(utf8) - 1));
+  r_take_ref_rust_vec(vec);
+  r_take_rust_vec(std::move(vec));
+  ASSERT(vec.empty());
   r_take_unique_ptr_string(
       std::unique_ptr<std::string>(new std::string("2020")));
+  r_take_ref_vector(std::vector<uint8_t>{20, 2, 0});
+  size_t year = 2000;
+  ASSERT(r_take_callable([&](size_t n) { return year + n; }, 20) == 2020);
+  std::array<size_t, 8> years{{2000}};
+  ASSERT(r_take_callable([years](size_t n) { return years[0] + n; }, 20) ==
+         2020);
+  std::istringstream input(std::string(1000, 'x'));
+  std::ostringstream output;
+  ASSERT(r_copy_stream(input, output) == 1000);
+  ASSERT(output.str() == std::string(1000, 'x'));
+
+  std::promise<size_t> sum;
+  r_async_add(2000, 20, [&sum](size_t n) { sum.set_value(n); });
+  ASSERT(sum.get_future().get() == 2020);
+  std::promise<std::string> greeting;
+  r_async_greeting("world", [&greeting](rust::String s) {
+    greeting.set_value(std::string(s));
+  });
+  ASSERT(greeting.get_future().get() == "hello world");
 
   ASSERT(r_try_return_primitive() == 2020);
   try {
@@ -156,6 +426,98 @@ extern "C" const char *cxx_run_test() noexcept {
     ASSERT(false);
   } catch (const rust::Error &e) {
     ASSERT(std::strcmp(e.what(), "rust error") == 0);
+    ASSERT(e.code() == 0);
+  }
+  try {
+    r_fail_return_long_message();
+    ASSERT(false);
+  } catch (const rust::Error &e) {
+    rust::Error copy(e);
+    ASSERT(copy.what() == e.what());
+    rust::Error moved(std::move(copy));
+    ASSERT(std::strcmp(moved.what(), "a message long enough that it no longer fits inline in the error") == 0);
+    ASSERT(std::strcmp(copy.what(), "") == 0);
+  }
+  try {
+    r_fail_return_error_code();
+    ASSERT(false);
+  } catch (const rust::Error &e) {
+    ASSERT(e.code() == 2020);
+    ASSERT(std::strcmp(e.what(), "error code 2020") == 0);
+  }
+  try {
+    r_fail_return_primitive();
+    ASSERT(false);
+  } catch (const rust::Error &short_error) {
+    try {
+      r_fail_return_long_message();
+      ASSERT(false);
+    } catch (const rust::Error &long_error) {
+      rust::Error assigned(short_error);
+      assigned = long_error;
+      ASSERT(assigned.what() == long_error.what());
+      assigned = short_error;
+      ASSERT(std::strcmp(assigned.what(), "rust error") == 0);
+      ASSERT(assigned.what() != short_error.what());
+      rust::Error heap(long_error);
+      assigned = std::move(heap);
+      ASSERT(assigned.what() == long_error.what());
+      ASSERT(std::strcmp(heap.what(), "") == 0);
+      heap = short_error;
+      assigned = std::move(heap);
+      ASSERT(std::strcmp(assigned.what(), "rust error") == 0);
+      ASSERT(assigned.code() == 0);
+      const rust::Error &same = assigned;
+      assigned = same;
+      ASSERT(std::strcmp(assigned.what(), "rust error") == 0);
+    }
+  }
+
+  rust::Vec<uint64_t> huge;
+  try {
+    huge.reserve(std::numeric_limits<size_t>::max() / 4);
+    ASSERT(false);
+  } catch (const std::length_error &) {
+    ASSERT(huge.empty());
+  }
+
+  // From the second bridge, in module.rs.
+  ASSERT(r_module_try_sum(r_module_return_rust_vec()) == 420);
+  try {
+    r_module_try_sum(rust::Vec<uint8_t>());
+    ASSERT(false);
+  } catch (const rust::Error &e) {
+    ASSERT(std::strcmp(e.what(), "empty") == 0);
+  }
+
+  Shared shared[2] = {Shared{2000}, Shared{2010}};
+  size_t n[2] = {20, 11};
+  size_t sums[2] = {0, 0};
+  r_add_batch(rust::Slice<const Shared>(shared, 2),
+              rust::Slice<const size_t>(n, 2), rust::Slice<size_t>(sums, 2));
+  ASSERT(sums[0] == 2020 && sums[1] == 2021);
+
+  rust::String moved("2020");
+  rust::String into(std::move(moved));
+  ASSERT(moved.size() == 0);
+  ASSERT(std::string(into) == "2020");
+  moved = std::move(into);
+  ASSERT(std::string(moved) == "2020");
+
+  std::string body(1000, 'x');
+  rust::String taken(std::move(body));
+  ASSERT(taken.size() == 1000 && body.empty());
+
+  Tally tally;
+  r_tally_add(tally, 2000);
+  r_tally_add(tally, 20);
+  Tally kept(std::move(tally));
+  ASSERT(r_tally_sum(kept) == 2020 && r_tally_sum(tally) == 0);
+  tally = std::move(kept);
+  ASSERT(r_tally_sum(tally) == 2020 && r_tally_sum(kept) == 0);
+
+  for (const rust::BridgeStats &stats : rust::bridge_stats()) {
+    ASSERT(stats.calls > 0 && stats.name.size() > 0);
   }
 
   cxx_test_suite_set_correct();
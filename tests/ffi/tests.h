@@ -1,20 +1,26 @@
 #pragma once
 #include "rust/cxx.h"
+#include <iosfwd>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace tests {
 
 struct R;
 struct Shared;
+struct Nested;
+struct Named;
 
 class C {
 public:
   C(size_t n);
   size_t get() const;
+  const std::vector<uint8_t> &get_v() const;
 
 private:
   size_t n;
+  std::vector<uint8_t> v;
 };
 
 size_t c_return_primitive();
@@ -23,8 +29,16 @@ rust::Box<R> c_return_box();
 std::unique_ptr<C> c_return_unique_ptr();
 const size_t &c_return_ref(const Shared &shared);
 rust::Str c_return_str(const Shared &shared);
+rust::Slice<const uint8_t> c_return_slice(const Shared &shared);
 rust::String c_return_rust_string();
+rust::Vec<uint8_t> c_return_rust_vec();
 std::unique_ptr<std::string> c_return_unique_ptr_string();
+std::unique_ptr<std::vector<uint8_t>> c_return_unique_ptr_vector_u8();
+std::unique_ptr<std::vector<double>> c_return_unique_ptr_vector_f64();
+std::unique_ptr<std::vector<Shared>> c_return_unique_ptr_vector_shared();
+const std::vector<uint8_t> &c_return_ref_vector(const C &c);
+std::shared_ptr<C> c_return_shared_ptr();
+std::shared_ptr<std::string> c_return_shared_ptr_string();
 
 void c_take_primitive(size_t n);
 void c_take_shared(Shared shared);
@@ -33,17 +47,50 @@ void c_take_unique_ptr(std::unique_ptr<C> c);
 void c_take_ref_r(const R &r);
 void c_take_ref_c(const C &c);
 void c_take_str(rust::Str s);
+void c_take_slice_u8(rust::Slice<const uint8_t> s);
+void c_take_slice_shared(rust::Slice<const Shared> s);
+void c_take_mut_slice(rust::Slice<uint32_t> s);
 void c_take_rust_string(rust::String s);
+void c_take_rust_vec(rust::Vec<uint8_t> v);
+void c_take_rust_vec_shared(rust::Vec<Shared> v);
+void c_take_ref_rust_vec(const rust::Vec<uint8_t> &v);
+void c_take_mut_rust_vec(rust::Vec<float> &v);
+rust::Vec<uint8_t> c_extend_rust_vec_from_self(rust::Vec<uint8_t> v);
 void c_take_unique_ptr_string(std::unique_ptr<std::string> s);
+void c_take_unique_ptr_vector_u8(std::unique_ptr<std::vector<uint8_t>> v);
+void c_take_ref_vector(const std::vector<uint8_t> &v);
+size_t c_take_shared_ptr(std::shared_ptr<C> c);
+void c_take_weak_ptr(std::weak_ptr<C> c);
 void c_take_callback(rust::Fn<size_t(rust::String)> callback);
+size_t c_copy_stream(std::istream &input, std::ostream &output);
 
 void c_try_return_void();
 size_t c_try_return_primitive();
 size_t c_fail_return_primitive();
+size_t c_fail_return_long_message();
 rust::Box<R> c_try_return_box();
 const rust::String &c_try_return_ref(const rust::String &);
 rust::Str c_try_return_str(rust::Str);
+rust::Slice<const uint8_t> c_try_return_slice(rust::Slice<const uint8_t>);
 rust::String c_try_return_rust_string();
 std::unique_ptr<std::string> c_try_return_unique_ptr_string();
 
+size_t c_add(const Shared &shared, size_t n);
+size_t c_try_increment(size_t n);
+
+void c_async_add(size_t a, size_t b, rust::Promise<size_t> promise);
+void c_async_greeting(rust::String name, rust::Promise<rust::String> promise);
+void c_async_abandon(rust::Promise<void> promise);
+
+const Shared &c_arena_make_shared(const rust::Arena &arena, size_t z);
+size_t c_arena_sum(const rust::Arena &arena);
+bool c_arena_too_large(const rust::Arena &arena);
+
+Nested c_flip_nested(Nested nested);
+Named c_rename(Named named);
+
+int32_t c_module_try_increment(int32_t n);
+size_t c_module_add(const Shared &shared, size_t n);
+size_t c_module_sum_rust_vec(rust::Vec<uint8_t> v);
+
 } // namespace tests
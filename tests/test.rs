@@ -1,6 +1,14 @@
-use cxx_test_suite::ffi;
+use cxx::{CxxIstream, CxxOstream, SharedPtr, WeakPtr};
+use cxx_test_suite::{ffi, module};
 use std::cell::Cell;
 use std::ffi::CStr;
+use std::future::Future;
+use std::io::{self, Read};
+use std::mem::ManuallyDrop;
+use std::panic;
+use std::sync::Arc;
+use std::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+use std::thread::{self, Thread};
 
 thread_local! {
     static CORRECT: Cell<bool> = Cell::new(false);
@@ -29,7 +37,9 @@ fn test_c_return() {
     ffi::c_return_unique_ptr();
     assert_eq!(2020, *ffi::c_return_ref(&shared));
     assert_eq!("2020", ffi::c_return_str(&shared));
+    assert_eq!(b"2020", ffi::c_return_slice(&shared));
     assert_eq!("2020", ffi::c_return_rust_string());
+    assert_eq!(b"2020", &ffi::c_return_rust_vec()[..]);
     assert_eq!(
         "2020",
         ffi::c_return_unique_ptr_string()
@@ -38,6 +48,44 @@ fn test_c_return() {
             .to_str()
             .unwrap()
     );
+    let cxx_string = ffi::c_return_unique_ptr_string();
+    let view = cxx_string.as_ref().unwrap().as_cxx_str();
+    assert_eq!(view, "2020");
+    assert_eq!(view.len(), 4);
+    assert_eq!(view.to_str(), Ok("2020"));
+    assert_eq!(b"2020", &ffi::c_return_unique_ptr_string().into_bytes()[..]);
+    assert_eq!(
+        "2020",
+        ffi::c_return_unique_ptr_string().into_string().unwrap()
+    );
+    assert_eq!(
+        4,
+        ffi::c_return_unique_ptr_vector_u8().as_ref().unwrap().len()
+    );
+    assert_eq!(
+        200.5f64,
+        ffi::c_return_unique_ptr_vector_f64()
+            .as_ref()
+            .unwrap()
+            .as_slice()
+            .iter()
+            .sum(),
+    );
+    assert_eq!(
+        2021usize,
+        ffi::c_return_unique_ptr_vector_shared()
+            .as_ref()
+            .unwrap()
+            .as_slice()
+            .iter()
+            .map(|o| o.z)
+            .sum(),
+    );
+    let c = ffi::c_return_unique_ptr();
+    assert_eq!(
+        [20, 2, 0],
+        ffi::c_return_ref_vector(c.as_ref().unwrap()).as_slice(),
+    );
 }
 
 #[test]
@@ -48,9 +96,14 @@ fn test_c_try_return() {
         "logic error",
         ffi::c_fail_return_primitive().unwrap_err().what(),
     );
+    assert_eq!(
+        "a message long enough that it no longer fits inline in the error",
+        ffi::c_fail_return_long_message().unwrap_err().what(),
+    );
     assert_eq!(2020, *ffi::c_try_return_box().unwrap());
     assert_eq!("2020", *ffi::c_try_return_ref(&"2020".to_owned()).unwrap());
     assert_eq!("2020", ffi::c_try_return_str("2020").unwrap());
+    assert_eq!(b"2020", ffi::c_try_return_slice(b"2020").unwrap());
     assert_eq!("2020", ffi::c_try_return_rust_string().unwrap());
     assert_eq!(
         "2020",
@@ -61,6 +114,79 @@ fn test_c_try_return() {
     );
 }
 
+#[test]
+fn test_c_batch() {
+    let shared = [ffi::Shared { z: 2000 }, ffi::Shared { z: 2010 }];
+    let mut sums = [0; 2];
+    ffi::c_add_batch(&shared, &[20, 11], &mut sums);
+    assert_eq!(sums, [2020, 2021]);
+
+    let mut increments = [0; 3];
+    ffi::c_try_increment_batch(&[1, 2, 3], &mut increments).unwrap();
+    assert_eq!(increments, [2, 3, 4]);
+    let err = ffi::c_try_increment_batch(&[1, 0], &mut [0; 2]).unwrap_err();
+    assert_eq!(err.what(), "zero");
+}
+
+#[test]
+fn test_module_try_return() {
+    assert_eq!(2020, module::ffi::c_module_try_increment(2019).unwrap());
+    let err = module::ffi::c_module_try_increment(0).unwrap_err();
+    assert_eq!(err.what(), "zero");
+}
+
+#[test]
+fn test_module_shared_types() {
+    let shared = module::ffi::Shared { z: 2000 };
+    assert_eq!(2020, module::ffi::c_module_add(&shared, 20));
+    let bytes = vec![255, 255, 255, 255, 255, 255, 255, 235];
+    assert_eq!(2020, module::ffi::c_module_sum_rust_vec(bytes));
+}
+
+#[test]
+fn test_c_async() {
+    assert_eq!(2020, block_on(ffi::c_async_add(2000, 20)));
+    let greeting = block_on(ffi::c_async_greeting("world".to_owned()));
+    assert_eq!("hello world", greeting);
+    let abandoned = panic::catch_unwind(|| block_on(ffi::c_async_abandon()));
+    assert!(abandoned.is_err());
+}
+
+#[test]
+fn test_c_arena() {
+    let mut arena = cxx::Arena::new();
+    let shared: Vec<&ffi::Shared> = (0..1000)
+        .map(|z| ffi::c_arena_make_shared(&arena, z))
+        .collect();
+    assert!(shared.iter().enumerate().all(|(z, shared)| shared.z == z));
+    assert_eq!(ffi::c_arena_sum(&arena), 5050);
+    assert!(ffi::c_arena_too_large(&arena));
+
+    let capacity = arena.capacity();
+    arena.reset();
+    assert!(arena.capacity() <= capacity);
+    assert_eq!(ffi::c_arena_make_shared(&arena, 2020).z, 2020);
+}
+
+#[test]
+fn test_c_struct_by_value() {
+    let nested = ffi::Nested {
+        shared: ffi::Shared { z: 2020 },
+        flag: false,
+    };
+    let nested = ffi::c_flip_nested(nested);
+    assert_eq!(nested.shared.z, 2021);
+    assert!(nested.flag);
+
+    let named = ffi::Named {
+        name: "rust".to_owned(),
+        z: 2020,
+    };
+    let named = ffi::c_rename(named);
+    assert_eq!(named.name, "rust and c++");
+    assert_eq!(named.z, 2021);
+}
+
 #[test]
 fn test_c_take() {
     let unique_ptr = ffi::c_return_unique_ptr();
@@ -71,10 +197,43 @@ fn test_c_take() {
     check!(ffi::c_take_ref_c(unique_ptr.as_ref().unwrap()));
     check!(ffi::c_take_unique_ptr(unique_ptr));
     check!(ffi::c_take_str("2020"));
+    check!(ffi::c_take_slice_u8(b"2020"));
+    check!(ffi::c_take_slice_shared(&[
+        ffi::Shared { z: 2020 },
+        ffi::Shared { z: 2021 },
+    ]));
     check!(ffi::c_take_rust_string("2020".to_owned()));
+    check!(ffi::c_take_rust_vec(b"2020".to_vec()));
+    check!(ffi::c_take_rust_vec_shared(vec![
+        ffi::Shared { z: 2020 },
+        ffi::Shared { z: 2021 },
+    ]));
+    check!(ffi::c_take_ref_rust_vec(&b"2020".to_vec()));
     check!(ffi::c_take_unique_ptr_string(
         ffi::c_return_unique_ptr_string()
     ));
+    check!(ffi::c_take_unique_ptr_vector_u8(
+        ffi::c_return_unique_ptr_vector_u8()
+    ));
+    check!(ffi::c_take_ref_vector(
+        ffi::c_return_unique_ptr_vector_u8().as_ref().unwrap()
+    ));
+}
+
+#[test]
+fn test_c_take_mut_rust_vec() {
+    let mut v = Vec::with_capacity(1);
+    v.push(0.0f32);
+    ffi::c_take_mut_rust_vec(&mut v);
+    assert_eq!(v, [0.0, 2020.0, 2020.0]);
+}
+
+#[test]
+fn test_c_extend_rust_vec_from_self() {
+    let v = b"2020".to_vec();
+    assert_eq!(v.len(), v.capacity());
+    let v = ffi::c_extend_rust_vec_from_self(v);
+    assert_eq!(v, b"2020220202");
 }
 
 #[test]
@@ -89,6 +248,81 @@ fn test_c_callback() {
     check!(ffi::c_take_callback(callback));
 }
 
+#[test]
+fn test_c_stream() {
+    let data: Vec<u8> = (0..1000u32).map(|i| i as u8).collect();
+    let mut copy = Vec::new();
+    let mut read_buf = [0; 16];
+    let mut write_buf = [0; 64];
+    let n = CxxIstream::with_reader(&data[..], &mut read_buf, |input| {
+        CxxOstream::with_writer(&mut copy, &mut write_buf, |output| {
+            ffi::c_copy_stream(input, output)
+        })
+    });
+    assert_eq!(n.unwrap().unwrap(), 1000);
+    assert_eq!(copy[..1000], data[..]);
+    assert_eq!(copy[1000..], b"."[..]);
+
+    struct Failing;
+    impl Read for Failing {
+        fn read(&mut self, _buf: &mut [u8]) -> io::Result<usize> {
+            Err(io::Error::new(io::ErrorKind::Other, "failing reader"))
+        }
+    }
+    let mut sink = Vec::new();
+    let result = CxxIstream::with_reader(Failing, &mut read_buf, |input| {
+        CxxOstream::with_writer(&mut sink, &mut write_buf, |output| {
+            ffi::c_copy_stream(input, output)
+        })
+    });
+    assert_eq!(result.unwrap_err().to_string(), "failing reader");
+    assert_eq!(sink, b".");
+}
+
+#[test]
+fn test_c_shared_ptr() {
+    let shared = ffi::c_return_shared_ptr();
+    let weak = SharedPtr::downgrade(&shared);
+    check!(ffi::c_take_weak_ptr(weak.clone()));
+    let use_count;
+    check!(use_count = ffi::c_take_shared_ptr(shared.clone()));
+    assert_eq!(use_count, 2);
+    assert!(!weak.upgrade().is_null());
+    drop(shared);
+    assert!(weak.upgrade().is_null());
+    assert!(WeakPtr::<ffi::C>::null().upgrade().is_null());
+
+    let string = ffi::c_return_shared_ptr_string();
+    let readers: Vec<_> = (0..4)
+        .map(|_| {
+            let string = string.clone();
+            thread::spawn(move || string.as_ref().unwrap().to_str().unwrap() == "2020")
+        })
+        .collect();
+    for reader in readers {
+        assert!(reader.join().unwrap());
+    }
+    assert_eq!(string.to_string(), "2020");
+}
+
+#[test]
+fn test_c_thread_safe() {
+    let c = ffi::c_return_shared_ptr();
+    let workers: Vec<_> = (0..4)
+        .map(|_| {
+            let c = c.clone();
+            thread::spawn(move || {
+                for _ in 0..100 {
+                    check!(ffi::c_take_ref_c(c.as_ref().unwrap()));
+                }
+            })
+        })
+        .collect();
+    for worker in workers {
+        worker.join().unwrap();
+    }
+}
+
 #[test]
 fn test_c_call_r() {
     fn cxx_run_test() {
@@ -104,6 +338,21 @@ fn test_c_call_r() {
     check!(cxx_run_test());
 }
 
+#[test]
+fn test_stats() {
+    ffi::c_return_primitive();
+    let stats = cxx::stats();
+    if cfg!(feature = "stats") {
+        let primitive = stats
+            .iter()
+            .find(|stats| stats.name.ends_with("::c_return_primitive"))
+            .unwrap();
+        assert!(primitive.calls >= 1);
+    } else {
+        assert!(stats.is_empty());
+    }
+}
+
 #[no_mangle]
 extern "C" fn cxx_test_suite_get_box() -> *mut cxx_test_suite::R {
     Box::into_raw(Box::new(2020usize))
@@ -113,3 +362,35 @@ extern "C" fn cxx_test_suite_get_box() -> *mut cxx_test_suite::R {
 unsafe extern "C" fn cxx_test_suite_r_is_correct(r: *const cxx_test_suite::R) -> bool {
     *r == 2020
 }
+
+// Minimal executor for the async bridge functions: the waker unparks the
+// thread that is polling.
+fn block_on<F: Future>(future: F) -> F::Output {
+    static VTABLE: RawWakerVTable = RawWakerVTable::new(clone, wake, wake_by_ref, drop);
+
+    unsafe fn clone(data: *const ()) -> RawWaker {
+        let thread = ManuallyDrop::new(Arc::from_raw(data as *const Thread));
+        let data = Arc::into_raw(Arc::clone(&thread)) as *const ();
+        RawWaker::new(data, &VTABLE)
+    }
+    unsafe fn wake(data: *const ()) {
+        Arc::from_raw(data as *const Thread).unpark();
+    }
+    unsafe fn wake_by_ref(data: *const ()) {
+        (*(data as *const Thread)).unpark();
+    }
+    unsafe fn drop(data: *const ()) {
+        let _ = Arc::from_raw(data as *const Thread);
+    }
+
+    let data = Arc::into_raw(Arc::new(thread::current())) as *const ();
+    let waker = unsafe { Waker::from_raw(RawWaker::new(data, &VTABLE)) };
+    let mut cx = Context::from_waker(&waker);
+    let mut future = Box::pin(future);
+    loop {
+        match future.as_mut().poll(&mut cx) {
+            Poll::Ready(output) => return output,
+            Poll::Pending => thread::park(),
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#[cxx::bridge]
+mod ffi {
+    extern "Rust" {
+        async fn f(s: &str);
+    }
+}
+
+async fn f(_s: &str) {}
+
+fn main() {}
@@ -0,0 +1,13 @@
+#[cxx::bridge]
+mod ffi {
+    struct Shared {
+        z: usize,
+    }
+
+    extern "C" {
+        #[batch]
+        fn f(shared: Shared) -> usize;
+    }
+}
+
+fn main() {}
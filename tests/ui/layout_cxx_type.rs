@@ -0,0 +1,9 @@
+#[cxx::bridge]
+mod ffi {
+    extern "C" {
+        #[layout(size = 8, align = 8)]
+        type C;
+    }
+}
+
+fn main() {}
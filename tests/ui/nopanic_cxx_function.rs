@@ -0,0 +1,9 @@
+#[cxx::bridge]
+mod ffi {
+    extern "C" {
+        #[nopanic]
+        fn f();
+    }
+}
+
+fn main() {}
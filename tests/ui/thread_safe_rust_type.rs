@@ -0,0 +1,11 @@
+#[cxx::bridge]
+mod ffi {
+    extern "Rust" {
+        #[thread_safe]
+        type R;
+    }
+}
+
+struct R;
+
+fn main() {}